@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../inc/gameboy.h"
+#include "../inc/pacing.h"
+#include "../inc/movie.h"
+#include "../inc/rom.h"
+#include "../inc/hostprof.h"
+#include "../inc/memstats.h"
+#include "../inc/trace.h"
+
+#include "samples.h"
+
+// end-to-end throughput of fixed, headless workloads: a rom, optionally driven by
+// an input movie, run for a fixed number of frames with every frame drawn
+
+#define DEFAULT_WORKLOADS "bench/workloads.txt"
+#define MAX_WORKLOADS     64
+#define WARMUP_FRAMES     60
+
+typedef struct {
+    char name[64];
+    char rom[256];
+    char movie[256];
+    uint32_t frames;
+    char subsystem[32];  // what the workload mostly stresses, for the regression report
+} Workload;
+
+typedef struct {
+    char name[64];
+    uint32_t frames;
+    double seconds;
+    double fps;
+    double mips;
+    double ns_per_frame;
+    long peak_rss_kb;   // -1 when the workload had to run in this process
+    uint32_t checksum;  // machine state at the end, equal across builds that emulate the same way
+} WorkloadResult;
+
+typedef struct {
+    char* workloads_path;
+    char* json_path;
+    char* filter;
+    char* label;
+    char* samples_path;
+    char* trace_path;
+    uint32_t frames;
+    uint32_t runs;
+    uint32_t audio_rate;  // synthesize sound at this rate, 0 runs without it like headless instances
+} BenchOptions;
+
+// small always-available workload: an alu loop that streams its results into wram
+// while the lcd is on, so the cpu, the memory dispatch and the ppu all get exercised
+static const uint8_t BUILTIN_PROGRAM[] = {
+    0x31, 0xFE, 0xFF,   // ld sp, $fffe
+    0x21, 0x00, 0xC0,   // loop: ld hl, $c000
+    0x1E, 0x00,         // ld e, 0
+    0x78,               // inner: ld a, b
+    0x81,               // add a, c
+    0x47,               // ld b, a
+    0x0C,               // inc c
+    0xAA,               // xor d
+    0x57,               // ld d, a
+    0x22,               // ld (hl+), a
+    0x1D,               // dec e
+    0x20, 0xF6,         // jr nz, inner
+    0x18, 0xEF          // jr loop
+};
+
+static void load_builtin_rom(Memory* mem)
+{
+    memset(mem->rom, 0, 0x8000);
+
+    mem->rom[0x100] = 0x00;  // nop
+    mem->rom[0x101] = 0xC3;  // jp $0150
+    mem->rom[0x102] = 0x50;
+    mem->rom[0x103] = 0x01;
+
+    memcpy(&mem->rom[0x150], BUILTIN_PROGRAM, sizeof(BUILTIN_PROGRAM));
+}
+
+static uint8_t file_exists(const char* path)
+{
+    return access(path, R_OK) == 0;
+}
+
+static uint32_t parse_workloads(const char* path, Workload* workloads)
+{
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+
+    char line[1024];
+    uint32_t count = 0;
+
+    while (count < MAX_WORKLOADS && fgets(line, sizeof(line), f) != NULL)
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        Workload* workload = &workloads[count];
+        strcpy(workload->subsystem, "system");
+        if (sscanf(line, "%63s %255s %255s %u %31s", workload->name, workload->rom, workload->movie, &workload->frames, workload->subsystem) < 4)
+            continue;
+
+        if (strcmp(workload->movie, "-") == 0)
+            workload->movie[0] = '\0';
+
+        count++;
+    }
+
+    fclose(f);
+
+    return count;
+}
+
+// returns 0 if the workload's files are missing or don't belong together
+static uint8_t run_workload(Workload* workload, uint32_t frames, uint32_t audio_rate, WorkloadResult* result)
+{
+    GameBoy* gb = gameboy_init();
+    Mixer* mixer = audio_rate ? mixer_init(audio_rate, GB_CLOCK_SPEED) : NULL;
+    Movie* movie = NULL;
+    MoviePlayer player;
+
+    if (strcmp(workload->rom, "builtin") == 0)
+        load_builtin_rom(gb->mem);
+    else if (file_exists(workload->rom))
+        load_rom(gb->mem, workload->rom);
+    else
+    {
+        gameboy_free(gb);
+        if (mixer != NULL)
+            mixer_free(mixer);
+        return 0;
+    }
+
+    if (mixer != NULL)
+        apu_set_mixer(gb->apu, gb->mem, mixer);
+
+    if (workload->movie[0] != '\0')
+    {
+        movie = file_exists(workload->movie) ? movie_read_file(workload->movie) : NULL;
+        if (movie == NULL || !movie_player_start(&player, movie, gb))
+        {
+            if (movie != NULL)
+                movie_free(movie);
+
+            gameboy_free(gb);
+            if (mixer != NULL)
+                mixer_free(mixer);
+            return 0;
+        }
+
+        // a movie's length bounds the workload
+        uint32_t available = movie->header.frame_count > WARMUP_FRAMES ? movie->header.frame_count - WARMUP_FRAMES : 0;
+        if (frames > available)
+            frames = available;
+    }
+
+    for (uint32_t i = 0; i < WARMUP_FRAMES; i++)
+    {
+        if (movie != NULL)
+            movie_player_run_frame(&player, gb);
+        else
+            gameboy_run_frame(gb);
+        gb->ppu->frame_ready = 0;
+    }
+
+    uint64_t instructions = gb->instructions;
+    uint64_t start = pacer_now_ns();
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        if (movie != NULL)
+            movie_player_run_frame(&player, gb);
+        else
+            gameboy_run_frame(gb);
+        gb->ppu->frame_ready = 0;
+    }
+
+    uint64_t elapsed = pacer_now_ns() - start;
+    double seconds = elapsed / 1e9;
+
+    strcpy(result->name, workload->name);
+    result->frames = frames;
+    result->seconds = seconds;
+    result->fps = seconds > 0 ? frames / seconds : 0.0;
+    result->mips = seconds > 0 ? (gb->instructions - instructions) / seconds / 1e6 : 0.0;
+    result->ns_per_frame = frames > 0 ? (double)elapsed / frames : 0.0;
+    result->peak_rss_kb = -1;
+    result->checksum = gameboy_checksum(gb);
+
+    if (movie != NULL)
+    {
+        if (player.mismatches > 0)
+            fprintf(stderr, "bench: %s desynced from its movie at frame %u\n", workload->name, player.first_mismatch);
+        movie_free(movie);
+    }
+
+    gameboy_free(gb);
+    if (mixer != NULL)
+        mixer_free(mixer);
+
+    return 1;
+}
+
+// ru_maxrss only ever grows, so each workload runs in a child of its own and reports
+// that child's peak. traces and the build time profilers collect into this process,
+// with any of them on the workloads run here and go without
+static uint8_t run_workload_isolated(Workload* workload, uint32_t frames, uint32_t audio_rate, WorkloadResult* result)
+{
+#if defined(OAMX_PROFILE) || defined(OAMX_MEMSTATS)
+    return run_workload(workload, frames, audio_rate, result);
+#else
+    int fds[2];
+    if (trace_enabled || pipe(fds) != 0)
+        return run_workload(workload, frames, audio_rate, result);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return run_workload(workload, frames, audio_rate, result);
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        uint8_t ok = run_workload(workload, frames, audio_rate, result);
+        ok = ok && write(fds[1], result, sizeof(WorkloadResult)) == sizeof(WorkloadResult);
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    WorkloadResult child;
+    ssize_t got = read(fds[0], &child, sizeof(WorkloadResult));
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0
+        || got != sizeof(WorkloadResult))
+        return 0;
+
+    *result = child;
+    result->peak_rss_kb = usage.ru_maxrss;
+
+    return 1;
+#endif
+}
+
+static void write_json(FILE* f, BenchOptions* options, WorkloadResult* results, uint32_t count)
+{
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"label\": \"%s\",\n", options->label != NULL ? options->label : "");
+    fprintf(f, "  \"host\": \"%s\",\n", host);
+    fprintf(f, "  \"cores\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(f, "  \"workloads\": [\n");
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        WorkloadResult* r = &results[i];
+        char rss[24] = "null";
+        if (r->peak_rss_kb >= 0)
+            snprintf(rss, sizeof(rss), "%ld", r->peak_rss_kb);
+
+        fprintf(f, "    {\"name\": \"%s\", \"frames\": %u, \"seconds\": %.6f, \"fps\": %.2f, \"mips\": %.3f, \"ns_per_frame\": %.0f, \"peak_rss_kb\": %s, \"checksum\": \"%08X\"}%s\n",
+            r->name, r->frames, r->seconds, r->fps, r->mips, r->ns_per_frame, rss, r->checksum, i + 1 < count ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+}
+
+static BenchOptions parse_options(int argc, char** argv)
+{
+    BenchOptions options = { 0 };
+    options.workloads_path = DEFAULT_WORKLOADS;
+
+    for (int i = 1; i < argc; i++)
+    {
+        char* arg = argv[i];
+        char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL)
+            break;
+
+        if (strcmp(arg, "--workloads") == 0)
+            options.workloads_path = value;
+        else if (strcmp(arg, "--json") == 0)
+            options.json_path = value;
+        else if (strcmp(arg, "--filter") == 0)
+            options.filter = value;
+        else if (strcmp(arg, "--label") == 0)
+            options.label = value;
+        else if (strcmp(arg, "--frames") == 0)
+            options.frames = atoi(value);
+        else if (strcmp(arg, "--runs") == 0)
+            options.runs = atoi(value);
+        else if (strcmp(arg, "--samples") == 0)
+            options.samples_path = value;
+        else if (strcmp(arg, "--trace") == 0)
+            options.trace_path = value;
+        else if (strcmp(arg, "--audio") == 0)
+            options.audio_rate = atoi(value);
+        else
+            continue;
+
+        i++;
+    }
+
+    if (options.runs < 1)
+        options.runs = 1;
+    if (options.runs > SAMPLES_MAX)
+        options.runs = SAMPLES_MAX;
+
+    return options;
+}
+
+static int compare_results(const void* a, const void* b)
+{
+    double x = ((const WorkloadResult*)a)->ns_per_frame;
+    double y = ((const WorkloadResult*)b)->ns_per_frame;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options = parse_options(argc, argv);
+    PROF_INIT(NULL);
+
+    if (options.trace_path != NULL && !trace_open(options.trace_path))
+        fprintf(stderr, "bench: couldn't write %s\n", options.trace_path);
+
+    Workload workloads[MAX_WORKLOADS];
+    uint32_t workload_count = parse_workloads(options.workloads_path, workloads);
+
+    if (workload_count == 0)
+    {
+        // without a workload list there's still the built-in rom
+        workloads[0] = (Workload) { "builtin_alu", "builtin", "", 3000, "cpu" };
+        workload_count = 1;
+    }
+
+    FILE* samples = NULL;
+    if (options.samples_path != NULL && (samples = fopen(options.samples_path, "w")) == NULL)
+    {
+        fprintf(stderr, "bench: couldn't write %s\n", options.samples_path);
+        return 1;
+    }
+
+    WorkloadResult results[MAX_WORKLOADS];
+    uint32_t result_count = 0;
+
+    WorkloadResult* runs = (WorkloadResult*) malloc(options.runs * sizeof(WorkloadResult));
+
+    printf("%-24s %8s %10s %10s %14s %12s %10s\n", "workload", "frames", "fps", "mips", "ns/frame", "peak rss", "checksum");
+
+    for (uint32_t i = 0; i < workload_count; i++)
+    {
+        Workload* workload = &workloads[i];
+        if (options.filter != NULL && strstr(workload->name, options.filter) == NULL)
+            continue;
+
+        uint32_t frames = options.frames ? options.frames : workload->frames;
+        WorkloadResult* result = &results[result_count];
+
+        if (!run_workload_isolated(workload, frames, options.audio_rate, &runs[0]))
+        {
+            printf("%-24s skipped, missing or mismatched rom/movie\n", workload->name);
+            continue;
+        }
+
+        for (uint32_t run = 1; run < options.runs; run++)
+            run_workload_isolated(workload, frames, options.audio_rate, &runs[run]);
+
+        if (samples != NULL)
+        {
+            double ns[SAMPLES_MAX];
+            for (uint32_t run = 0; run < options.runs; run++)
+                ns[run] = runs[run].ns_per_frame;
+
+            samples_write(samples, workload->subsystem, workload->name, "ns/frame", ns, options.runs);
+        }
+
+        // with several runs the median one is reported
+        qsort(runs, options.runs, sizeof(WorkloadResult), compare_results);
+        *result = runs[options.runs / 2];
+
+        char rss[24] = "-";
+        if (result->peak_rss_kb >= 0)
+            snprintf(rss, sizeof(rss), "%ld KB", result->peak_rss_kb);
+
+        printf("%-24s %8u %10.1f %10.2f %14.0f %12s   %08X\n",
+            result->name, result->frames, result->fps, result->mips, result->ns_per_frame, rss, result->checksum);
+
+        result_count++;
+    }
+
+    free(runs);
+
+    PROF_FINISH(stdout);
+    MEMSTATS_FINISH(stdout);
+    trace_close();
+
+    if (samples != NULL)
+        fclose(samples);
+
+    if (options.json_path != NULL)
+    {
+        FILE* f = strcmp(options.json_path, "-") == 0 ? stdout : fopen(options.json_path, "w");
+        if (f == NULL)
+        {
+            fprintf(stderr, "bench: couldn't write %s\n", options.json_path);
+            return 1;
+        }
+
+        write_json(f, &options, results, result_count);
+
+        if (f != stdout)
+            fclose(f);
+    }
+
+    return 0;
+}
\ No newline at end of file
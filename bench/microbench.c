@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../inc/gameboy.h"
+#include "../inc/instructions.h"
+#include "../inc/cb_instructions.h"
+#include "../inc/pacing.h"
+#include "../inc/mixer.h"
+
+#include "samples.h"
+
+// ns/op of the core hot paths in isolation. every case is calibrated so one sample
+// takes SAMPLE_NS, warmed up, then sampled REPETITIONS times; the median is the
+// figure to compare, the spread tells whether a difference is noise
+
+#define SAMPLE_NS      2000000ULL
+#define WARMUP_SAMPLES 3
+#define REPETITIONS    21
+#define MAX_ITERATIONS (1u << 30)
+
+typedef struct {
+    GameBoy* gb;
+    Timer timer;
+    Mixer* mixer;
+    uint32_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    uint32_t param;
+} BenchContext;
+
+typedef void (*BenchFn)(BenchContext* ctx, uint32_t iterations);
+
+typedef struct {
+    const char* group;
+    const char* name;
+    BenchFn run;
+    void (*setup)(BenchContext* ctx, uint32_t param);
+    uint32_t param;
+} MicroBench;
+
+static const uint32_t palette[4] = { 0xFFFFFFFF, 0xC0C0C0FF, 0x606060FF, 0x000000FF };
+
+static volatile uint32_t sink;
+
+static uint32_t lcg(uint32_t* state)
+{
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 16;
+}
+
+// memory
+
+#define REGION(base, mask) ((base) << 16 | (mask))
+
+static void bench_memory_read(BenchContext* ctx, uint32_t iterations)
+{
+    Memory* mem = ctx->gb->mem;
+    uint16_t base = ctx->param >> 16;
+    uint16_t mask = ctx->param & 0xFFFF;
+    uint32_t acc = 0;
+
+    for (uint32_t i = 0; i < iterations; i++)
+        acc += memory_read(mem, base + (i & mask));
+
+    sink = acc;
+}
+
+static void bench_memory_write(BenchContext* ctx, uint32_t iterations)
+{
+    Memory* mem = ctx->gb->mem;
+    uint16_t base = ctx->param >> 16;
+    uint16_t mask = ctx->param & 0xFFFF;
+
+    for (uint32_t i = 0; i < iterations; i++)
+        memory_write(mem, base + (i & mask), (uint8_t)i | 1);
+}
+
+static void setup_memory(BenchContext* ctx, uint32_t param)
+{
+    Memory* mem = ctx->gb->mem;
+    memory_write(mem, 0x0000, 0x0A); // enable cartridge ram
+    memory_write(mem, 0x2000, 0x02); // and switch some bank in
+}
+
+// cpu
+
+static void bench_execute(BenchContext* ctx, uint32_t iterations)
+{
+    Cpu* cpu = ctx->gb->cpu;
+    Memory* mem = ctx->gb->mem;
+    uint8_t opcode = ctx->param;
+
+    // operands are read from wram, (hl) points into it and the stack has room,
+    // so every opcode can be repeated from the same state
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        cpu->pc = 0xC001;
+        cpu->sp = 0xDFF0;
+        set_hl(cpu, 0xC100);
+        execute(cpu, mem, opcode);
+    }
+
+    sink = cpu->a + cpu->current_ticks;
+    cpu->current_ticks = 0;
+}
+
+static void bench_execute_cb(BenchContext* ctx, uint32_t iterations)
+{
+    Cpu* cpu = ctx->gb->cpu;
+    Memory* mem = ctx->gb->mem;
+    uint8_t opcode = ctx->param;
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        set_hl(cpu, 0xC100);
+        execute_cb_instruction(cpu, mem, opcode);
+    }
+
+    sink = cpu->a + cpu->current_ticks;
+    cpu->current_ticks = 0;
+}
+
+static void setup_cpu(BenchContext* ctx, uint32_t param)
+{
+    Memory* mem = ctx->gb->mem;
+
+    // operand bytes: jumps and calls land back in wram, absolute loads read wram
+    memory_write(mem, 0xC001, 0x00);
+    memory_write(mem, 0xC002, 0xC0);
+    memory_write(mem, 0xC100, 0x5A);
+    memory_write16(mem, 0xDFF0, 0xC000);
+
+    ctx->gb->cpu->a = 0x3C;
+    ctx->gb->cpu->b = 0x11;
+}
+
+// ppu
+
+static void bench_draw_scanline(BenchContext* ctx, uint32_t iterations)
+{
+    Ppu* ppu = ctx->gb->ppu;
+    Memory* mem = ctx->gb->mem;
+
+    // the first 8 lines are where every configured sprite is visible
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        mem->ly = i & 7;
+        ppu->window_line_counter = mem->ly;
+        ppu_draw_scanline(ppu, mem);
+    }
+
+    sink = ppu->framebuffer[7][SCREEN_WIDTH - 1];
+}
+
+static void setup_ppu(BenchContext* ctx, uint32_t lcdc)
+{
+    Memory* mem = ctx->gb->mem;
+    uint32_t seed = 0x0A3C;
+
+    // random tile data and tile maps
+    for (uint16_t i = 0; i < 0x2000; i++)
+        mem->vram[i] = lcg(&seed);
+
+    // 10 sprites sharing the top lines, spread over the screen and mixing flips and priorities
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        uint8_t* sprite = &mem->oam[i * 4];
+        sprite[0] = i < 10 ? 16 : 160;
+        sprite[1] = 8 + i * 16;
+        sprite[2] = lcg(&seed);
+        sprite[3] = (i & 3) << 5 | (i & 1) << 4 | (i == 5 ? 0x80 : 0);
+    }
+
+    mem->lcdc = lcdc;
+    mem->bgp = 0xE4;
+    mem->obp0 = 0xD2;
+    mem->obp1 = 0x1B;
+    mem->scx = 3;
+    mem->scy = 5;
+    mem->wy = 0;
+    mem->wx = 7 + SCREEN_WIDTH / 2;
+
+    ctx->gb->ppu->sprite_height = lcdc & LCDC_SPRITE_HEIGHT ? 16 : 8;
+}
+
+// timer
+
+static void bench_timer_update(BenchContext* ctx, uint32_t iterations)
+{
+    Memory* mem = ctx->gb->mem;
+
+    for (uint32_t i = 0; i < iterations; i++)
+        timer_update(&ctx->timer, mem, 4);
+
+    sink = mem->tima + mem->div;
+}
+
+static void setup_timer(BenchContext* ctx, uint32_t tac)
+{
+    ctx->gb->mem->tac = tac;
+    ctx->gb->mem->tma = 0xF0;
+}
+
+// display conversion, one op is a whole frame
+
+static void bench_convert_framebuffer(BenchContext* ctx, uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+        ppu_convert_framebuffer(ctx->gb->ppu, palette, ctx->pixels);
+
+    sink = ctx->pixels[SCREEN_WIDTH * SCREEN_HEIGHT - 1];
+}
+
+static void setup_framebuffer(BenchContext* ctx, uint32_t param)
+{
+    uint32_t seed = 0x5EED;
+    for (uint8_t y = 0; y < SCREEN_HEIGHT; y++)
+        for (uint8_t x = 0; x < SCREEN_WIDTH; x++)
+            ctx->gb->ppu->framebuffer[y][x] = lcg(&seed) & 3;
+}
+
+// audio mixing: one add_delta op is a single channel transition, one end_frame
+// op turns a frame of them into samples
+
+#define FRAME_CYCLES (154 * VBLANK_TICKS)
+
+static void bench_mixer_add_delta(BenchContext* ctx, uint32_t iterations)
+{
+    uint32_t seed = 0x5EED;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        // keep the buffer from growing without bound across samples
+        if ((i & 0x3FF) == 0x3FF)
+            mixer_end_frame(ctx->mixer, FRAME_CYCLES);
+
+        mixer_add_delta(ctx->mixer, lcg(&seed) % FRAME_CYCLES, 8, -8);
+    }
+
+    sink = ctx->mixer->sample_count;
+}
+
+static void bench_mixer_end_frame(BenchContext* ctx, uint32_t iterations)
+{
+    for (uint32_t i = 0; i < iterations; i++)
+        mixer_end_frame(ctx->mixer, FRAME_CYCLES);
+
+    sink = ctx->mixer->samples[0];
+}
+
+static void setup_mixer(BenchContext* ctx, uint32_t sample_rate)
+{
+    ctx->mixer = mixer_init(sample_rate, GB_CLOCK_SPEED);
+}
+
+static const MicroBench BENCHES[] = {
+    { "memory_read",  "rom0",               bench_memory_read,  setup_memory, REGION(0x0000, 0x3FFF) },
+    { "memory_read",  "romx",               bench_memory_read,  setup_memory, REGION(0x4000, 0x3FFF) },
+    { "memory_read",  "vram",               bench_memory_read,  setup_memory, REGION(0x8000, 0x1FFF) },
+    { "memory_read",  "sram",               bench_memory_read,  setup_memory, REGION(0xA000, 0x1FFF) },
+    { "memory_read",  "wram",               bench_memory_read,  setup_memory, REGION(0xC000, 0x1FFF) },
+    { "memory_read",  "echo",               bench_memory_read,  setup_memory, REGION(0xE000, 0x0FFF) },
+    { "memory_read",  "oam",                bench_memory_read,  setup_memory, REGION(0xFE00, 0x007F) },
+    { "memory_read",  "io",                 bench_memory_read,  setup_memory, REGION(0xFF40, 0x0007) },
+    { "memory_read",  "hram",               bench_memory_read,  setup_memory, REGION(0xFF80, 0x003F) },
+
+    { "memory_write", "rom (bank select)",  bench_memory_write, setup_memory, REGION(0x2000, 0x00FF) },
+    { "memory_write", "vram",               bench_memory_write, setup_memory, REGION(0x8000, 0x1FFF) },
+    { "memory_write", "sram",               bench_memory_write, setup_memory, REGION(0xA000, 0x1FFF) },
+    { "memory_write", "wram",               bench_memory_write, setup_memory, REGION(0xC000, 0x1FFF) },
+    { "memory_write", "oam",                bench_memory_write, setup_memory, REGION(0xFE00, 0x007F) },
+    { "memory_write", "io (scroll)",        bench_memory_write, setup_memory, REGION(0xFF42, 0x0001) },
+    { "memory_write", "hram",               bench_memory_write, setup_memory, REGION(0xFF80, 0x003F) },
+
+    { "execute",      "nop",                bench_execute,      setup_cpu,    0x00 },
+    { "execute",      "ld r, r",            bench_execute,      setup_cpu,    0x78 },
+    { "execute",      "ld r, n",            bench_execute,      setup_cpu,    0x06 },
+    { "execute",      "ld (hl), r",         bench_execute,      setup_cpu,    0x77 },
+    { "execute",      "ld a, (nn)",         bench_execute,      setup_cpu,    0xFA },
+    { "execute",      "alu r",              bench_execute,      setup_cpu,    0x80 },
+    { "execute",      "alu (hl)",           bench_execute,      setup_cpu,    0x86 },
+    { "execute",      "alu n",              bench_execute,      setup_cpu,    0xC6 },
+    { "execute",      "inc rr",             bench_execute,      setup_cpu,    0x03 },
+    { "execute",      "jr e",               bench_execute,      setup_cpu,    0x18 },
+    { "execute",      "jp nn",              bench_execute,      setup_cpu,    0xC3 },
+    { "execute",      "call nn",            bench_execute,      setup_cpu,    0xCD },
+    { "execute",      "ret",                bench_execute,      setup_cpu,    0xC9 },
+    { "execute",      "push rr",            bench_execute,      setup_cpu,    0xC5 },
+    { "execute",      "pop rr",             bench_execute,      setup_cpu,    0xC1 },
+
+    { "execute_cb",   "rlc r",              bench_execute_cb,   setup_cpu,    0x00 },
+    { "execute_cb",   "srl (hl)",           bench_execute_cb,   setup_cpu,    0x3E },
+    { "execute_cb",   "swap r",             bench_execute_cb,   setup_cpu,    0x37 },
+    { "execute_cb",   "bit n, r",           bench_execute_cb,   setup_cpu,    0x7C },
+    { "execute_cb",   "res n, (hl)",        bench_execute_cb,   setup_cpu,    0x86 },
+    { "execute_cb",   "set n, r",           bench_execute_cb,   setup_cpu,    0xFF },
+
+    { "draw_scanline", "bg",                bench_draw_scanline, setup_ppu,   0x91 },
+    { "draw_scanline", "bg signed tiles",   bench_draw_scanline, setup_ppu,   0x81 },
+    { "draw_scanline", "bg+window",         bench_draw_scanline, setup_ppu,   0xB1 },
+    { "draw_scanline", "bg+10 sprites",     bench_draw_scanline, setup_ppu,   0x93 },
+    { "draw_scanline", "bg+10 sprites 8x16", bench_draw_scanline, setup_ppu,  0x97 },
+    { "draw_scanline", "bg+window+sprites", bench_draw_scanline, setup_ppu,   0xB7 },
+
+    { "timer_update", "disabled",           bench_timer_update, setup_timer,  0x00 },
+    { "timer_update", "262144 Hz",          bench_timer_update, setup_timer,  0x05 },
+
+    { "convert_framebuffer", "frame",       bench_convert_framebuffer, setup_framebuffer, 0 },
+
+    { "mixer",        "add_delta",          bench_mixer_add_delta, setup_mixer, 48000 },
+    { "mixer",        "end_frame 48 kHz",   bench_mixer_end_frame, setup_mixer, 48000 },
+};
+
+#define BENCH_COUNT (sizeof(BENCHES) / sizeof(BENCHES[0]))
+
+// the subsystem each group belongs to in the regression report
+static const char* subsystem_of(const char* group)
+{
+    if (strncmp(group, "memory", 6) == 0)
+        return "memory";
+    if (strncmp(group, "execute", 7) == 0)
+        return "cpu";
+    if (strcmp(group, "timer_update") == 0)
+        return "timer";
+    if (strcmp(group, "mixer") == 0)
+        return "apu";
+
+    return "ppu";
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t time_run(const MicroBench* bench, BenchContext* ctx, uint32_t iterations)
+{
+    uint64_t start = pacer_now_ns();
+    bench->run(ctx, iterations);
+    return pacer_now_ns() - start;
+}
+
+// doubles the iteration count until one sample is long enough to time reliably
+static uint32_t calibrate(const MicroBench* bench, BenchContext* ctx)
+{
+    uint32_t iterations = 1;
+    while (iterations < MAX_ITERATIONS && time_run(bench, ctx, iterations) < SAMPLE_NS)
+        iterations *= 2;
+
+    return iterations;
+}
+
+static void run_bench(const MicroBench* bench, uint32_t repetitions, FILE* json, FILE* samples_file, uint8_t first)
+{
+    BenchContext* ctx = (BenchContext*) malloc(sizeof(BenchContext));
+    memset(ctx, 0, sizeof(BenchContext));
+
+    ctx->gb = gameboy_init();
+    ctx->param = bench->param;
+    bench->setup(ctx, bench->param);
+
+    uint32_t iterations = calibrate(bench, ctx);
+
+    for (uint32_t i = 0; i < WARMUP_SAMPLES; i++)
+        time_run(bench, ctx, iterations);
+
+    double samples[SAMPLES_MAX];
+    double mean = 0.0, m2 = 0.0;
+
+    for (uint32_t i = 0; i < repetitions; i++)
+    {
+        samples[i] = (double)time_run(bench, ctx, iterations) / iterations;
+
+        double delta = samples[i] - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (samples[i] - mean);
+    }
+
+    qsort(samples, repetitions, sizeof(double), compare_doubles);
+
+    if (samples_file != NULL)
+    {
+        char name[96];
+        snprintf(name, sizeof(name), "%s/%s", bench->group, bench->name);
+        samples_write(samples_file, subsystem_of(bench->group), name, "ns/op", samples, repetitions);
+    }
+
+    double median = samples[repetitions / 2];
+    double stddev = repetitions > 1 ? sqrt(m2 / (repetitions - 1)) : 0.0;
+
+    printf("%-20s %-20s %12.2f %12.2f %10.2f %9.1f%%\n",
+        bench->group, bench->name, median, samples[0], stddev, mean > 0 ? stddev / mean * 100.0 : 0.0);
+
+    if (json != NULL)
+        fprintf(json, "%s    {\"group\": \"%s\", \"name\": \"%s\", \"median_ns\": %.3f, \"min_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"repetitions\": %u}",
+            first ? "" : ",\n", bench->group, bench->name, median, samples[0], mean, stddev, repetitions);
+
+    if (ctx->mixer != NULL)
+        mixer_free(ctx->mixer);
+    gameboy_free(ctx->gb);
+    free(ctx);
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    const char* json_path = NULL;
+    const char* samples_path = NULL;
+    uint32_t repetitions = REPETITIONS;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--filter") == 0)
+            filter = argv[i + 1];
+        else if (strcmp(argv[i], "--json") == 0)
+            json_path = argv[i + 1];
+        else if (strcmp(argv[i], "--samples") == 0)
+            samples_path = argv[i + 1];
+        else if (strcmp(argv[i], "--repetitions") == 0)
+            repetitions = atoi(argv[i + 1]);
+    }
+
+    if (repetitions < 1)
+        repetitions = 1;
+    if (repetitions > SAMPLES_MAX)
+        repetitions = SAMPLES_MAX;
+
+    FILE* samples = NULL;
+    if (samples_path != NULL && (samples = fopen(samples_path, "w")) == NULL)
+    {
+        fprintf(stderr, "microbench: couldn't write %s\n", samples_path);
+        return 1;
+    }
+
+    FILE* json = NULL;
+    if (json_path != NULL)
+    {
+        json = fopen(json_path, "w");
+        if (json == NULL)
+        {
+            fprintf(stderr, "microbench: couldn't write %s\n", json_path);
+            return 1;
+        }
+
+        fprintf(json, "{\n  \"benchmarks\": [\n");
+    }
+
+    printf("%-20s %-20s %12s %12s %10s %10s\n", "group", "case", "median ns", "min ns", "stddev", "cv");
+
+    uint8_t first = 1;
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+    {
+        const MicroBench* bench = &BENCHES[i];
+        if (filter != NULL && strstr(bench->group, filter) == NULL && strstr(bench->name, filter) == NULL)
+            continue;
+
+        run_bench(bench, repetitions, json, samples, first);
+        first = 0;
+    }
+
+    if (samples != NULL)
+        fclose(samples);
+
+    if (json != NULL)
+    {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+
+    return 0;
+}
\ No newline at end of file
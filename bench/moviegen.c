@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../inc/gameboy.h"
+#include "../inc/movie.h"
+#include "../inc/rom.h"
+
+// records an input movie for one of the romgen cartridges, so movie driven workloads
+// don't depend on a recording that has to be shipped and kept in step with the
+// emulator. the input is a fixed script, the per-frame checksums come from the
+// build that will replay it
+
+#define HOLD_FRAMES 20  // frames between input changes, like a player's
+
+static uint32_t lcg(uint32_t* state)
+{
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 16;
+}
+
+// a direction or none, a held most of the time, b now and then. active low
+static uint8_t script_buttons(uint32_t* seed)
+{
+    static const uint8_t DIRECTIONS[] = {
+        0, KEY_RIGHT, KEY_LEFT, KEY_UP, KEY_DOWN,
+        KEY_RIGHT | KEY_UP, KEY_RIGHT | KEY_DOWN, KEY_LEFT | KEY_UP, KEY_LEFT | KEY_DOWN
+    };
+
+    uint32_t roll = lcg(seed);
+    uint8_t pressed = DIRECTIONS[roll % 9];
+
+    if (roll & 0x300)
+        pressed |= KEY_A << 4;
+    if ((roll & 0xC00) == 0)
+        pressed |= KEY_B << 4;
+
+    return INPUT_RELEASED & ~pressed;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "usage: moviegen <rom> <movie> <frames>\n");
+        return 2;
+    }
+
+    uint32_t frames = atoi(argv[3]);
+
+    GameBoy* gb = gameboy_init();
+    load_rom(gb->mem, argv[1]);
+
+    Movie* movie = movie_init();
+    movie_record_start(movie, gb);
+
+    uint32_t seed = 0x5EED;
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        // changes land anywhere inside the frame, the way a polled keyboard's do
+        if (frame % HOLD_FRAMES == 0)
+        {
+            uint64_t cycle = gb->mem->cycles + lcg(&seed) % LCD_FRAME_TICKS;
+            uint8_t buttons = script_buttons(&seed);
+
+            input_queue_push(&gb->input, cycle, buttons);
+            movie_record_input(movie, cycle, buttons);
+        }
+
+        gameboy_run_frame(gb);
+        movie_record_frame(movie, gb);
+    }
+
+    uint8_t ok = movie_write_file(movie, argv[2]);
+    if (!ok)
+        fprintf(stderr, "moviegen: couldn't write %s\n", argv[2]);
+
+    movie_free(movie);
+    gameboy_free(gb);
+
+    return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "samples.h"
+
+// compares benchmark samples against a stored baseline. every benchmark gets a
+// welch t-test on its run times, holm corrected since dozens of them are tested
+// at once; a change only counts when it is both significant and larger than the
+// noise threshold. exits non-zero if anything got slower
+
+#define MAX_SETS        256
+#define DEFAULT_ALPHA   0.05
+#define DEFAULT_PERCENT 5.0
+
+typedef struct {
+    SampleSet* sets;
+    uint32_t count;
+} SampleFile;
+
+typedef struct {
+    double mean;
+    double variance;
+} Moments;
+
+typedef enum {
+    SAME,
+    FASTER,
+    SLOWER
+} Verdict;
+
+static const char* VERDICT_NAMES[] = { "~", "faster", "SLOWER" };
+
+static uint32_t read_samples(const char* path, SampleFile* file)
+{
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "regress: couldn't read %s\n", path);
+        return 0;
+    }
+
+    char line[8192];
+    uint32_t read = 0;
+
+    while (file->count < MAX_SETS && fgets(line, sizeof(line), f) != NULL)
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        SampleSet* set = &file->sets[file->count];
+        int offset = 0;
+        if (sscanf(line, "%31s %95s %15s %u%n", set->subsystem, set->name, set->unit, &set->count, &offset) != 4)
+            continue;
+
+        if (set->count > SAMPLES_MAX)
+            set->count = SAMPLES_MAX;
+
+        char* cursor = line + offset;
+        uint32_t parsed = 0;
+        while (parsed < set->count)
+        {
+            char* end;
+            double value = strtod(cursor, &end);
+            if (end == cursor)
+                break;
+
+            set->samples[parsed++] = value;
+            cursor = end;
+        }
+
+        set->count = parsed;
+        file->count++;
+        read++;
+    }
+
+    fclose(f);
+
+    return read;
+}
+
+static SampleSet* find_set(SampleFile* file, const char* name)
+{
+    for (uint32_t i = 0; i < file->count; i++)
+        if (strcmp(file->sets[i].name, name) == 0)
+            return &file->sets[i];
+
+    return NULL;
+}
+
+static Moments moments(const SampleSet* set)
+{
+    Moments m = { 0.0, 0.0 };
+    for (uint32_t i = 0; i < set->count; i++)
+    {
+        double delta = set->samples[i] - m.mean;
+        m.mean += delta / (i + 1);
+        m.variance += delta * (set->samples[i] - m.mean);
+    }
+
+    m.variance = set->count > 1 ? m.variance / (set->count - 1) : 0.0;
+
+    return m;
+}
+
+// continued fraction for the regularized incomplete beta function
+static double beta_continued_fraction(double a, double b, double x)
+{
+    const double tiny = 1e-300;
+    double qab = a + b, qap = a + 1.0, qam = a - 1.0;
+    double c = 1.0, d = 1.0 - qab * x / qap;
+
+    d = fabs(d) < tiny ? tiny : d;
+    d = 1.0 / d;
+    double h = d;
+
+    for (int m = 1; m <= 300; m++)
+    {
+        int m2 = 2 * m;
+        double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+        d = 1.0 + aa * d;
+        d = fabs(d) < tiny ? tiny : d;
+        c = 1.0 + aa / c;
+        c = fabs(c) < tiny ? tiny : c;
+        d = 1.0 / d;
+        h *= d * c;
+
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+        d = 1.0 + aa * d;
+        d = fabs(d) < tiny ? tiny : d;
+        c = 1.0 + aa / c;
+        c = fabs(c) < tiny ? tiny : c;
+        d = 1.0 / d;
+
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.0) < 1e-12)
+            break;
+    }
+
+    return h;
+}
+
+static double incomplete_beta(double a, double b, double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    if (x >= 1.0)
+        return 1.0;
+
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+
+    if (x < (a + 1.0) / (a + b + 2.0))
+        return front * beta_continued_fraction(a, b, x) / a;
+
+    return 1.0 - front * beta_continued_fraction(b, a, 1.0 - x) / b;
+}
+
+// two-sided p-value of student's t with df degrees of freedom
+static double t_test_p(double t, double df)
+{
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+// t such that the two-sided tail probability is alpha
+static double t_critical(double alpha, double df)
+{
+    double low = 0.0, high = 1000.0;
+    for (int i = 0; i < 100; i++)
+    {
+        double mid = (low + high) / 2.0;
+        if (t_test_p(mid, df) > alpha)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    return (low + high) / 2.0;
+}
+
+typedef struct {
+    SampleSet* base;
+    SampleSet* current;
+    double throughput;       // relative change, positive is faster
+    double throughput_low;   // confidence interval of the change
+    double throughput_high;
+    double p;                // holm adjusted once every benchmark is compared
+    Verdict verdict;
+} Comparison;
+
+static Comparison compare(SampleSet* base, SampleSet* current, double alpha)
+{
+    Moments a = moments(base);
+    Moments b = moments(current);
+
+    double diff = b.mean - a.mean;
+    double se = sqrt(a.variance / base->count + b.variance / current->count);
+
+    Comparison c;
+    c.base = base;
+    c.current = current;
+    c.throughput = a.mean / b.mean - 1.0;
+
+    if (base->count < 2 || current->count < 2)
+    {
+        // a single sample can't say anything about noise
+        c.p = 1.0;
+        c.throughput_low = c.throughput_high = c.throughput;
+    }
+    else if (se == 0.0)
+    {
+        c.p = diff == 0.0 ? 1.0 : 0.0;
+        c.throughput_low = c.throughput_high = c.throughput;
+    }
+    else
+    {
+        double va = a.variance / base->count, vb = b.variance / current->count;
+        double df = (va + vb) * (va + vb) / (va * va / (base->count - 1) + vb * vb / (current->count - 1));
+        double margin = t_critical(alpha, df) * se;
+
+        c.p = t_test_p(diff / se, df);
+
+        // times and throughput move in opposite directions
+        c.throughput_low = a.mean / (b.mean + margin) - 1.0;
+        c.throughput_high = b.mean - margin > 0.0 ? a.mean / (b.mean - margin) - 1.0 : INFINITY;
+    }
+
+    return c;
+}
+
+static int compare_p(const void* a, const void* b)
+{
+    double x = (*(Comparison* const*)a)->p;
+    double y = (*(Comparison* const*)b)->p;
+    return (x > y) - (x < y);
+}
+
+// holm-bonferroni: the i-th smallest of m p-values is scaled by m - i, and
+// adjusted values are kept monotonic
+static void holm_adjust(Comparison* comparisons, uint32_t count)
+{
+    Comparison** sorted = (Comparison**) malloc(count * sizeof(Comparison*));
+    for (uint32_t i = 0; i < count; i++)
+        sorted[i] = &comparisons[i];
+
+    qsort(sorted, count, sizeof(Comparison*), compare_p);
+
+    double running = 0.0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double adjusted = fmin(1.0, sorted[i]->p * (count - i));
+        running = fmax(running, adjusted);
+        sorted[i]->p = running;
+    }
+
+    free(sorted);
+}
+
+typedef struct {
+    char name[32];
+    double log_ratio_sum;
+    uint32_t count;
+    uint32_t slower;
+    uint32_t faster;
+} SubsystemSummary;
+
+static SubsystemSummary* find_subsystem(SubsystemSummary* summaries, uint32_t* count, const char* name)
+{
+    for (uint32_t i = 0; i < *count; i++)
+        if (strcmp(summaries[i].name, name) == 0)
+            return &summaries[i];
+
+    SubsystemSummary* summary = &summaries[(*count)++];
+    memset(summary, 0, sizeof(SubsystemSummary));
+    snprintf(summary->name, sizeof(summary->name), "%s", name);
+
+    return summary;
+}
+
+int main(int argc, char** argv)
+{
+    double alpha = DEFAULT_ALPHA;
+    double percent = DEFAULT_PERCENT;
+    const char* paths[16];
+    uint32_t path_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+            alpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            percent = atof(argv[++i]);
+        else if (path_count < 16)
+            paths[path_count++] = argv[i];
+    }
+
+    if (path_count < 2)
+    {
+        fprintf(stderr, "usage: regress [--alpha p] [--threshold percent] <baseline> <samples>...\n");
+        return 2;
+    }
+
+    SampleFile baseline = { calloc(MAX_SETS, sizeof(SampleSet)), 0 };
+    SampleFile current = { calloc(MAX_SETS, sizeof(SampleSet)), 0 };
+
+    if (!read_samples(paths[0], &baseline))
+        return 2;
+
+    for (uint32_t i = 1; i < path_count; i++)
+        read_samples(paths[i], &current);
+
+    Comparison* comparisons = (Comparison*) malloc(MAX_SETS * sizeof(Comparison));
+    uint32_t comparison_count = 0;
+
+    for (uint32_t i = 0; i < current.count; i++)
+    {
+        SampleSet* now = &current.sets[i];
+        SampleSet* base = find_set(&baseline, now->name);
+
+        if (base == NULL)
+            printf("%-11s %-36s %12s %12.1f\n", now->subsystem, now->name, "new", moments(now).mean);
+        else if (base->count > 0 && now->count > 0)
+            comparisons[comparison_count++] = compare(base, now, alpha);
+    }
+
+    holm_adjust(comparisons, comparison_count);
+
+    SubsystemSummary summaries[64];
+    uint32_t summary_count = 0;
+    uint32_t regressions = 0;
+
+    printf("%-11s %-36s %12s %12s %9s %21s %8s  %s\n",
+        "subsystem", "benchmark", "baseline", "current", "change", "95% interval", "p", "");
+
+    for (uint32_t i = 0; i < comparison_count; i++)
+    {
+        Comparison* c = &comparisons[i];
+
+        c->verdict = SAME;
+        if (c->p < alpha && fabs(c->throughput) * 100.0 >= percent)
+            c->verdict = c->throughput > 0.0 ? FASTER : SLOWER;
+
+        char interval[32];
+        snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", c->throughput_low * 100.0, c->throughput_high * 100.0);
+
+        printf("%-11s %-36s %12.1f %12.1f %+8.1f%% %21s %8.4f  %s\n",
+            c->current->subsystem, c->current->name, moments(c->base).mean, moments(c->current).mean,
+            c->throughput * 100.0, interval, c->p, VERDICT_NAMES[c->verdict]);
+
+        SubsystemSummary* summary = find_subsystem(summaries, &summary_count, c->current->subsystem);
+        summary->log_ratio_sum += log(1.0 + c->throughput);
+        summary->count++;
+        summary->slower += c->verdict == SLOWER;
+        summary->faster += c->verdict == FASTER;
+
+        regressions += c->verdict == SLOWER;
+    }
+
+    for (uint32_t i = 0; i < baseline.count; i++)
+        if (find_set(&current, baseline.sets[i].name) == NULL)
+            printf("%-11s %-36s %12.1f %12s\n", baseline.sets[i].subsystem, baseline.sets[i].name, moments(&baseline.sets[i]).mean, "missing");
+
+    // geometric mean of the throughput ratios per subsystem
+    printf("\n%-11s %10s %8s %8s %8s\n", "subsystem", "throughput", "cases", "faster", "slower");
+    for (uint32_t i = 0; i < summary_count; i++)
+    {
+        SubsystemSummary* s = &summaries[i];
+        printf("%-11s %+9.1f%% %8u %8u %8u\n", s->name, (exp(s->log_ratio_sum / s->count) - 1.0) * 100.0, s->count, s->faster, s->slower);
+    }
+
+    printf("\n%u significant regression%s (alpha %.3f, threshold %.1f%%)\n", regressions, regressions == 1 ? "" : "s", alpha, percent);
+
+    free(comparisons);
+    free(baseline.sets);
+    free(current.sets);
+
+    return regressions > 0 ? 1 : 0;
+}
\ No newline at end of file
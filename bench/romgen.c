@@ -0,0 +1,725 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+// assembles small, valid cartridges that each stress one path of the emulator, so
+// benchmarks and behaviour comparisons don't depend on roms we can't ship.
+// every rom boots the same way: lcd off at vblank, tiles, maps and palettes
+// loaded, then the workload specific setup and main loop
+
+#define BANK_SIZE 0x4000
+
+// fixed layout of bank 0
+#define VECTOR_VBLANK 0x0040
+#define VECTOR_STAT   0x0048
+#define ENTRY         0x0100
+#define LOGO          0x0104
+#define MAIN          0x0150
+#define ROUTINES      0x0800
+#define SINE_TABLE    0x0E00  // page aligned so handlers can index it with l alone
+#define OAM_TABLE     0x0F00
+#define TILE_DATA     0x1000
+#define TILE_MAPS     0x1800
+
+#define HRAM_DMA      0xFF80  // oam dma routine
+#define HRAM_FRAME    0xFFA0  // frame counter
+#define SHADOW_OAM    0xC100
+
+#define CART_ROM      0x00
+#define CART_MBC1     0x01
+
+typedef enum { JR, JR_NZ, JR_Z, JR_NC, JR_C } JumpCondition;
+
+static const uint8_t JR_OPCODES[] = { 0x18, 0x20, 0x28, 0x30, 0x38 };
+
+static const uint8_t NINTENDO_LOGO[48] = {
+    0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+    0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+    0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E
+};
+
+typedef struct {
+    uint8_t* rom;
+    uint32_t size;
+    uint32_t pos;  // file offset of the next byte
+} Assembler;
+
+typedef struct {
+    uint16_t copy;         // hl = dst, de = src, bc = count
+    uint16_t fill;         // hl = dst, bc = count, d = value
+    uint16_t lcd_off;      // waits for vblank, then turns the lcd off
+    uint16_t dma_routine;  // rom copy of the hram dma routine
+} Routines;
+
+#define EMIT(a, ...) asm_bytes(a, (const uint8_t[]){ __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ }))
+#define LO(x) ((x) & 0xFF)
+#define HI(x) (((x) >> 8) & 0xFF)
+
+static void asm_bytes(Assembler* a, const uint8_t* bytes, uint32_t count)
+{
+    if (a->pos + count > a->size)
+    {
+        fprintf(stderr, "romgen: rom overflow at %06X\n", a->pos);
+        exit(1);
+    }
+
+    memcpy(&a->rom[a->pos], bytes, count);
+    a->pos += count;
+}
+
+static void asm_org(Assembler* a, uint32_t pos)
+{
+    a->pos = pos;
+}
+
+// cpu address of the next byte, banked code runs at 0x4000
+static uint16_t asm_here(Assembler* a)
+{
+    return a->pos < BANK_SIZE ? a->pos : BANK_SIZE + (a->pos % BANK_SIZE);
+}
+
+static void asm_jr(Assembler* a, JumpCondition condition, uint16_t target)
+{
+    int32_t offset = (int32_t)target - (asm_here(a) + 2);
+    if (offset < -128 || offset > 127)
+    {
+        fprintf(stderr, "romgen: relative jump out of range at %06X\n", a->pos);
+        exit(1);
+    }
+
+    EMIT(a, JR_OPCODES[condition], (uint8_t)offset);
+}
+
+static void asm_jp(Assembler* a, uint16_t target) { EMIT(a, 0xC3, LO(target), HI(target)); }
+static void asm_call(Assembler* a, uint16_t target) { EMIT(a, 0xCD, LO(target), HI(target)); }
+
+static void asm_ld_bc(Assembler* a, uint16_t value) { EMIT(a, 0x01, LO(value), HI(value)); }
+static void asm_ld_de(Assembler* a, uint16_t value) { EMIT(a, 0x11, LO(value), HI(value)); }
+static void asm_ld_hl(Assembler* a, uint16_t value) { EMIT(a, 0x21, LO(value), HI(value)); }
+
+static void asm_copy(Assembler* a, Routines* r, uint16_t dst, uint16_t src, uint16_t count)
+{
+    asm_ld_hl(a, dst);
+    asm_ld_de(a, src);
+    asm_ld_bc(a, count);
+    asm_call(a, r->copy);
+}
+
+static void asm_fill(Assembler* a, Routines* r, uint16_t dst, uint8_t value, uint16_t count)
+{
+    asm_ld_hl(a, dst);
+    asm_ld_bc(a, count);
+    EMIT(a, 0x16, value);           // ld d, value
+    asm_call(a, r->fill);
+}
+
+// ldh (reg), value
+static void asm_set_io(Assembler* a, uint8_t reg, uint8_t value)
+{
+    EMIT(a, 0x3E, value, 0xE0, reg);
+}
+
+// data and shared subroutines
+
+static void emit_tiles(Assembler* a)
+{
+    // 16 tiles: stripes, checkers, gradients and noise so every shade shows up
+    uint32_t seed = 0x1234;
+    for (uint8_t tile = 0; tile < 16; tile++)
+    {
+        for (uint8_t row = 0; row < 8; row++)
+        {
+            uint8_t lo, hi;
+            switch (tile & 3)
+            {
+                case 0:  lo = 0xFF >> row; hi = 0xFF << row; break;
+                case 1:  lo = (row & 1) ? 0xAA : 0x55; hi = (row & 2) ? 0xCC : 0x33; break;
+                case 2:  lo = row * 0x21 + tile; hi = ~lo; break;
+                default: seed = seed * 1103515245 + 12345; lo = seed >> 16; hi = seed >> 24; break;
+            }
+
+            a->rom[TILE_DATA + tile * 16 + row * 2] = lo;
+            a->rom[TILE_DATA + tile * 16 + row * 2 + 1] = hi;
+        }
+    }
+
+    // background map at 0x9800 and window map at 0x9C00
+    for (uint16_t i = 0; i < 0x800; i++)
+    {
+        uint8_t x = i % 32, y = (i / 32) % 32;
+        a->rom[TILE_MAPS + i] = i < 0x400 ? (x + y * 3) & 0x0F : (x ^ y) & 0x0F;
+    }
+
+    for (uint8_t i = 0; i < 64; i++)
+        a->rom[SINE_TABLE + i] = (uint8_t)(int)lround(8.0 + 8.0 * sin(i * 2.0 * M_PI / 64.0));
+}
+
+static void emit_routines(Assembler* a, Routines* r)
+{
+    asm_org(a, ROUTINES);
+
+    r->copy = asm_here(a);
+    EMIT(a,
+        0x1A,           // ld a, (de)
+        0x13,           // inc de
+        0x22,           // ld (hl+), a
+        0x0B,           // dec bc
+        0x78,           // ld a, b
+        0xB1);          // or c
+    asm_jr(a, JR_NZ, r->copy);
+    EMIT(a, 0xC9);      // ret
+
+    r->fill = asm_here(a);
+    EMIT(a,
+        0x7A,           // ld a, d
+        0x22,           // ld (hl+), a
+        0x0B,           // dec bc
+        0x78,           // ld a, b
+        0xB1);          // or c
+    asm_jr(a, JR_NZ, r->fill);
+    EMIT(a, 0xC9);      // ret
+
+    r->lcd_off = asm_here(a);
+    EMIT(a,
+        0xF0, 0x44,     // ldh a, (LY)
+        0xFE, 0x90);    // cp 144
+    asm_jr(a, JR_NZ, r->lcd_off);
+    EMIT(a,
+        0xAF,           // xor a
+        0xE0, 0x40,     // ldh (LCDC), a
+        0xC9);          // ret
+
+    // copied to hram: starts a dma from page a and waits the 160 us out
+    r->dma_routine = asm_here(a);
+    EMIT(a,
+        0xE0, 0x46,     // ldh (DMA), a
+        0x3E, 0x28,     // ld a, 40
+        0x3D,           // wait: dec a
+        0x20, 0xFD,     // jr nz, wait
+        0xC9);          // ret
+}
+
+// everything up to the workload's own setup, emitted at MAIN
+static void emit_boot(Assembler* a, Routines* r)
+{
+    asm_org(a, ENTRY);
+    EMIT(a, 0x00);      // nop
+    asm_jp(a, MAIN);
+
+    asm_org(a, MAIN);
+    EMIT(a,
+        0xF3,           // di
+        0x31, 0xFE, 0xFF);  // ld sp, $fffe
+    asm_call(a, r->lcd_off);
+
+    asm_copy(a, r, 0x8000, TILE_DATA, 0x100);
+    asm_copy(a, r, 0x9800, TILE_MAPS, 0x800);
+    asm_fill(a, r, 0xFE00, 0x00, 0xA0);
+    asm_fill(a, r, 0xC000, 0x00, 0x2000);
+    asm_copy(a, r, HRAM_DMA, r->dma_routine, 8);
+
+    asm_set_io(a, 0x47, 0xE4);  // bgp
+    asm_set_io(a, 0x48, 0xD2);  // obp0
+    asm_set_io(a, 0x49, 0x1B);  // obp1
+    asm_set_io(a, 0x0F, 0x00);  // if
+    asm_set_io(a, LO(HRAM_FRAME), 0x00);
+}
+
+static void emit_lcd_on(Assembler* a, uint8_t lcdc)
+{
+    asm_set_io(a, 0x40, lcdc);
+}
+
+// halt until the next interrupt, and go back to halting unless it was vblank
+static uint16_t emit_wait_vblank(Assembler* a)
+{
+    uint16_t loop = asm_here(a);
+    EMIT(a,
+        0x76,           // halt
+        0x00,           // nop
+        0xF0, 0x44,     // ldh a, (LY)
+        0xFE, 0x90);    // cp 144
+    asm_jr(a, JR_C, loop);
+
+    return loop;
+}
+
+// the workloads
+
+static void workload_alu(Assembler* a, Routines* r)
+{
+    emit_lcd_on(a, 0x91);
+    asm_ld_bc(a, 0x1234);
+    asm_ld_de(a, 0x5678);
+    asm_ld_hl(a, 0xC000);
+
+    uint16_t loop = asm_here(a);
+    EMIT(a,
+        0x78,           // ld a, b
+        0x81,           // add a, c
+        0x47,           // ld b, a
+        0x8A,           // adc a, d
+        0xAB,           // xor e
+        0x5F,           // ld e, a
+        0x90,           // sub b
+        0x99,           // sbc a, c
+        0xA2,           // and d
+        0xB3,           // or e
+        0xBC,           // cp h
+        0x14,           // inc d
+        0x0D,           // dec c
+        0x07,           // rlca
+        0xCE, 0x11,     // adc a, $11
+        0xD6, 0x05,     // sub $05
+        0x22,           // ld (hl+), a
+        0x7C,           // ld a, h
+        0xE6, 0x0F,     // and $0f
+        0xF6, 0xC0,     // or $c0
+        0x67);          // ld h, a
+    asm_jr(a, JR, loop);
+}
+
+static void workload_cb_ops(Assembler* a, Routines* r)
+{
+    emit_lcd_on(a, 0x91);
+    asm_ld_bc(a, 0x8143);
+    asm_ld_de(a, 0x2A7E);
+    asm_ld_hl(a, 0xC000);
+
+    uint16_t loop = asm_here(a);
+    EMIT(a,
+        0xCB, 0x00,     // rlc b
+        0xCB, 0x09,     // rrc c
+        0xCB, 0x12,     // rl d
+        0xCB, 0x1B,     // rr e
+        0xCB, 0x27,     // sla a
+        0xCB, 0x28,     // sra b
+        0xCB, 0x31,     // swap c
+        0xCB, 0x3A,     // srl d
+        0xCB, 0x5B,     // bit 3, e
+        0xCB, 0xEF,     // set 5, a
+        0xCB, 0x90,     // res 2, b
+        0xCB, 0x06,     // rlc (hl)
+        0xCB, 0x36,     // swap (hl)
+        0xCB, 0xFE,     // set 7, (hl)
+        0xCB, 0x86,     // res 0, (hl)
+        0xCB, 0x76,     // bit 6, (hl)
+        0x2C);          // inc l
+    asm_jr(a, JR, loop);
+}
+
+// 1 MB, 64 banks; every bank is summed in turn, switching both bank registers
+static void workload_mbc1_banked(Assembler* a, Routines* r)
+{
+    for (uint32_t bank = 1; bank < a->size / BANK_SIZE; bank++)
+        for (uint32_t i = 0; i < BANK_SIZE; i++)
+            a->rom[bank * BANK_SIZE + i] = (uint8_t)(bank * 7 + i * 13 + (i >> 8));
+
+    emit_lcd_on(a, 0x91);
+    EMIT(a,
+        0xAF,           // xor a
+        0xEA, 0x00, 0x60);  // ld ($6000), a: rom banking mode
+
+    uint16_t outer = asm_here(a);
+    EMIT(a, 0x0E, 0x01);    // ld c, 1
+
+    uint16_t bank_loop = asm_here(a);
+    EMIT(a,
+        0x79,           // ld a, c
+        0xE6, 0x1F,     // and $1f
+        0xEA, 0x00, 0x20,   // ld ($2000), a
+        0x79,           // ld a, c
+        0x07, 0x07, 0x07,   // rlca x3
+        0xE6, 0x03,     // and 3
+        0xEA, 0x00, 0x40,   // ld ($4000), a
+        0x21, 0x00, 0x40,   // ld hl, $4000
+        0x1E, 0x00,     // ld e, 0
+        0x06, 0x00);    // ld b, 0
+
+    uint16_t read = asm_here(a);
+    EMIT(a,
+        0x2A,           // ld a, (hl+)
+        0x83,           // add a, e
+        0x5F,           // ld e, a
+        0x05);          // dec b
+    asm_jr(a, JR_NZ, read);
+    EMIT(a,
+        0x7B,           // ld a, e
+        0xEA, 0x00, 0xC0,   // ld ($c000), a
+        0x0C,           // inc c
+        0x79,           // ld a, c
+        0xFE, 0x40);    // cp 64
+    asm_jr(a, JR_NZ, bank_loop);
+    asm_jr(a, JR, outer);
+}
+
+static void emit_oam_table(Assembler* a, uint8_t per_band_spacing)
+{
+    // 4 bands of 10 sprites, flips, palettes and one behind the background per band
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        uint8_t band = i / 10, slot = i % 10;
+        uint8_t* sprite = &a->rom[OAM_TABLE + i * 4];
+        sprite[0] = 16 + band * per_band_spacing;
+        sprite[1] = 8 + slot * 16 + band * 4;
+        sprite[2] = slot * 2;
+        sprite[3] = (slot & 3) << 5 | (slot & 1) << 4 | (slot == band ? 0x80 : 0);
+    }
+}
+
+// moves every shadow sprite one pixel right and down
+static void emit_move_sprites(Assembler* a)
+{
+    asm_ld_hl(a, SHADOW_OAM);
+    EMIT(a, 0x06, 40);      // ld b, 40
+
+    uint16_t loop = asm_here(a);
+    EMIT(a,
+        0x34,           // inc (hl): y
+        0x2C,           // inc l
+        0x34,           // inc (hl): x
+        0x2C, 0x2C, 0x2C,   // inc l x3
+        0x05);          // dec b
+    asm_jr(a, JR_NZ, loop);
+}
+
+// back to back dmas from shadow oam with the cpu updating it in between
+static void workload_hram_dma(Assembler* a, Routines* r)
+{
+    emit_oam_table(a, 36);
+    asm_copy(a, r, SHADOW_OAM, OAM_TABLE, 0xA0);
+    emit_lcd_on(a, 0x91);
+
+    uint16_t loop = asm_here(a);
+    emit_move_sprites(a);
+    EMIT(a, 0x3E, HI(SHADOW_OAM));  // ld a, high(shadow oam)
+    asm_call(a, HRAM_DMA);
+    asm_jr(a, JR, loop);
+}
+
+// 8x16 sprites packed 10 to a line, moved and dma'd every vblank
+static void workload_sprites10(Assembler* a, Routines* r)
+{
+    emit_oam_table(a, 16);
+    asm_copy(a, r, SHADOW_OAM, OAM_TABLE, 0xA0);
+
+    asm_set_io(a, 0xFF, 0x01);  // ie: vblank
+    emit_lcd_on(a, 0x97);
+    EMIT(a, 0xFB);              // ei
+
+    uint16_t loop = emit_wait_vblank(a);
+    emit_move_sprites(a);
+    EMIT(a, 0x3E, HI(SHADOW_OAM));  // ld a, high(shadow oam)
+    asm_call(a, HRAM_DMA);
+    asm_jr(a, JR, loop);
+}
+
+// scrolling background, a window status bar and a lyc split that scrolls the
+// lower half the other way
+static void workload_window_scroll(Assembler* a, Routines* r)
+{
+    uint32_t main = a->pos;
+
+    asm_org(a, VECTOR_STAT);
+    asm_jp(a, ROUTINES + 0x100);
+
+    asm_org(a, ROUTINES + 0x100);
+    EMIT(a,
+        0xF5,           // push af
+        0xF0, 0xA0,     // ldh a, (frame)
+        0x2F,           // cpl
+        0xE0, 0x43,     // ldh (SCX), a
+        0xF1,           // pop af
+        0xD9);          // reti
+
+    asm_org(a, main);
+    asm_set_io(a, 0x4A, 112);   // wy
+    asm_set_io(a, 0x4B, 7);     // wx
+    asm_set_io(a, 0x45, 64);    // lyc
+    asm_set_io(a, 0x41, 0x40);  // stat: lyc interrupt
+    asm_set_io(a, 0xFF, 0x03);  // ie: vblank, stat
+    emit_lcd_on(a, 0xF1);
+    EMIT(a, 0xFB);              // ei
+
+    uint16_t loop = emit_wait_vblank(a);
+    asm_ld_hl(a, HRAM_FRAME);
+    EMIT(a,
+        0x34,           // inc (hl)
+        0x7E,           // ld a, (hl)
+        0xE0, 0x43,     // ldh (SCX), a
+        0xCB, 0x3F,     // srl a
+        0xE0, 0x42);    // ldh (SCY), a
+    asm_jr(a, JR, loop);
+}
+
+// hblank interrupt on every line bending the background along a sine wave
+static void workload_stat_raster(Assembler* a, Routines* r)
+{
+    uint32_t main = a->pos;
+
+    asm_org(a, VECTOR_STAT);
+    asm_jp(a, ROUTINES + 0x100);
+
+    asm_org(a, ROUTINES + 0x100);
+    EMIT(a,
+        0xF5,           // push af
+        0xE5,           // push hl
+        0xF0, 0x44,     // ldh a, (LY)
+        0x21, LO(HRAM_FRAME), HI(HRAM_FRAME),   // ld hl, frame
+        0x86,           // add a, (hl)
+        0xE6, 0x3F,     // and 63
+        0x6F,           // ld l, a
+        0x26, HI(SINE_TABLE),   // ld h, high(sine)
+        0x7E,           // ld a, (hl)
+        0xE0, 0x43,     // ldh (SCX), a
+        0xE1,           // pop hl
+        0xF1,           // pop af
+        0xD9);          // reti
+
+    asm_org(a, main);
+    asm_set_io(a, 0x41, 0x08);  // stat: hblank interrupt
+    asm_set_io(a, 0xFF, 0x03);  // ie: vblank, stat
+    emit_lcd_on(a, 0x91);
+    EMIT(a, 0xFB);              // ei
+
+    uint16_t loop = emit_wait_vblank(a);
+    asm_ld_hl(a, HRAM_FRAME);
+    EMIT(a, 0x34);              // inc (hl)
+    asm_jr(a, JR, loop);
+}
+
+// all four channels retriggered every frame at a new pitch, like a music driver
+static void workload_sound(Assembler* a, Routines* r)
+{
+    asm_set_io(a, 0x26, 0x80);  // nr52: power on
+    asm_set_io(a, 0x24, 0x77);  // nr50: full volume
+    asm_set_io(a, 0x25, 0xFF);  // nr51: every channel on both sides
+    asm_set_io(a, 0x11, 0x80);  // nr11: 50% duty
+    asm_set_io(a, 0x12, 0xF3);  // nr12: full volume, fading
+    asm_set_io(a, 0x16, 0x40);  // nr21: 25% duty
+    asm_set_io(a, 0x17, 0xA7);
+    asm_set_io(a, 0x1A, 0x80);  // nr30: wave dac on
+    asm_set_io(a, 0x1C, 0x20);  // nr32: full volume
+    asm_copy(a, r, 0xFF30, SINE_TABLE, 16);
+    asm_set_io(a, 0x21, 0xF2);  // nr42
+
+    asm_set_io(a, 0xFF, 0x01);  // ie: vblank
+    emit_lcd_on(a, 0x91);
+    EMIT(a, 0xFB);              // ei
+
+    uint16_t loop = emit_wait_vblank(a);
+    asm_ld_hl(a, HRAM_FRAME);
+    EMIT(a,
+        0x34,           // inc (hl)
+        0x7E,           // ld a, (hl)
+        0xE0, 0x13,     // ldh (NR13), a
+        0x2F,           // cpl
+        0xE0, 0x18,     // ldh (NR23), a
+        0x07,           // rlca
+        0xE0, 0x1D,     // ldh (NR33), a
+        0xE6, 0x77,     // and $77
+        0xE0, 0x22);    // ldh (NR43), a
+    asm_set_io(a, 0x14, 0x86);  // trigger each channel
+    asm_set_io(a, 0x19, 0x87);
+    asm_set_io(a, 0x1E, 0x85);
+    asm_set_io(a, 0x23, 0x80);
+    asm_jr(a, JR, loop);
+}
+
+// reads the joypad every vblank and reacts like a game would: the d-pad scrolls the
+// background, a held A moves and dma's the sprites, B plays a blip. meant to be driven
+// by the input movie bench/moviegen.c records for it
+static void workload_joypad(Assembler* a, Routines* r)
+{
+    uint32_t main = a->pos;
+
+    uint16_t move_sprites = ROUTINES + 0x100;
+    asm_org(a, move_sprites);
+    EMIT(a, 0xC5);                  // push bc: the held buttons
+    emit_move_sprites(a);
+    EMIT(a, 0x3E, HI(SHADOW_OAM));  // ld a, high(shadow oam)
+    asm_call(a, HRAM_DMA);
+    EMIT(a,
+        0xC1,                       // pop bc
+        0xC9);                      // ret
+
+    uint16_t blip = asm_here(a);
+    EMIT(a,
+        0xF0, LO(HRAM_FRAME),   // ldh a, (frame)
+        0xE0, 0x13);            // ldh (NR13), a
+    asm_set_io(a, 0x14, 0x86);  // trigger
+    EMIT(a, 0xC9);              // ret
+
+    asm_org(a, main);
+    emit_oam_table(a, 36);
+    asm_copy(a, r, SHADOW_OAM, OAM_TABLE, 0xA0);
+
+    asm_set_io(a, 0x26, 0x80);  // nr52: power on
+    asm_set_io(a, 0x24, 0x77);  // nr50: full volume
+    asm_set_io(a, 0x25, 0x11);  // nr51: channel 1 on both sides
+    asm_set_io(a, 0x11, 0x80);  // nr11: 50% duty
+    asm_set_io(a, 0x12, 0xF1);  // nr12: full volume, quick fade
+
+    asm_set_io(a, 0xFF, 0x01);  // ie: vblank
+    emit_lcd_on(a, 0x93);
+    EMIT(a, 0xFB);              // ei
+
+    uint16_t loop = emit_wait_vblank(a);
+    asm_ld_hl(a, HRAM_FRAME);
+    EMIT(a,
+        0x34,           // inc (hl)
+
+        // b = buttons held, 1 for pressed: right, left, up, down, a, b, select, start
+        0x3E, 0x20,     // ld a, $20: d-pad
+        0xE0, 0x00,     // ldh (P1), a
+        0xF0, 0x00,     // ldh a, (P1)
+        0xF0, 0x00,     // ldh a, (P1)
+        0x2F,           // cpl
+        0xE6, 0x0F,     // and $0f
+        0x47,           // ld b, a
+        0x3E, 0x10,     // ld a, $10: buttons
+        0xE0, 0x00,     // ldh (P1), a
+        0xF0, 0x00,     // ldh a, (P1)
+        0xF0, 0x00,     // ldh a, (P1)
+        0x2F,           // cpl
+        0xE6, 0x0F,     // and $0f
+        0xCB, 0x37,     // swap a
+        0xB0,           // or b
+        0x47,           // ld b, a
+        0x3E, 0x30,     // ld a, $30
+        0xE0, 0x00,     // ldh (P1), a
+
+        // scx += right - left
+        0x78,           // ld a, b
+        0x0F,           // rrca
+        0xE6, 0x01,     // and 1
+        0x57,           // ld d, a
+        0x78,           // ld a, b
+        0xE6, 0x01,     // and 1
+        0x92,           // sub d
+        0x4F,           // ld c, a
+        0xF0, 0x43,     // ldh a, (SCX)
+        0x81,           // add a, c
+        0xE0, 0x43,     // ldh (SCX), a
+
+        // scy += down - up
+        0x78,           // ld a, b
+        0x0F, 0x0F,     // rrca x2
+        0xE6, 0x01,     // and 1
+        0x57,           // ld d, a
+        0x78,           // ld a, b
+        0x0F, 0x0F, 0x0F,   // rrca x3
+        0xE6, 0x01,     // and 1
+        0x92,           // sub d
+        0x4F,           // ld c, a
+        0xF0, 0x42,     // ldh a, (SCY)
+        0x81,           // add a, c
+        0xE0, 0x42,     // ldh (SCY), a
+
+        0xCB, 0x60,     // bit 4, b
+        0xC4, LO(move_sprites), HI(move_sprites),   // call nz, move sprites
+        0xCB, 0x68,     // bit 5, b
+        0xC4, LO(blip), HI(blip));                  // call nz, blip
+    asm_jr(a, JR, loop);
+}
+
+typedef struct {
+    const char* name;
+    uint8_t cart_type;
+    uint8_t rom_size_code;  // 32 KB << code
+    void (*emit)(Assembler* a, Routines* r);
+} RomSpec;
+
+static const RomSpec ROMS[] = {
+    { "alu",           CART_ROM,  0, workload_alu },
+    { "cb_ops",        CART_ROM,  0, workload_cb_ops },
+    { "mbc1_banked",   CART_MBC1, 5, workload_mbc1_banked },
+    { "hram_dma",      CART_ROM,  0, workload_hram_dma },
+    { "sprites10",     CART_ROM,  0, workload_sprites10 },
+    { "window_scroll", CART_ROM,  0, workload_window_scroll },
+    { "stat_raster",   CART_ROM,  0, workload_stat_raster },
+    { "sound",         CART_ROM,  0, workload_sound },
+    { "joypad",        CART_ROM,  0, workload_joypad },
+};
+
+#define ROM_COUNT (sizeof(ROMS) / sizeof(ROMS[0]))
+
+static void write_header(Assembler* a, const RomSpec* spec)
+{
+    memcpy(&a->rom[LOGO], NINTENDO_LOGO, sizeof(NINTENDO_LOGO));
+
+    char title[16] = { 0 };
+    snprintf(title, sizeof(title), "%s", spec->name);
+    for (uint8_t i = 0; i < 15 && title[i]; i++)
+        a->rom[0x134 + i] = title[i] >= 'a' && title[i] <= 'z' ? title[i] - 32 : title[i];
+
+    a->rom[0x147] = spec->cart_type;
+    a->rom[0x148] = spec->rom_size_code;
+    a->rom[0x149] = 0x00;
+    a->rom[0x14A] = 0x01;   // non-japanese
+
+    uint8_t header_checksum = 0;
+    for (uint16_t i = 0x134; i <= 0x14C; i++)
+        header_checksum = header_checksum - a->rom[i] - 1;
+    a->rom[0x14D] = header_checksum;
+
+    uint16_t global_checksum = 0;
+    for (uint32_t i = 0; i < a->size; i++)
+        if (i != 0x14E && i != 0x14F)
+            global_checksum += a->rom[i];
+    a->rom[0x14E] = HI(global_checksum);
+    a->rom[0x14F] = LO(global_checksum);
+}
+
+static uint8_t build_rom(const RomSpec* spec, const char* dir)
+{
+    Assembler a = { 0 };
+    a.size = 0x8000u << spec->rom_size_code;
+    a.rom = (uint8_t*) malloc(a.size);
+    memset(a.rom, 0xFF, a.size);
+
+    // unused interrupts just return
+    for (uint16_t vector = VECTOR_VBLANK; vector <= 0x60; vector += 8)
+        a.rom[vector] = 0xD9;
+
+    Routines routines;
+    emit_tiles(&a);
+    emit_routines(&a, &routines);
+    emit_boot(&a, &routines);
+    spec->emit(&a, &routines);
+    write_header(&a, spec);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.gb", dir, spec->name);
+
+    FILE* f = fopen(path, "wb");
+    uint8_t ok = f != NULL && fwrite(a.rom, 1, a.size, f) == a.size;
+    if (f != NULL)
+        fclose(f);
+
+    free(a.rom);
+
+    if (!ok)
+        fprintf(stderr, "romgen: couldn't write %s\n", path);
+
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = argc > 1 ? argv[1] : ".";
+    const char* only = argc > 2 ? argv[2] : NULL;
+
+    for (uint32_t i = 0; i < ROM_COUNT; i++)
+    {
+        if (only != NULL && strcmp(only, ROMS[i].name) != 0)
+            continue;
+
+        if (!build_rom(&ROMS[i], dir))
+            return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
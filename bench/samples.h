@@ -0,0 +1,34 @@
+#ifndef BENCH_SAMPLES_H
+#define BENCH_SAMPLES_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// raw measurements shared by the bench binaries and the regression harness, one
+// benchmark per line:
+//   <subsystem> <name> <unit> <count> <sample>...
+// names can't contain whitespace, so it's replaced by '_' on the way out
+
+#define SAMPLES_MAX 256
+
+typedef struct {
+    char subsystem[32];
+    char name[96];
+    char unit[16];
+    uint32_t count;
+    double samples[SAMPLES_MAX];
+} SampleSet;
+
+static inline void samples_write(FILE* f, const char* subsystem, const char* name, const char* unit, const double* samples, uint32_t count)
+{
+    fprintf(f, "%s ", subsystem);
+    for (const char* c = name; *c; c++)
+        fputc(*c == ' ' || *c == '\t' ? '_' : *c, f);
+
+    fprintf(f, " %s %u", unit, count);
+    for (uint32_t i = 0; i < count; i++)
+        fprintf(f, " %.3f", samples[i]);
+    fprintf(f, "\n");
+}
+
+#endif
\ No newline at end of file
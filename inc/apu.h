@@ -0,0 +1,80 @@
+#ifndef APU_H
+#define APU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "memory.h"
+#include "mixer.h"
+
+// the apu isn't stepped with the cpu. it's run up to the current cycle whenever a
+// sound register is accessed and at the end of every frame, so a span between two
+// register writes is synthesized in one go. without a mixer attached only what the
+// registers can observe (length counters, envelopes, sweep, NR52 status) is kept
+// up to date
+
+#define APU_CHANNELS          4
+#define APU_SEQUENCER_TICKS   8192    // frame sequencer, 512 Hz
+
+typedef enum {
+    APU_PULSE1,
+    APU_PULSE2,
+    APU_WAVE,
+    APU_NOISE
+} ApuChannelId;
+
+// what the frame sequencer drives
+typedef struct {
+    uint8_t enabled;        // NR52 status bit
+    uint8_t dac;
+    uint16_t length;        // length steps left
+    uint8_t volume;
+    uint8_t envelope_timer;
+
+    // channel 1 only
+    uint8_t sweep_enabled;
+    uint8_t sweep_timer;
+    uint16_t sweep_frequency;
+} ApuChannel;
+
+// waveform generator, only advanced while synthesizing
+typedef struct {
+    uint32_t timer;         // cycles until the next step
+    uint8_t position;       // duty step or wave ram sample
+    uint16_t lfsr;
+} ApuVoice;
+
+typedef struct Apu {
+    uint64_t time;          // cycle count the apu has been run up to
+    uint64_t frame_start;   // cycle count of the last apu_end_frame
+    uint8_t sequencer_step;
+    ApuChannel channels[APU_CHANNELS];
+
+    ApuVoice voices[APU_CHANNELS];
+
+    // host side
+    Mixer* mixer;           // NULL: no synthesis
+    int32_t emitted[APU_CHANNELS][2]; // each channel's share of the mixer level
+} Apu;
+
+// voices depend on whether synthesis was on, so replays only compare what comes before
+#define APU_CHECKSUM_SIZE offsetof(Apu, voices)
+#define APU_STATE_SIZE    offsetof(Apu, mixer)
+
+Apu* apu_init();
+void apu_free(Apu* apu);
+
+// attaching a mixer turns synthesis on, NULL turns it off
+void apu_set_mixer(Apu* apu, Memory* mem, Mixer* mixer);
+
+void apu_run(Apu* apu, Memory* mem, uint64_t until);
+void apu_end_frame(Apu* apu, Memory* mem);
+
+// FF10-FF3F, reg relative to FF00
+uint8_t apu_read(Apu* apu, Memory* mem, uint8_t reg);
+void apu_write(Apu* apu, Memory* mem, uint8_t reg, uint8_t value);
+
+// after the state was replaced under the apu, e.g. by a save state
+void apu_sync_output(Apu* apu, Memory* mem);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include "../inc/ring.h"
+
+// sdl audio output. the device's callback drains an AudioRing the emulation thread
+// fills once a frame; the pacer keeps the ring near AUDIO_TARGET_FRAMES
+
+#define AUDIO_SAMPLE_RATE   48000
+#define AUDIO_DEVICE_FRAMES 512                         // per callback, ~10.7 ms
+#define AUDIO_TARGET_FRAMES (AUDIO_DEVICE_FRAMES * 2)   // queued latency the pacer aims for
+#define AUDIO_RING_FRAMES   8192
+
+// 0 if there's no usable device, the emulator then runs silent
+uint8_t audio_open(AudioRing* ring, uint32_t sample_rate);
+void audio_close();
+
+// callbacks that found the ring short and had to play silence
+uint64_t audio_underruns();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "memory.h"
+
+// battery-backed cartridge ram kept in a .sav file. the file is mapped private over
+// Memory.sram, so it is read in lazily and savestate loads never reach it. when the
+// game disables cartridge ram after writing to it (which is how games end a save)
+// the contents are snapshotted and a background thread writes them back, so the
+// emulation thread never waits on the disk
+
+typedef struct Battery {
+    int fd;
+    uint8_t* map;       // SRAM_SIZE bytes, the file covers the first `size`
+    size_t size;
+    uint8_t* snapshot;  // last finished save, waiting for the thread
+    uint8_t* writing;   // the thread's copy while it writes
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    uint8_t pending;
+    uint8_t running;
+
+    uint64_t flushes;
+} Battery;
+
+// maps `filename` as the cartridge ram of the loaded rom, NULL when the cartridge
+// has no battery or the file can't be mapped
+Battery* battery_open(Memory* mem, const char* filename);
+
+// called by the mbc when ram gets disabled, copies sram but doesn't touch the disk
+void battery_request_flush(Battery* battery);
+
+// finishes pending saves, writes sram if the game changed it since its last save
+// and gives Memory its own buffer back
+void battery_close(Battery* battery, Memory* mem);
+
+#endif
\ No newline at end of file
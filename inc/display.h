@@ -8,11 +8,19 @@
 
 typedef struct {
     uint8_t is_running;
+    uint8_t vsync;
+    uint8_t rewinding;
+    uint8_t fast_forward;
+    int8_t speed_steps;  // +/- presses since the frontend last consumed them
+    uint8_t overlay;     // telemetry overlay, toggled with F1
 } DisplayContext;
 
 void display_init(DisplayContext* ctx);
 void display_poll(DisplayContext* ctx);
 void display_quit(DisplayContext* ctx);
 void display_render(Ppu* ppu);
+void display_set_overlay(const char* text);
+uint8_t display_read_buttons();
+double display_refresh_rate();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef GAMEBOY_H
+#define GAMEBOY_H
+
+#include <stdint.h>
+
+#include "memory.h"
+#include "input.h"
+#include "timer.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "apu.h"
+
+#define GB_CLOCK_SPEED    4194304
+#define GB_FPS            59.73
+#define TICKS_PER_FRAME   (GB_CLOCK_SPEED / GB_FPS)
+
+struct GuestProfiler;
+
+typedef struct GameBoy {
+    Cpu* cpu;
+    Memory* mem;
+    Ppu* ppu;
+    Apu* apu;
+    Timer timer;
+    InputQueue input;
+
+    uint64_t instructions; // executed since power on, for throughput measurements
+
+    struct GuestProfiler* guest_profiler; // host side, not part of the machine state
+} GameBoy;
+
+GameBoy* gameboy_init();
+void gameboy_free(GameBoy* gb);
+
+uint16_t gameboy_step(GameBoy* gb);
+void gameboy_run_frame(GameBoy* gb);
+
+uint32_t gameboy_checksum(GameBoy* gb);
+
+#endif
\ No newline at end of file
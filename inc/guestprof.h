@@ -0,0 +1,84 @@
+#ifndef GUESTPROF_H
+#define GUESTPROF_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "gameboy.h"
+
+// attributes emulated cycles to guest code: per bank:pc, and per call stack as seen
+// through CALL/RST, interrupt entry and RET/RETI. stack frames are dropped whenever
+// sp rises above the slot their return address was pushed to, so code that pops its
+// own return address or reloads sp doesn't leave the tracked stack out of sync
+
+#define GUESTPROF_MAX_DEPTH 256
+#define GUESTPROF_ROOT      0
+
+typedef enum {
+    GUEST_FRAME_ROOT,       // whatever was running before the first tracked call
+    GUEST_FRAME_CALL,
+    GUEST_FRAME_INTERRUPT,
+    GUEST_FRAME_HALT        // pseudo-frame for cycles spent halted
+} GuestFrameKind;
+
+// a node of the call tree, one per distinct call path
+typedef struct {
+    uint32_t key;           // bank << 16 | address of the routine
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint64_t self_cycles;
+    uint64_t calls;
+    GuestFrameKind kind;
+} GuestNode;
+
+typedef struct {
+    uint32_t node;
+    uint16_t sp;            // sp right after the return address was pushed
+} GuestFrame;
+
+typedef struct {
+    uint32_t key;
+    char* name;
+} GuestSymbol;
+
+typedef struct GuestProfiler {
+    GuestNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+
+    GuestFrame stack[GUESTPROF_MAX_DEPTH];
+    uint32_t depth;
+    uint64_t overflows;     // calls not tracked because the stack was full
+
+    // flat profile: cycles per pc, fixed address space plus one table per switchable bank
+    uint64_t* flat;
+    uint64_t* banks[0x200];
+
+    GuestSymbol* symbols;   // sorted by key
+    uint32_t symbol_count;
+
+    uint64_t total_cycles;
+    uint64_t halt_cycles;
+
+    // state of the instruction being profiled
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t bank;
+    uint8_t halted;
+} GuestProfiler;
+
+GuestProfiler* guestprof_init();
+void guestprof_free(GuestProfiler* gp);
+
+uint8_t guestprof_load_symbols(GuestProfiler* gp, const char* filename);
+
+// called by gameboy_step around the instruction and around interrupt dispatch
+void guestprof_before(GuestProfiler* gp, GameBoy* gb);
+void guestprof_instruction(GuestProfiler* gp, GameBoy* gb, uint16_t ticks);
+void guestprof_interrupts(GuestProfiler* gp, GameBoy* gb);
+
+uint8_t guestprof_write_folded(GuestProfiler* gp, const char* filename);
+void guestprof_print_top(GuestProfiler* gp, FILE* f, uint32_t count);
+
+#endif
\ No newline at end of file
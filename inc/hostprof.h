@@ -0,0 +1,113 @@
+#ifndef HOSTPROF_H
+#define HOSTPROF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// host time accounting per emulator subsystem, built in with -DOAMX_PROFILE (make
+// PROFILE=1). sections nest and time is exclusive: memory accesses made while the
+// cpu executes are charged to memory, not to the cpu. without the define every
+// macro below compiles to nothing
+
+typedef enum {
+    PROF_OTHER,       // outside any section: frontend, pacing, rewind
+    PROF_CPU,
+    PROF_MEMORY,
+    PROF_PPU_RENDER,
+    PROF_PPU_MODES,
+    PROF_TIMER,
+    PROF_APU,
+    PROF_INTERRUPTS,
+    PROF_PRESENT,
+    PROF_SECTION_COUNT
+} ProfSection;
+
+#ifdef OAMX_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#else
+    #include <time.h>
+#endif
+
+#define PROF_STACK_DEPTH   16
+#define PROF_REPORT_FRAMES 600  // about 10 seconds of emulated time
+
+typedef struct {
+    uint64_t last;  // timestamp of the last section change
+    uint8_t stack[PROF_STACK_DEPTH];
+    uint8_t depth;
+    uint32_t overflow;  // sections entered past the stack, charged to the innermost one
+
+    uint64_t frame[PROF_SECTION_COUNT];   // ticks of the frame in progress
+    uint64_t period[PROF_SECTION_COUNT];  // since the last periodic report
+    uint64_t total[PROF_SECTION_COUNT];
+    uint64_t frames;
+    uint64_t period_frames;
+
+    // to turn timestamp ticks into time
+    uint64_t start_ticks;
+    uint64_t start_ns;
+
+    FILE* csv;  // one row per frame when set
+} HostProfiler;
+
+extern HostProfiler hostprof;
+
+static inline uint64_t hostprof_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static inline void hostprof_enter(ProfSection section)
+{
+    uint64_t now = hostprof_ticks();
+    hostprof.frame[hostprof.stack[hostprof.depth]] += now - hostprof.last;
+    hostprof.last = now;
+
+    if (hostprof.depth + 1 < PROF_STACK_DEPTH)
+        hostprof.stack[++hostprof.depth] = section;
+    else
+        hostprof.overflow++;
+}
+
+static inline void hostprof_leave()
+{
+    uint64_t now = hostprof_ticks();
+    hostprof.frame[hostprof.stack[hostprof.depth]] += now - hostprof.last;
+    hostprof.last = now;
+
+    // leaves matching pushes that didn't fit mustn't pop sections that did
+    if (hostprof.overflow > 0)
+        hostprof.overflow--;
+    else if (hostprof.depth > 0)
+        hostprof.depth--;
+}
+
+void hostprof_init(FILE* csv);
+void hostprof_frame_end();
+void hostprof_finish(FILE* f);
+
+#define PROF_INIT(csv)   hostprof_init(csv)
+#define PROF_ENTER(s)    hostprof_enter(s)
+#define PROF_LEAVE()     hostprof_leave()
+#define PROF_FRAME()     hostprof_frame_end()
+#define PROF_FINISH(f)   hostprof_finish(f)
+
+#else
+
+#define PROF_INIT(csv)   ((void)0)
+#define PROF_ENTER(s)    ((void)0)
+#define PROF_LEAVE()     ((void)0)
+#define PROF_FRAME()     ((void)0)
+#define PROF_FINISH(f)   ((void)0)
+
+#endif
+
+#endif
\ No newline at end of file
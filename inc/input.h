@@ -1,6 +1,7 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include <stdint.h>
 #include "memory.h"
 
 #define KEY_RIGHT  (1 << 0)
@@ -13,6 +14,27 @@
 #define KEY_SELECT (1 << 2)
 #define KEY_START  (1 << 3)
 
-void update_key_states(Memory* mem);
+#define INPUT_RELEASED   0xFF
+#define INPUT_QUEUE_SIZE 64 // must be a power of two
+
+// buttons use the joypad_state layout: active low, d-pad in the low nibble, buttons in the high one
+typedef struct {
+    uint64_t cycle;
+    uint8_t buttons;
+} InputEvent;
+
+typedef struct {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} InputQueue;
+
+uint8_t input_queue_push(InputQueue* queue, uint64_t cycle, uint8_t buttons);
+void input_queue_clear(InputQueue* queue);
+
+void input_apply(Memory* mem, uint8_t buttons);
+void input_process(InputQueue* queue, Memory* mem, uint64_t until);
+
+static inline uint8_t input_queue_pending(InputQueue* queue) { return queue->head != queue->tail; }
 
 #endif
\ No newline at end of file
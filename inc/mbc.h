@@ -2,38 +2,95 @@
 #define MBC_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 typedef struct Memory Memory; 
 
 typedef enum MBCType {
     MBC_NONE,
-    MBC1
+    MBC1,
+    MBC3,
+    MBC5,
+    MBC_TYPE_COUNT
 } MBCType;
 
+#define MBC_RAM_UNMAPPED -1
+
+#define RTC_TICKS_PER_SECOND 4194304
+
+// mbc3 real time clock, counted in emulated cycles so it runs with the emulation
+// speed and replays the same from a save state
+typedef struct {
+    uint8_t seconds;
+    uint8_t minutes;
+    uint8_t hours;
+    uint16_t days;          // 9 bits
+    uint8_t halt;
+    uint8_t carry;          // day counter overflowed
+
+    uint8_t latched[5];     // S, M, H, DL, DH as of the last latch
+    uint8_t latch;          // last value written to 6000-7FFF
+
+    uint32_t subsecond;     // cycles into the current second
+    uint64_t synced;        // mem->cycles the counters were last advanced to
+} MbcRtc;
+
 typedef struct MBC {
     MBCType mbc_type;
-    uint8_t rom_bank;
+    uint16_t rom_bank;      // 9 bits on mbc5
     uint8_t ram_bank; 
     uint8_t ram_enabled;
     uint8_t banking_mode;
+    uint8_t rtc_select;     // mbc3 rtc register mapped at A000-BFFF, 0 for ram
 
-    void (*rom_write)(Memory* memory, uint16_t addr, uint8_t value);
-    uint8_t (*rom_read)(Memory* memory, uint16_t addr);
+    MbcRtc rtc;
 
-    void (*ram_write)(Memory* memory, uint16_t addr, uint8_t value);
-    uint8_t (*ram_read)(Memory* memory, uint16_t addr);
+    // derived from the registers above by mbc_update_mapping
+    const struct Mapper* mapper;
+    const uint8_t* rom0;    // 0000-3FFF
+    const uint8_t* romx;    // 4000-7FFF
+    uint8_t* ram;           // A000-BFFF, NULL when reads go through the mapper
+    uint16_t romx_bank;
 } MBC;
 
-void rom_write_mbc_none(Memory* memory, uint16_t addr, uint8_t value);
-uint8_t rom_read_mbc_none(Memory* memory, uint16_t addr);
+// the banking registers come first so save states can copy them without the mapping
+#define MBC_STATE_SIZE offsetof(MBC, mapper)
+
+// which banks a mapper's registers currently select. rom banks are wrapped to the
+// size of Memory.rom by the shared layer, anything tighter is up to the mapper
+typedef struct {
+    uint32_t rom0;
+    uint32_t romx;
+    int32_t ram;            // 8 KB bank, or MBC_RAM_UNMAPPED
+} MbcBanks;
+
+// what a mapper reports back from a control register write
+#define MBC_WROTE_ROM_BANK 0x01
+#define MBC_WROTE_RAM_BANK 0x02
+
+// a mapper only describes how control writes update its registers and which banks
+// those registers select; mbc.c keeps the direct pointers in MBC in sync
+typedef struct Mapper {
+    MBCType type;
+    const char* name;
+
+    uint8_t (*control)(Memory* mem, uint16_t addr, uint8_t value);
+    MbcBanks (*banks)(Memory* mem);
+
+    // A000-BFFF while no ram bank is mapped, NULL reads 0xFF and drops writes
+    uint8_t (*ram_read)(Memory* mem, uint16_t addr);
+    void (*ram_write)(Memory* mem, uint16_t addr, uint8_t value);
+} Mapper;
+
+void mbc_control_write(Memory* mem, uint16_t addr, uint8_t value);
+uint8_t mbc_ram_read(Memory* mem, uint16_t addr);
+void mbc_ram_write(Memory* mem, uint16_t addr, uint8_t value);
 
-void ram_write_mbc_none(Memory* memory, uint16_t addr, uint8_t value);
-uint8_t ram_read_mbc_none(Memory* memory, uint16_t addr);
+// recomputes the mapping, after the registers or mem->sram changed behind the mapper's back
+void mbc_update_mapping(Memory* mem);
 
-void rom_write_mbc1(Memory* memory, uint16_t addr, uint8_t value);
-uint8_t rom_read_mbc1(Memory* memory, uint16_t addr);
+void mbc_rtc_sync(Memory* mem);
 
-void ram_write_mbc1(Memory* memory, uint16_t addr, uint8_t value);
-uint8_t ram_read_mbc1(Memory* memory, uint16_t addr);
+const char* mbc_name(MBCType type);
 
 #endif
\ No newline at end of file
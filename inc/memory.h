@@ -2,9 +2,12 @@
 #define MEMORY_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "mbc.h"
 
 #define JOYP_ADDR 0xFF00
+#define SB_ADDR 0xFF01
+#define SC_ADDR 0xFF02
 #define DIV_ADDR 0xFF04
 #define TIMA_ADDR 0xFF05
 #define TMA_ADDR 0xFF06
@@ -22,49 +25,89 @@
 #define WX_ADDR 0xFF4B
 #define IE_ADDR 0xFFFF
 #define IF_ADDR 0xFF0F
+#define DMA_ADDR 0xFF46
+#define NR52_ADDR 0xFF26
+
+#define SRAM_SIZE 0x20000 // 16 banks of 8 KB, the most an mbc5 can address
+
+#define DMA_LENGTH 0xA0
+#define DMA_TICKS  640  // one byte per m-cycle
 
 typedef struct Memory {
-    uint8_t rom[0x200000]; // 2MB: covers all possible 128 ROM banks for MBC1 (5-bit ROM bank + 2-bit RAM bank in ROM mode)
-    uint8_t sram[0x8000];
+    uint8_t rom[0x800000]; // 8MB: covers all 512 ROM banks an MBC5 can select
+    uint8_t sram_buffer[SRAM_SIZE]; // cartridge ram unless a battery save file is mapped over it
 
     uint8_t vram[0x2000];
     uint8_t wram0[0x1000];
     uint8_t wram1[0x1000];
     uint8_t oam[0xA0];
-    uint8_t io[0x80];   
     uint8_t hram[0x7F];
 
     uint8_t joypad_state;
 
-    // I/O registers
-    uint8_t joyp;
-    uint8_t div;
-    uint8_t tima;
-    uint8_t tma;
-    uint8_t tac;
-    uint8_t lcdc;
-    uint8_t stat;
-    uint8_t ly;
-    uint8_t lyc;
-    uint8_t scy;
-    uint8_t scx;
-    uint8_t bgp;
-    uint8_t obp0;
-    uint8_t obp1;
-    uint8_t wy;
-    uint8_t wx;
+    // I/O registers, FF00-FF7F. each one is stored once and reached either by
+    // name or through io[] by the dispatch tables in memory.c
+    union {
+        uint8_t io[0x80];
+        struct {
+            uint8_t joyp;           // FF00
+            uint8_t sb;
+            uint8_t sc;
+            uint8_t unused_03;
+            uint8_t div;            // FF04
+            uint8_t tima;
+            uint8_t tma;
+            uint8_t tac;
+            uint8_t unused_08[7];
+            uint8_t IF;             // FF0F
+            uint8_t sound[0x30];    // FF10-FF3F, channels and wave ram
+            uint8_t lcdc;           // FF40
+            uint8_t stat;
+            uint8_t scy;
+            uint8_t scx;
+            uint8_t ly;
+            uint8_t lyc;
+            uint8_t dma;
+            uint8_t bgp;
+            uint8_t obp0;
+            uint8_t obp1;
+            uint8_t wy;
+            uint8_t wx;             // FF4B
+            uint8_t unused_4c[0x34];
+        };
+    };
+
     uint8_t IE;
-    uint8_t IF;
+
+    // oam dma in flight: the copy is done up front, the cpu is only kept off the
+    // buses until the transfer would have finished
+    uint16_t dma_ticks;
+
+    uint64_t cycles; // ticks emulated since power on, the timebase for anything scheduled on the bus
 
     MBC mbc;
+
+    // cartridge ram, sram_buffer or the mapping of a .sav file (see battery.h)
+    uint8_t* sram;
+    uint8_t sram_dirty;  // written since the last flush request
+    struct Battery* battery;
+
+    struct Apu* apu;     // sound registers go through it when set
 } Memory;
 
+// everything between the cartridge memories and mbc is plain machine state, laid out
+// so save states can copy it in one go. sram is saved separately through its pointer
+#define MEMORY_STATE_OFFSET offsetof(Memory, vram)
+#define MEMORY_STATE_SIZE   (offsetof(Memory, mbc) - offsetof(Memory, vram))
+
 void memory_write(Memory* mem, uint16_t addr, uint8_t value);
 uint8_t memory_read(Memory* mem, uint16_t addr);
 
 void memory_write16(Memory* mem, uint16_t addr, uint16_t value);
 uint16_t memory_read16(Memory* mem, uint16_t addr);
 
+void memory_dma_update(Memory* mem, uint16_t ticks);
+
 Memory* memory_init();
 
 void set_mbc_type(Memory* mem, MBCType mbcType);
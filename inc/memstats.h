@@ -0,0 +1,116 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// bus traffic counters, built in with -DOAMX_MEMSTATS (make MEMSTATS=1): reads and
+// writes per memory region, per switchable rom bank and per i/o register, and how
+// often games switch banks per frame. without the define every macro below compiles
+// to nothing
+
+typedef enum {
+    MEM_ROM0,
+    MEM_ROMX,
+    MEM_VRAM,
+    MEM_SRAM,
+    MEM_WRAM,
+    MEM_ECHO,
+    MEM_OAM,
+    MEM_UNUSABLE,
+    MEM_IO,
+    MEM_HRAM,
+    MEM_IE,
+    MEM_REGION_COUNT
+} MemRegion;
+
+#ifdef OAMX_MEMSTATS
+
+#define MEMSTATS_BANKS          0x200
+#define MEMSTATS_SWITCH_BUCKETS 32  // switches per frame, the last bucket holds anything above
+
+typedef struct {
+    uint64_t reads[MEM_REGION_COUNT];
+    uint64_t writes[MEM_REGION_COUNT];
+    uint64_t bank_reads[MEMSTATS_BANKS];
+    uint64_t io_reads[0x80];
+    uint64_t io_writes[0x80];
+
+    uint32_t frame_switches;    // in the frame in progress
+    uint32_t max_switches;
+    uint64_t switches;
+    uint64_t redundant_switches; // selected the bank that was already mapped
+    uint64_t frames;
+    uint64_t switch_histogram[MEMSTATS_SWITCH_BUCKETS];
+} MemStats;
+
+extern MemStats memstats;
+
+static inline MemRegion memstats_region(uint16_t addr)
+{
+    if (addr <= 0x3FFF) return MEM_ROM0;
+    if (addr <= 0x7FFF) return MEM_ROMX;
+    if (addr <= 0x9FFF) return MEM_VRAM;
+    if (addr <= 0xBFFF) return MEM_SRAM;
+    if (addr <= 0xDFFF) return MEM_WRAM;
+    if (addr <= 0xFDFF) return MEM_ECHO;
+    if (addr <= 0xFE9F) return MEM_OAM;
+    if (addr <= 0xFEFF) return MEM_UNUSABLE;
+    if (addr <= 0xFF7F) return MEM_IO;
+    if (addr <= 0xFFFE) return MEM_HRAM;
+    return MEM_IE;
+}
+
+static inline void memstats_read(uint16_t addr, uint16_t bank)
+{
+    MemRegion region = memstats_region(addr);
+    memstats.reads[region]++;
+
+    if (region == MEM_ROMX)
+        memstats.bank_reads[bank & (MEMSTATS_BANKS - 1)]++;
+    else if (region == MEM_IO)
+        memstats.io_reads[addr & 0x7F]++;
+}
+
+static inline void memstats_write(uint16_t addr)
+{
+    MemRegion region = memstats_region(addr);
+    memstats.writes[region]++;
+
+    if (region == MEM_IO)
+        memstats.io_writes[addr & 0x7F]++;
+}
+
+static inline void memstats_bank_switch(uint8_t changed)
+{
+    memstats.frame_switches++;
+    memstats.switches++;
+    memstats.redundant_switches += !changed;
+}
+
+void memstats_frame_end();
+void memstats_suspend();
+void memstats_resume();
+void memstats_finish(FILE* f);
+
+#define MEMSTATS_READ(addr, bank)      memstats_read(addr, bank)
+#define MEMSTATS_WRITE(addr)           memstats_write(addr)
+#define MEMSTATS_BANK_SWITCH(changed)  memstats_bank_switch(changed)
+#define MEMSTATS_FRAME()               memstats_frame_end()
+#define MEMSTATS_SUSPEND()             memstats_suspend()
+#define MEMSTATS_RESUME()              memstats_resume()
+#define MEMSTATS_FINISH(f)             memstats_finish(f)
+
+#else
+
+#define MEMSTATS_READ(addr, bank)      ((void)0)
+#define MEMSTATS_WRITE(addr)           ((void)0)
+#define MEMSTATS_BANK_SWITCH(changed)  ((void)0)
+#define MEMSTATS_FRAME()               ((void)0)
+#define MEMSTATS_SUSPEND()             ((void)0)
+#define MEMSTATS_RESUME()              ((void)0)
+#define MEMSTATS_FINISH(f)             ((void)0)
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdint.h>
+
+// turns amplitude changes stamped in emulated cycles into stereo pcm. the apu only
+// reports when a channel's output changes; every change is added as a band-limited
+// step (a windowed sinc impulse picked for its sub-sample position) to a buffer of
+// deltas, which is integrated into samples once a frame is complete. nothing ever
+// runs at the 4 MHz clock, and the steps don't alias the way point sampled ones do
+
+#define MIXER_MAX_FRAME  4096   // samples one mixer_end_frame can produce
+#define MIXER_SCALE      64     // the apu's 4 channels peak at 4 * 15 * 8 = 480
+
+#define BLEP_TAPS        16     // samples an impulse is spread over
+#define BLEP_PHASES      64     // sub-sample positions with their own impulse
+#define BLEP_DELAY       (BLEP_TAPS / 2 - 1)    // samples a step lags behind its time
+
+#define MIXER_HIGHPASS_HZ 20.0  // the dacs' output sits on a dc offset, as on hardware
+
+typedef struct Mixer {
+    uint32_t sample_rate;   // samples produced per clock_rate cycles, see mixer_set_rate
+    uint32_t clock_rate;
+    uint64_t phase;         // fraction of a sample carried into the next frame, in clock_rate units
+
+    // impulses with each tap duplicated for left and right, so one delta is added
+    // to both channels with the same vector operations
+    float kernel[BLEP_PHASES][BLEP_TAPS * 2] __attribute__((aligned(16)));
+
+    // changes per output sample of the frame in progress, interleaved left/right.
+    // the last BLEP_TAPS belong to the next frame
+    float deltas[(MIXER_MAX_FRAME + BLEP_TAPS) * 2] __attribute__((aligned(16)));
+
+    float level[2];
+    float highpass[2];
+    float highpass_coefficient;
+
+    int16_t samples[MIXER_MAX_FRAME * 2];
+    uint32_t sample_count;  // stereo frames in samples[] from the last mixer_end_frame
+} Mixer;
+
+Mixer* mixer_init(uint32_t sample_rate, uint32_t clock_rate);
+void mixer_free(Mixer* mixer);
+
+// changes how many samples a second of emulation turns into, without touching the
+// filters. only between frames: it applies to the whole frame in progress. the
+// frontend nudges it by a fraction of a percent to keep the audio device fed
+void mixer_set_rate(Mixer* mixer, uint32_t sample_rate);
+
+// time is in cycles since the start of the frame in progress
+void mixer_add_delta(Mixer* mixer, uint32_t time, int32_t left, int32_t right);
+
+// closes a frame of `cycles` cycles, its samples stay in samples[] until the next call
+void mixer_end_frame(Mixer* mixer, uint32_t cycles);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdint.h>
+
+#include "savestate.h"
+#include "gameboy.h"
+#include "input.h"
+
+#define MOVIE_MAGIC   0x564D584F // "OXMV"
+#define MOVIE_VERSION 2
+
+#define MOVIE_DEFAULT_CHECKPOINT_INTERVAL 3600 // a minute of frames
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t rom_hash;
+    uint32_t frame_count;
+    uint32_t event_count;
+    uint32_t start_state_size;  // serialized, compressed start state
+    uint32_t events_size;       // varint encoded (cycle delta, buttons) pairs
+    uint32_t checkpoint_interval;
+    uint32_t checkpoint_count;
+} MovieHeader;
+
+typedef struct {
+    uint32_t frame;  // state after this many frames
+    uint32_t size;
+    uint8_t* data;   // serialized, compressed state
+} MovieCheckpoint;
+
+// a movie is the start state, every joypad change with its cycle timestamp, the
+// machine checksum after every frame, and periodic checkpoints so it can be
+// verified in independent segments
+typedef struct {
+    MovieHeader header;
+    uint8_t* start_state;
+
+    InputEvent* events;
+    uint32_t event_capacity;
+
+    uint32_t* checksums;
+    uint32_t checksum_capacity;
+
+    MovieCheckpoint* checkpoints;
+    uint32_t checkpoint_capacity;
+} Movie;
+
+typedef struct {
+    Movie* movie;
+    uint32_t frame;
+    uint32_t next_event;
+    uint32_t mismatches;
+    uint32_t first_mismatch;
+} MoviePlayer;
+
+Movie* movie_init();
+void movie_free(Movie* movie);
+
+void movie_record_start(Movie* movie, GameBoy* gb);
+void movie_record_input(Movie* movie, uint64_t cycle, uint8_t buttons);
+void movie_record_frame(Movie* movie, GameBoy* gb);
+
+uint8_t movie_write_file(Movie* movie, const char* filename);
+Movie* movie_read_file(const char* filename);
+
+uint8_t movie_player_start(MoviePlayer* player, Movie* movie, GameBoy* gb);
+uint8_t movie_player_seek(MoviePlayer* player, GameBoy* gb, uint32_t frame, const uint8_t* state, uint32_t state_size);
+void movie_player_feed(MoviePlayer* player, GameBoy* gb);
+uint8_t movie_player_end_frame(MoviePlayer* player, GameBoy* gb);
+uint8_t movie_player_run_frame(MoviePlayer* player, GameBoy* gb);
+
+static inline uint8_t movie_player_done(MoviePlayer* player) { return player->frame >= player->movie->header.frame_count; }
+
+#endif
\ No newline at end of file
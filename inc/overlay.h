@@ -0,0 +1,18 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+
+// text drawn straight into an RGBA8888 framebuffer with a 3x5 pixel font, so it
+// needs nothing from the renderer. lowercase is drawn as uppercase, characters
+// without a glyph as blanks
+
+#define OVERLAY_GLYPH_WIDTH  3
+#define OVERLAY_GLYPH_HEIGHT 5
+#define OVERLAY_CELL_WIDTH   (OVERLAY_GLYPH_WIDTH + 1)
+#define OVERLAY_CELL_HEIGHT  (OVERLAY_GLYPH_HEIGHT + 1)
+
+// draws text with '\n' line breaks at x, y over a darkened box, clipped to the buffer
+void overlay_draw_text(uint32_t* pixels, uint32_t width, uint32_t height, uint32_t x, uint32_t y, const char* text, uint32_t color);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <stdint.h>
+
+#define PACER_BUCKET_NS        100000ULL // 0.1 ms histogram resolution
+#define PACER_BUCKETS          500       // up to 50 ms, anything slower lands in the last bucket
+#define PACER_JITTER_BUCKET_NS 10000ULL  // 10 us, jitter is much finer than the frame times
+#define PACER_JITTER_BUCKETS   1000      // up to 10 ms
+#define PACER_MAX_LAG_PERIODS  1         // a whole missed period isn't caught up, we resync instead
+#define PACER_VSYNC_TOLERANCE  0.005     // a refresh this close to the frame rate can pace the emulation
+
+#define PACER_MIN_SPIN_NS      50000ULL
+#define PACER_MAX_SPIN_NS      4000000ULL
+
+#define PACER_AUDIO_MAX_SKEW   0.005     // the sample rate moves by at most 0.5%, inaudible as pitch
+#define PACER_AUDIO_SMOOTHING  0.05      // the fill level jumps by a device buffer on every callback
+
+struct AudioRing;
+
+typedef struct {
+    uint64_t count;
+    double mean_ns;
+    double m2;      // running sum of squared deviations (welford)
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint32_t histogram[PACER_BUCKETS];
+
+    // jitter is how much each frame time differs from the one before it, so a steady
+    // rate reads as zero whatever the rate is
+    uint64_t last_ns;
+    uint64_t jitter_count;
+    uint32_t jitter[PACER_JITTER_BUCKETS];
+} FrameTimeStats;
+
+#define PACER_UNLIMITED 0.0
+
+typedef struct {
+    uint64_t base_period_ns;
+    double speed;       // multiplier over real time, PACER_UNLIMITED runs as fast as possible
+    uint64_t period_ns;
+    uint64_t next_deadline;
+    uint64_t last_frame;
+
+    // nanosleep wakes up late by up to a scheduler quantum, so we sleep until
+    // spin_ns before the deadline and busy-wait the rest. spin_ns follows the
+    // observed oversleep
+    uint64_t spin_ns;
+    double oversleep_ns;
+
+    // presentation blocks on a display refresh close enough to the frame rate (see
+    // pacer_vsync_paces), the pacer only measures at 1x
+    uint8_t vsync;
+
+    // dynamic rate control. neither the host clock behind the deadlines nor the
+    // display's refresh runs at exactly the audio device's rate, so the queue of
+    // samples for it would slowly drain or pile up. instead the ring's fill level is
+    // steered towards audio_target by making the mixer produce slightly more or fewer
+    // samples per frame: audio_ratio is the factor to apply to its sample rate
+    struct AudioRing* audio;
+    uint32_t audio_target;
+    double audio_fill;
+    double audio_ratio;
+
+    uint64_t resyncs;
+    uint64_t sleep_ns;
+    FrameTimeStats stats;
+} Pacer;
+
+uint64_t pacer_now_ns();
+
+uint8_t pacer_vsync_paces(double fps, double refresh_rate);
+void pacer_init(Pacer* pacer, double fps, uint8_t vsync);
+void pacer_set_speed(Pacer* pacer, double speed);
+void pacer_set_audio(Pacer* pacer, struct AudioRing* ring, uint32_t target_frames);
+void pacer_wait(Pacer* pacer);
+void pacer_record_frame(Pacer* pacer, uint64_t frame_ns);
+
+double pacer_mean_ms(Pacer* pacer);
+double pacer_stddev_ms(Pacer* pacer);
+double pacer_percentile_ms(Pacer* pacer, double percentile);
+double pacer_jitter_ms(Pacer* pacer, double percentile);
+void pacer_print_stats(Pacer* pacer);
+
+#endif
\ No newline at end of file
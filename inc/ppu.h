@@ -2,6 +2,7 @@
 #define PPU_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "memory.h"
 
 #define SCREEN_WIDTH  160
@@ -12,6 +13,8 @@
 #define HBLANK_TICKS 204
 #define VBLANK_TICKS 456
 
+#define LCD_FRAME_TICKS (154 * VBLANK_TICKS)    // 144 visible lines and 10 of vblank
+
 #define LCDC_BACKGROUND_ENABLED (1 << 0)
 #define LCDC_SPRITE_ENABLED     (1 << 1)
 #define LCDC_WINDOW_ENABLED     (1 << 5)
@@ -59,9 +62,19 @@ typedef struct {
     uint8_t window_line_counter;
     uint8_t lcd_on;
     uint8_t framebuffer[SCREEN_HEIGHT][SCREEN_WIDTH];
+
+    // host side flags, not part of the machine state
+    uint8_t frame_ready;  // set on vblank entry, cleared by whoever presents the frame
+    uint8_t skip_render;  // frames nobody will look at don't need their scanlines drawn
 } Ppu;
 
+#define PPU_STATE_SIZE offsetof(Ppu, frame_ready)
+
 Ppu* ppu_init();
 void ppu_step(Ppu* ppu, Memory* mem, uint8_t ticks);
+void ppu_draw_scanline(Ppu* ppu, Memory* mem);
+
+// maps the 2-bit shades of the current frame through palette into pixels (SCREEN_WIDTH * SCREEN_HEIGHT)
+void ppu_convert_framebuffer(Ppu* ppu, const uint32_t* palette, uint32_t* pixels);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "savestate.h"
+
+#define REWIND_DEFAULT_BUDGET     (8 * 1024 * 1024)
+#define REWIND_DEFAULT_SNAPSHOTS  3600 // one minute at one snapshot per frame
+#define REWIND_DEFAULT_KEYFRAMES  60
+
+typedef struct {
+    size_t budget_bytes;         // compressed bytes the ring may hold
+    uint32_t max_snapshots;
+    uint16_t capture_interval;   // frames between snapshots
+    uint16_t keyframe_interval;  // snapshots between full keyframes
+} RewindConfig;
+
+typedef struct {
+    uint8_t* data;
+    uint32_t size;
+    uint8_t keyframe;
+} RewindEntry;
+
+typedef struct {
+    size_t snapshots;
+    size_t bytes_used;
+    double seconds;
+    double avg_capture_us;
+    double avg_snapshot_bytes;
+} RewindStats;
+
+typedef struct {
+    RewindConfig config;
+
+    RewindEntry* entries;
+    uint32_t head;   // oldest entry
+    uint32_t count;
+    size_t bytes_used;
+
+    // every delta is taken against the keyframe of its group, and this is
+    // always the decoded keyframe of the newest group
+    SaveState* keyframe;
+    uint8_t keyframe_valid;
+    uint16_t deltas_since_keyframe;
+    uint16_t frames_since_capture;
+
+    SaveState* scratch;
+    uint8_t* buffer;
+
+    uint64_t captures;
+    uint64_t capture_ns;
+} Rewind;
+
+RewindConfig rewind_default_config();
+
+Rewind* rewind_init(RewindConfig config);
+void rewind_free(Rewind* rw);
+
+void rewind_capture(Rewind* rw, GameBoy* gb);
+uint8_t rewind_step_back(Rewind* rw, GameBoy* gb);
+
+RewindStats rewind_get_stats(Rewind* rw);
+void rewind_print_stats(Rewind* rw);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// lock-free single producer, single consumer queue of stereo sample frames. the
+// emulation thread writes, the audio device's thread reads. head and tail count
+// frames forever and wrap at 2^32; only the producer stores head and only the
+// consumer stores tail, so neither side ever waits on the other. they sit on
+// their own cache lines to keep the two threads from bouncing one between them
+
+#define RING_CACHE_LINE 64
+
+typedef struct AudioRing {
+    int16_t* samples;       // interleaved left/right
+    uint32_t capacity;      // frames, a power of two
+    uint32_t mask;
+
+    _Alignas(RING_CACHE_LINE) atomic_uint head;
+    uint64_t dropped;       // frames that didn't fit, producer side
+
+    _Alignas(RING_CACHE_LINE) atomic_uint tail;
+} AudioRing;
+
+// capacity is rounded up to a power of two
+AudioRing* ring_init(uint32_t capacity);
+void ring_free(AudioRing* ring);
+
+// producer: queues up to `frames` frames and returns how many fit, the rest is dropped
+uint32_t ring_write(AudioRing* ring, const int16_t* samples, uint32_t frames);
+
+// consumer: dequeues up to `frames` frames and returns how many there were
+uint32_t ring_read(AudioRing* ring, int16_t* out, uint32_t frames);
+
+// frames queued, exact from either side's point of view for its own next operation
+uint32_t ring_fill(AudioRing* ring);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// worst case output size: one literal token for every 128 input bytes. runs never
+// cost more than they encode, so a token header between literals is always paid for
+#define RLE_BOUND(size) ((size) + (size) / 128 + 1)
+
+#define VARINT_MAX_BYTES 10
+
+// a delta only spends its first (skip, count) pair on a skip that saves nothing
+#define DELTA_BOUND(size) ((size) + 2 * VARINT_MAX_BYTES)
+
+size_t rle_encode(const uint8_t* in, size_t size, uint8_t* out);
+size_t rle_decode(const uint8_t* in, size_t size, uint8_t* out, size_t capacity);
+
+size_t varint_write(uint8_t* out, uint64_t value);
+size_t varint_read(const uint8_t* in, size_t size, uint64_t* value);
+
+size_t delta_encode(const uint8_t* in, const uint8_t* base, size_t size, uint8_t* out);
+size_t delta_decode(const uint8_t* in, size_t size, const uint8_t* base, uint8_t* out, size_t capacity);
+
+#endif
\ No newline at end of file
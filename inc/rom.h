@@ -4,5 +4,11 @@
 #include "memory.h"
 
 void load_rom(Memory* mem, char* filename);
+uint32_t rom_size(Memory* mem);
+uint64_t rom_hash(Memory* mem);
+MBCType rom_mbc_type(Memory* mem);
+uint32_t rom_ram_size(Memory* mem);
+uint8_t rom_has_battery(Memory* mem);
+uint8_t rom_has_rumble(Memory* mem);
 
 #endif
\ No newline at end of file
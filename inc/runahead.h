@@ -0,0 +1,22 @@
+#ifndef RUNAHEAD_H
+#define RUNAHEAD_H
+
+#include <stdint.h>
+
+#include "savestate.h"
+
+#define RUNAHEAD_MIN_FRAMES 1
+#define RUNAHEAD_MAX_FRAMES 4
+
+typedef struct {
+    uint8_t frames;
+    SaveState* state;
+    InputQueue input;   // queued events aren't part of a save state, the speculative frames would eat them
+} RunAhead;
+
+RunAhead* runahead_init(uint8_t frames);
+void runahead_free(RunAhead* ra);
+
+void runahead_run_frame(RunAhead* ra, GameBoy* gb, void (*present)(Ppu* ppu));
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gameboy.h"
+#include "rle.h"
+
+#define SAVESTATE_MAGIC   0x5453584F // "OXST"
+#define SAVESTATE_VERSION 8
+
+#define SAVESTATE_COMPRESSED (1 << 0)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t size;          // payload bytes that follow the header (compressed size if SAVESTATE_COMPRESSED)
+    uint16_t rom_checksum;  // cartridge global checksum, so states aren't loaded into the wrong game
+    uint16_t reserved;
+} SaveStateHeader;
+
+// raw copies of each component: saving and restoring is one memcpy per field.
+// any change to these structs must bump SAVESTATE_VERSION
+typedef struct {
+    Cpu cpu;
+    Timer timer;
+    uint8_t ppu[PPU_STATE_SIZE];
+    uint8_t memory[MEMORY_STATE_SIZE];
+    uint8_t sram[SRAM_SIZE];
+    uint8_t mbc[MBC_STATE_SIZE];
+    uint8_t apu[APU_STATE_SIZE];
+} SaveStatePayload;
+
+typedef struct {
+    SaveStateHeader header;
+    SaveStatePayload payload;
+} SaveState;
+
+// upper bound for a serialized (possibly compressed) state
+#define SAVESTATE_MAX_SIZE (sizeof(SaveStateHeader) + RLE_BOUND(sizeof(SaveStatePayload)))
+
+void savestate_save(GameBoy* gb, SaveState* state);
+uint8_t savestate_load(GameBoy* gb, const SaveState* state);
+
+size_t savestate_serialize(const SaveState* state, uint8_t* out, uint8_t compress);
+uint8_t savestate_deserialize(SaveState* state, const uint8_t* in, size_t size);
+
+uint8_t savestate_write_file(GameBoy* gb, const char* filename, uint8_t compress);
+uint8_t savestate_read_file(GameBoy* gb, const char* filename);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pacing.h"
+
+// frontend health metrics: emulation speed, host time per emulated frame, time spent
+// sleeping in the pacer and frame time percentiles, over a rolling window and over the
+// whole session. fed once per host frame by the main loop
+
+#define TELEMETRY_WINDOW 600 // host frames, about 10 seconds at 1x
+
+typedef struct {
+    uint64_t wall_ns;
+    uint64_t sleep_ns;
+    uint64_t emulated_frames;
+} TelemetrySample;
+
+typedef struct {
+    double base_period_ns;  // one emulated frame of real time
+
+    TelemetrySample window[TELEMETRY_WINDOW];
+    uint32_t head;
+    uint32_t filled;
+    TelemetrySample window_sum;
+    uint32_t window_histogram[PACER_BUCKETS];
+
+    uint64_t frames;
+    TelemetrySample total;
+    uint32_t histogram[PACER_BUCKETS];
+} Telemetry;
+
+typedef struct {
+    uint64_t frames;
+    double speed_percent;   // emulated time over host time
+    double emulated_ms;     // host time per emulated frame, sleeping excluded
+    double sleep_ms;        // per host frame
+    double p50_ms;          // host frame times
+    double p95_ms;
+    double p99_ms;
+} TelemetrySnapshot;
+
+void telemetry_init(Telemetry* t, double fps);
+void telemetry_record(Telemetry* t, uint64_t wall_ns, uint64_t sleep_ns, uint32_t emulated_frames);
+
+void telemetry_snapshot(Telemetry* t, uint8_t lifetime, TelemetrySnapshot* s);
+
+void telemetry_format_overlay(const TelemetrySnapshot* s, char* out, size_t size);
+void telemetry_print(Telemetry* t, FILE* f);
+uint8_t telemetry_write_metrics(Telemetry* t, const char* filename);
+
+#endif
\ No newline at end of file
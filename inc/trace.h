@@ -0,0 +1,27 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "platform.h"
+
+// chrome trace-event json (chrome://tracing, ui.perfetto.dev) of what the emulator
+// does over time: spans for frames, scanlines, presentation and pacing sleeps,
+// instants for interrupts and bank switches. events are buffered and written in
+// large chunks; when no trace is open every TRACE_* macro is a single branch
+
+extern uint8_t trace_enabled;
+
+uint8_t trace_open(const char* filename);
+void trace_close();
+
+void trace_begin(const char* name, const char* category, const char* arg_name, int64_t arg);
+void trace_end(const char* name, const char* category);
+void trace_instant(const char* name, const char* category, const char* arg_name, int64_t arg);
+
+#define TRACE_BEGIN(name, category)                     do { if (unlikely(trace_enabled)) trace_begin(name, category, NULL, 0); } while (0)
+#define TRACE_BEGIN_ARG(name, category, arg_name, arg)  do { if (unlikely(trace_enabled)) trace_begin(name, category, arg_name, arg); } while (0)
+#define TRACE_END(name, category)                       do { if (unlikely(trace_enabled)) trace_end(name, category); } while (0)
+#define TRACE_INSTANT(name, category, arg_name, arg)    do { if (unlikely(trace_enabled)) trace_instant(name, category, arg_name, arg); } while (0)
+
+#endif
\ No newline at end of file
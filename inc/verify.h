@@ -0,0 +1,31 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdint.h>
+
+#include "movie.h"
+
+typedef enum {
+    VERIFY_PASSED,
+    VERIFY_FAILED,      // some segment didn't match
+    VERIFY_OTHER_ROM,   // recorded on a different rom, nothing was run
+    VERIFY_EMPTY        // no frames to check
+} VerifyStatus;
+
+typedef struct {
+    VerifyStatus status;
+    uint32_t segments;
+    uint32_t failed_segments;
+    uint32_t unreadable_segments;   // failed because their start state didn't load
+    uint32_t mismatches;
+    uint32_t first_mismatch;    // frame, valid when mismatches > 0
+    uint32_t checkpoint_mismatches;
+    uint32_t jobs;
+    double seconds;
+} VerifyResult;
+
+// 1 only when every frame was replayed and matched, result->status says why not
+uint8_t movie_verify(Movie* movie, GameBoy* template, uint32_t jobs, VerifyResult* result);
+void verify_print_result(VerifyResult* result);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "ring.h"
+
+// captures the mixer's output to a file from a background thread, for runs that
+// aren't paced to real time. samples go through an AudioRing like they do to the
+// audio device, except nothing is ever dropped: the emulation thread waits when
+// the writer falls a whole ring behind. a name ending in .wav gets a riff header,
+// anything else (a pipe, say) gets headerless 16-bit little endian stereo
+
+#define WAV_RING_FRAMES  65536  // ~1.4 s at 48 kHz
+#define WAV_CHUNK_FRAMES 4096   // frames per write
+
+typedef struct WavWriter {
+    FILE* file;
+    uint8_t header;         // sizes in the header are patched at close, if the file can seek
+    uint32_t sample_rate;
+    AudioRing* ring;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;    // frames queued, or closing
+    pthread_cond_t space;   // the writer freed part of the ring
+    uint8_t running;
+
+    uint64_t queued;        // handed to wav_write, emulation thread side
+    uint64_t frames;        // written to the file
+    uint8_t failed;
+} WavWriter;
+
+// NULL if the file can't be created
+WavWriter* wav_open(const char* filename, uint32_t sample_rate);
+
+// queues interleaved stereo frames, only blocks while the ring is full
+void wav_write(WavWriter* wav, const int16_t* samples, uint32_t frames);
+
+// writes out whatever is queued and closes the file. 0 if any write failed
+uint8_t wav_close(WavWriter* wav);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,478 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/apu.h"
+#include "../inc/hostprof.h"
+
+// sound registers relative to FF10: five per channel, then NR50-52 and wave ram
+#define NR(ch, n)  mem->sound[(ch) * 5 + (n)]
+#define NR50       mem->sound[0x14]
+#define NR51       mem->sound[0x15]
+#define NR52       mem->sound[0x16]
+#define WAVE_RAM   0x20
+
+#define NR52_POWER 0x80
+
+// bits that read back as 1, FF10-FF2F
+static const uint8_t READ_MASK[0x20] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,
+    0x00, 0x00, 0x70, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// one bit per duty step: 12.5%, 25%, 50%, 75%
+static const uint8_t DUTY[4] = { 0x01, 0x81, 0x87, 0x7E };
+
+static const uint8_t NOISE_DIVISORS[8] = { 8, 16, 32, 48, 64, 80, 96, 112 };
+
+Apu* apu_init()
+{
+    Apu* apu = (Apu*) malloc(sizeof(Apu));
+    memset(apu, 0, sizeof(Apu));
+
+    // the boot rom leaves channel 1 on after its chime
+    apu->channels[APU_PULSE1].enabled = 1;
+    apu->channels[APU_PULSE1].dac = 1;
+
+    return apu;
+}
+
+void apu_free(Apu* apu)
+{
+    free(apu);
+}
+
+static inline uint16_t frequency(Memory* mem, uint8_t ch)
+{
+    return NR(ch, 3) | ((NR(ch, 4) & 0x07) << 8);
+}
+
+static inline uint32_t voice_period(Memory* mem, uint8_t ch)
+{
+    switch (ch)
+    {
+        case APU_WAVE:
+            return (2048 - frequency(mem, ch)) * 2;
+        case APU_NOISE:
+            return NOISE_DIVISORS[NR(ch, 3) & 0x07] << (NR(ch, 3) >> 4);
+        default:
+            return (2048 - frequency(mem, ch)) * 4;
+    }
+}
+
+// the channel's digital output, 0-15
+static inline uint8_t voice_amp(Apu* apu, Memory* mem, uint8_t ch)
+{
+    ApuChannel* channel = &apu->channels[ch];
+    ApuVoice* voice = &apu->voices[ch];
+
+    if (!channel->enabled)
+        return 0;
+
+    switch (ch)
+    {
+        case APU_WAVE:
+        {
+            uint8_t byte = mem->sound[WAVE_RAM + voice->position / 2];
+            uint8_t sample = voice->position & 1 ? byte & 0x0F : byte >> 4;
+            uint8_t shift = (NR(ch, 2) >> 5) & 0x03;
+            return shift ? sample >> (shift - 1) : 0;
+        }
+        case APU_NOISE:
+            return voice->lfsr & 1 ? 0 : channel->volume;
+        default:
+            return (DUTY[NR(ch, 1) >> 6] >> voice->position) & 1 ? channel->volume : 0;
+    }
+}
+
+// hands the mixer the change of the channel's panned and scaled output, if any
+static inline void emit(Apu* apu, Memory* mem, uint8_t ch, uint64_t time)
+{
+    uint8_t amp = voice_amp(apu, mem, ch);
+    int32_t left = (NR51 >> (ch + 4)) & 1 ? amp * (((NR50 >> 4) & 0x07) + 1) : 0;
+    int32_t right = (NR51 >> ch) & 1 ? amp * ((NR50 & 0x07) + 1) : 0;
+
+    int32_t* emitted = apu->emitted[ch];
+    if (left == emitted[0] && right == emitted[1])
+        return;
+
+    mixer_add_delta(apu->mixer, time - apu->frame_start, left - emitted[0], right - emitted[1]);
+    emitted[0] = left;
+    emitted[1] = right;
+}
+
+static void emit_all(Apu* apu, Memory* mem, uint64_t time)
+{
+    for (uint8_t ch = 0; ch < APU_CHANNELS; ch++)
+        emit(apu, mem, ch, time);
+}
+
+static inline void voice_step(Apu* apu, Memory* mem, uint8_t ch)
+{
+    ApuVoice* voice = &apu->voices[ch];
+
+    switch (ch)
+    {
+        case APU_WAVE:
+            voice->position = (voice->position + 1) & 0x1F;
+            break;
+        case APU_NOISE:
+        {
+            uint16_t bit = (voice->lfsr ^ (voice->lfsr >> 1)) & 1;
+            voice->lfsr = (voice->lfsr >> 1) | (bit << 14);
+
+            // 7-bit mode feeds the result back into bit 6 as well
+            if (NR(ch, 3) & 0x08)
+                voice->lfsr = (voice->lfsr & ~0x40) | (bit << 6);
+            break;
+        }
+        default:
+            voice->position = (voice->position + 1) & 0x07;
+            break;
+    }
+}
+
+static inline uint8_t voice_silent(Apu* apu, Memory* mem, uint8_t ch)
+{
+    if ((NR51 & (0x11 << ch)) == 0)
+        return 1;
+
+    if (ch == APU_WAVE)
+        return (NR(ch, 2) & 0x60) == 0;
+
+    return apu->channels[ch].volume == 0;
+}
+
+// runs one channel's waveform over [from, to). a new frequency takes effect when
+// the current period ends, as on hardware
+static void synthesize(Apu* apu, Memory* mem, uint8_t ch, uint64_t from, uint64_t to)
+{
+    ApuVoice* voice = &apu->voices[ch];
+
+    if (!apu->channels[ch].enabled)
+        return;
+
+    // a channel at volume 0 or panned nowhere (channel 1 after boot) only keeps its
+    // timer running, stepping it period by period would be wasted
+    if (voice_silent(apu, mem, ch))
+    {
+        uint64_t span = to - from;
+        if (span < voice->timer)
+        {
+            voice->timer -= span;
+            return;
+        }
+
+        uint32_t period = voice_period(mem, ch);
+        voice->timer = period - (span - voice->timer) % period;
+        return;
+    }
+
+    uint64_t time = from;
+    while (to - time >= voice->timer)
+    {
+        time += voice->timer;
+        voice->timer = voice_period(mem, ch);
+        voice_step(apu, mem, ch);
+        emit(apu, mem, ch, time);
+    }
+
+    voice->timer -= to - time;
+}
+
+// --- frame sequencer --- //
+
+static void length_clock(Apu* apu, Memory* mem, uint8_t ch)
+{
+    ApuChannel* channel = &apu->channels[ch];
+
+    if ((NR(ch, 4) & 0x40) && channel->length > 0 && --channel->length == 0)
+        channel->enabled = 0;
+}
+
+static void envelope_clock(Apu* apu, Memory* mem, uint8_t ch)
+{
+    ApuChannel* channel = &apu->channels[ch];
+    uint8_t period = NR(ch, 2) & 0x07;
+
+    if (period == 0)
+        return;
+
+    if (channel->envelope_timer > 0)
+        channel->envelope_timer--;
+
+    if (channel->envelope_timer > 0)
+        return;
+
+    channel->envelope_timer = period;
+
+    if ((NR(ch, 2) & 0x08) && channel->volume < 15)
+        channel->volume++;
+    else if (!(NR(ch, 2) & 0x08) && channel->volume > 0)
+        channel->volume--;
+}
+
+static uint16_t sweep_next(Apu* apu, Memory* mem)
+{
+    ApuChannel* channel = &apu->channels[APU_PULSE1];
+    uint16_t delta = channel->sweep_frequency >> (NR(APU_PULSE1, 0) & 0x07);
+
+    return NR(APU_PULSE1, 0) & 0x08 ? channel->sweep_frequency - delta : channel->sweep_frequency + delta;
+}
+
+static void sweep_clock(Apu* apu, Memory* mem)
+{
+    ApuChannel* channel = &apu->channels[APU_PULSE1];
+    uint8_t period = (NR(APU_PULSE1, 0) >> 4) & 0x07;
+
+    if (channel->sweep_timer > 0)
+        channel->sweep_timer--;
+
+    if (channel->sweep_timer > 0)
+        return;
+
+    channel->sweep_timer = period ? period : 8;
+
+    if (!channel->sweep_enabled || period == 0)
+        return;
+
+    uint16_t next = sweep_next(apu, mem);
+    if (next > 0x7FF)
+    {
+        channel->enabled = 0;
+        return;
+    }
+
+    if ((NR(APU_PULSE1, 0) & 0x07) == 0)
+        return;
+
+    // the new frequency is written back to NR13/NR14, then checked once more
+    channel->sweep_frequency = next;
+    NR(APU_PULSE1, 3) = next & 0xFF;
+    NR(APU_PULSE1, 4) = (NR(APU_PULSE1, 4) & ~0x07) | (next >> 8);
+
+    if (sweep_next(apu, mem) > 0x7FF)
+        channel->enabled = 0;
+}
+
+static void sequencer_step(Apu* apu, Memory* mem)
+{
+    uint8_t step = apu->sequencer_step;
+
+    if ((step & 1) == 0)
+        for (uint8_t ch = 0; ch < APU_CHANNELS; ch++)
+            length_clock(apu, mem, ch);
+
+    if (step == 2 || step == 6)
+        sweep_clock(apu, mem);
+
+    if (step == 7)
+    {
+        envelope_clock(apu, mem, APU_PULSE1);
+        envelope_clock(apu, mem, APU_PULSE2);
+        envelope_clock(apu, mem, APU_NOISE);
+    }
+
+    apu->sequencer_step = (step + 1) & 0x07;
+}
+
+void apu_run(Apu* apu, Memory* mem, uint64_t until)
+{
+    if (until <= apu->time)
+        return;
+
+    PROF_ENTER(PROF_APU);
+
+    while (apu->time < until)
+    {
+        // the sequencer ticks on fixed multiples of its period, in between only the
+        // waveforms change
+        uint64_t next = (apu->time / APU_SEQUENCER_TICKS + 1) * APU_SEQUENCER_TICKS;
+        uint64_t end = next < until ? next : until;
+
+        if (apu->mixer != NULL)
+            for (uint8_t ch = 0; ch < APU_CHANNELS; ch++)
+                synthesize(apu, mem, ch, apu->time, end);
+
+        apu->time = end;
+
+        if (end == next && (NR52 & NR52_POWER))
+        {
+            sequencer_step(apu, mem);
+
+            if (apu->mixer != NULL)
+                emit_all(apu, mem, end);
+        }
+    }
+
+    PROF_LEAVE();
+}
+
+void apu_end_frame(Apu* apu, Memory* mem)
+{
+    apu_run(apu, mem, mem->cycles);
+
+    if (apu->mixer != NULL)
+        mixer_end_frame(apu->mixer, mem->cycles - apu->frame_start);
+
+    apu->frame_start = mem->cycles;
+}
+
+void apu_set_mixer(Apu* apu, Memory* mem, Mixer* mixer)
+{
+    apu_run(apu, mem, mem->cycles);
+
+    // a fresh mixer starts from silence
+    apu->mixer = mixer;
+    memset(apu->emitted, 0, sizeof(apu->emitted));
+
+    if (mixer != NULL)
+        emit_all(apu, mem, apu->time);
+}
+
+void apu_sync_output(Apu* apu, Memory* mem)
+{
+    if (apu->mixer != NULL)
+        emit_all(apu, mem, apu->time);
+}
+
+// --- registers --- //
+
+static void trigger(Apu* apu, Memory* mem, uint8_t ch)
+{
+    ApuChannel* channel = &apu->channels[ch];
+    ApuVoice* voice = &apu->voices[ch];
+
+    channel->enabled = channel->dac;
+
+    if (channel->length == 0)
+        channel->length = ch == APU_WAVE ? 256 : 64;
+
+    voice->timer = voice_period(mem, ch);
+
+    if (ch == APU_WAVE)
+        voice->position = 0;
+    else
+    {
+        channel->volume = NR(ch, 2) >> 4;
+        channel->envelope_timer = NR(ch, 2) & 0x07;
+    }
+
+    if (ch == APU_NOISE)
+        voice->lfsr = 0x7FFF;
+
+    if (ch == APU_PULSE1)
+    {
+        uint8_t period = (NR(ch, 0) >> 4) & 0x07;
+        uint8_t shift = NR(ch, 0) & 0x07;
+
+        channel->sweep_frequency = frequency(mem, ch);
+        channel->sweep_timer = period ? period : 8;
+        channel->sweep_enabled = period != 0 || shift != 0;
+
+        if (shift != 0 && sweep_next(apu, mem) > 0x7FF)
+            channel->enabled = 0;
+    }
+}
+
+static void channel_write(Apu* apu, Memory* mem, uint8_t ch, uint8_t n, uint8_t value)
+{
+    ApuChannel* channel = &apu->channels[ch];
+
+    NR(ch, n) = value;
+
+    switch (n)
+    {
+        case 0:
+            if (ch == APU_WAVE)
+            {
+                channel->dac = value >> 7;
+                channel->enabled &= channel->dac;
+            }
+            break;
+        case 1:
+            channel->length = ch == APU_WAVE ? 256 - value : 64 - (value & 0x3F);
+            break;
+        case 2:
+            if (ch != APU_WAVE)
+            {
+                channel->dac = (value & 0xF8) != 0;
+                channel->enabled &= channel->dac;
+            }
+            break;
+        case 4:
+            if (value & 0x80)
+                trigger(apu, mem, ch);
+            break;
+    }
+}
+
+uint8_t apu_read(Apu* apu, Memory* mem, uint8_t reg)
+{
+    uint8_t index = reg - 0x10;
+
+    if (index >= WAVE_RAM)
+        return mem->sound[index];
+
+    if (index != 0x16)
+        return mem->sound[index] | READ_MASK[index];
+
+    // length counters may have run out since the last access
+    apu_run(apu, mem, mem->cycles);
+
+    uint8_t status = NR52 | READ_MASK[index];
+    for (uint8_t ch = 0; ch < APU_CHANNELS; ch++)
+        status |= apu->channels[ch].enabled << ch;
+
+    return status;
+}
+
+// the apu catches up to the write first, so everything before it is synthesized
+// with the old register values
+void apu_write(Apu* apu, Memory* mem, uint8_t reg, uint8_t value)
+{
+    uint8_t index = reg - 0x10;
+
+    apu_run(apu, mem, mem->cycles);
+
+    if (index >= WAVE_RAM)
+    {
+        mem->sound[index] = value;
+        return;
+    }
+
+    uint8_t powered = NR52 & NR52_POWER;
+
+    if (index == 0x16)
+    {
+        // powering off clears every register and silences the channels
+        if (powered && !(value & NR52_POWER))
+        {
+            memset(mem->sound, 0, 0x16);
+            memset(apu->channels, 0, sizeof(apu->channels));
+        }
+        else if (!powered && (value & NR52_POWER))
+        {
+            apu->sequencer_step = 0;
+        }
+
+        NR52 = value & NR52_POWER;
+    }
+    else if (!powered)
+    {
+        return;
+    }
+    else if (index < 0x14)
+    {
+        channel_write(apu, mem, index / 5, index % 5, value);
+    }
+    else
+    {
+        mem->sound[index] = value;
+    }
+
+    if (apu->mixer != NULL)
+        emit_all(apu, mem, apu->time);
+}
\ No newline at end of file
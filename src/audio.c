@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+
+#include "../inc/audio.h"
+
+static SDL_AudioDeviceID device;
+static AudioRing* queue;
+
+// only touched by the callback, apart from the counter
+static uint8_t buffering;
+static atomic_ullong underruns;
+
+// runs on sdl's audio thread. after running dry it plays silence until the ring is
+// back at the target latency instead of playing every frame as soon as it arrives,
+// which would crackle through the whole refill
+static void audio_callback(void* userdata, Uint8* stream, int length)
+{
+    int16_t* out = (int16_t*) stream;
+    uint32_t frames = length / (2 * sizeof(int16_t));
+
+    if (buffering && ring_fill(queue) < AUDIO_TARGET_FRAMES)
+    {
+        memset(stream, 0, length);
+        return;
+    }
+
+    buffering = 0;
+
+    uint32_t read = ring_read(queue, out, frames);
+    if (read < frames)
+    {
+        memset(&out[read * 2], 0, (frames - read) * 2 * sizeof(int16_t));
+        atomic_fetch_add_explicit(&underruns, 1, memory_order_relaxed);
+        buffering = 1;
+    }
+}
+
+uint8_t audio_open(AudioRing* ring, uint32_t sample_rate)
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+        return 0;
+
+    SDL_AudioSpec want, have;
+    memset(&want, 0, sizeof(want));
+    want.freq = sample_rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = AUDIO_DEVICE_FRAMES;
+    want.callback = audio_callback;
+
+    queue = ring;
+    buffering = 1;
+    atomic_store(&underruns, 0);
+
+    // no allowed changes: sdl converts whatever the hardware wants behind our back
+    device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (device == 0)
+    {
+        printf("audio: %s\n", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return 0;
+    }
+
+    SDL_PauseAudioDevice(device, 0);
+
+    return 1;
+}
+
+// also stops the callback, so the ring can be freed afterwards
+void audio_close()
+{
+    if (device != 0 && SDL_WasInit(SDL_INIT_AUDIO))
+    {
+        SDL_CloseAudioDevice(device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+
+    device = 0;
+}
+
+uint64_t audio_underruns()
+{
+    return atomic_load_explicit(&underruns, memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../inc/battery.h"
+#include "../inc/rom.h"
+
+static void write_save(Battery* battery, const uint8_t* data)
+{
+    size_t done = 0;
+    while (done < battery->size)
+    {
+        ssize_t n = pwrite(battery->fd, data + done, battery->size - done, done);
+        if (n <= 0)
+            return;
+        done += (size_t)n;
+    }
+    fdatasync(battery->fd);
+}
+
+static void* flush_thread(void* arg)
+{
+    Battery* battery = (Battery*)arg;
+
+    pthread_mutex_lock(&battery->lock);
+    while (battery->running || battery->pending)
+    {
+        if (!battery->pending)
+        {
+            pthread_cond_wait(&battery->wake, &battery->lock);
+            continue;
+        }
+
+        // copy out under the lock so the next request can take a new snapshot
+        // while this one is on its way to the disk
+        battery->pending = 0;
+        memcpy(battery->writing, battery->snapshot, battery->size);
+        pthread_mutex_unlock(&battery->lock);
+
+        write_save(battery, battery->writing);
+
+        pthread_mutex_lock(&battery->lock);
+        battery->flushes++;
+    }
+    pthread_mutex_unlock(&battery->lock);
+
+    return NULL;
+}
+
+Battery* battery_open(Memory* mem, const char* filename)
+{
+    size_t size = rom_ram_size(mem);
+    if (!rom_has_battery(mem) || size == 0)
+        return NULL;
+
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, size) != 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // the mbc indexes all of SRAM_SIZE whatever the header says, so reserve that much
+    // and put the file over the start of it. the mapping is private: savestates and
+    // rewind rewrite sram too, only saves the game finishes reach the file
+    uint8_t* map = (uint8_t*) mmap(NULL, SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if (mmap(map, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(map, SRAM_SIZE);
+        close(fd);
+        return NULL;
+    }
+
+    Battery* battery = (Battery*) malloc(sizeof(Battery));
+    memset(battery, 0, sizeof(Battery));
+
+    battery->fd = fd;
+    battery->map = map;
+    battery->size = size;
+    battery->snapshot = (uint8_t*) malloc(size);
+    battery->writing = (uint8_t*) malloc(size);
+    battery->running = 1;
+
+    pthread_mutex_init(&battery->lock, NULL);
+    pthread_cond_init(&battery->wake, NULL);
+    pthread_create(&battery->thread, NULL, flush_thread, battery);
+
+    mem->sram = map;
+    mem->sram_dirty = 0;
+    mem->battery = battery;
+    mbc_update_mapping(mem);
+
+    return battery;
+}
+
+void battery_request_flush(Battery* battery)
+{
+    pthread_mutex_lock(&battery->lock);
+    memcpy(battery->snapshot, battery->map, battery->size);
+    battery->pending = 1;
+    pthread_cond_signal(&battery->wake);
+    pthread_mutex_unlock(&battery->lock);
+}
+
+void battery_close(Battery* battery, Memory* mem)
+{
+    pthread_mutex_lock(&battery->lock);
+    battery->running = 0;
+    pthread_cond_signal(&battery->wake);
+    pthread_mutex_unlock(&battery->lock);
+
+    pthread_join(battery->thread, NULL);
+
+    // whatever the game wrote without disabling ram afterwards
+    if (mem->sram_dirty)
+        write_save(battery, battery->map);
+
+    memcpy(mem->sram_buffer, battery->map, SRAM_SIZE);
+    mem->sram = mem->sram_buffer;
+    mem->battery = NULL;
+    mbc_update_mapping(mem);
+
+    munmap(battery->map, SRAM_SIZE);
+    close(battery->fd);
+
+    pthread_cond_destroy(&battery->wake);
+    pthread_mutex_destroy(&battery->lock);
+    free(battery->snapshot);
+    free(battery->writing);
+    free(battery);
+}
\ No newline at end of file
@@ -1,7 +1,12 @@
+#include <stdio.h>
 #include <stdint.h>
 #include <SDL2/SDL.h>
 
 #include "../inc/display.h"
+#include "../inc/input.h"
+#include "../inc/overlay.h"
+#include "../inc/hostprof.h"
+#include "../inc/trace.h"
 
 static const uint32_t gb_palette[4] = {
     0xFFFFFFFF,
@@ -14,6 +19,8 @@ static SDL_Window* window;
 static SDL_Renderer* renderer;
 static SDL_Texture* texture;
 
+static char overlay_text[256];
+
 void display_init(DisplayContext* ctx)
 {
     SDL_Init(SDL_INIT_VIDEO);
@@ -24,7 +31,9 @@ void display_init(DisplayContext* ctx)
         SCREEN_WIDTH * 4, SCREEN_HEIGHT * 4, SDL_WINDOW_SHOWN
     );
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    // with vsync, SDL_RenderPresent blocks until the next display refresh and paces us
+    uint32_t renderer_flags = SDL_RENDERER_ACCELERATED | (ctx->vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+    renderer = SDL_CreateRenderer(window, -1, renderer_flags);
 
     texture = SDL_CreateTexture(
         renderer,
@@ -34,6 +43,9 @@ void display_init(DisplayContext* ctx)
     );
 
     ctx->is_running = 1;
+    ctx->rewinding = 0;
+    ctx->fast_forward = 0;
+    ctx->speed_steps = 0;
 }
 
 void display_poll(DisplayContext* ctx)
@@ -46,10 +58,46 @@ void display_poll(DisplayContext* ctx)
             case SDL_QUIT:
                 display_quit(ctx);
                 break;
+            case SDL_KEYDOWN:
+                if (event.key.repeat)
+                    break;
+                if (event.key.keysym.sym == SDLK_EQUALS || event.key.keysym.sym == SDLK_KP_PLUS)
+                    ctx->speed_steps++;
+                if (event.key.keysym.sym == SDLK_MINUS || event.key.keysym.sym == SDLK_KP_MINUS)
+                    ctx->speed_steps--;
+                if (event.key.keysym.sym == SDLK_F1)
+                    ctx->overlay = !ctx->overlay;
+                break;
             default:
                 break;
         }
     }
+
+    if (!ctx->is_running)
+        return;
+
+    const Uint8* key_states = SDL_GetKeyboardState(NULL);
+    ctx->rewinding = key_states[SDL_SCANCODE_BACKSPACE];
+    ctx->fast_forward = key_states[SDL_SCANCODE_TAB];
+}
+
+// returns the host keyboard state in the joypad_state layout (active low)
+uint8_t display_read_buttons()
+{
+    const Uint8* key_states = SDL_GetKeyboardState(NULL);
+    uint8_t buttons = INPUT_RELEASED;
+
+    if (key_states[SDL_SCANCODE_Z]) buttons &= ~(KEY_A << 4);
+    if (key_states[SDL_SCANCODE_X]) buttons &= ~(KEY_B << 4);
+    if (key_states[SDL_SCANCODE_RSHIFT]) buttons &= ~(KEY_SELECT << 4);
+    if (key_states[SDL_SCANCODE_RETURN]) buttons &= ~(KEY_START << 4);
+
+    if (key_states[SDL_SCANCODE_RIGHT]) buttons &= ~KEY_RIGHT;
+    if (key_states[SDL_SCANCODE_LEFT]) buttons &= ~KEY_LEFT;
+    if (key_states[SDL_SCANCODE_UP]) buttons &= ~KEY_UP;
+    if (key_states[SDL_SCANCODE_DOWN]) buttons &= ~KEY_DOWN;
+
+    return buttons;
 }
 
 void display_quit(DisplayContext* ctx)
@@ -64,13 +112,35 @@ void display_quit(DisplayContext* ctx)
 
 void display_render(Ppu* ppu)
 {
+    PROF_ENTER(PROF_PRESENT);
+    TRACE_BEGIN("present", "frontend");
+
     static uint32_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
-    for (uint8_t y = 0; y < SCREEN_HEIGHT; y++)
-        for (uint8_t x = 0; x < SCREEN_WIDTH; x++)
-            pixels[y * SCREEN_WIDTH + x] = gb_palette[ppu->framebuffer[y][x]];
+    ppu_convert_framebuffer(ppu, gb_palette, pixels);
+
+    if (overlay_text[0] != '\0')
+        overlay_draw_text(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, 1, 1, overlay_text, 0xFFFF40FF);
 
     SDL_UpdateTexture(texture, NULL, pixels, SCREEN_WIDTH * sizeof(uint32_t));
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, texture, NULL, NULL);
     SDL_RenderPresent(renderer);
+
+    TRACE_END("present", "frontend");
+    PROF_LEAVE();
+}
+
+// drawn over every frame presented from now on, NULL hides it
+void display_set_overlay(const char* text)
+{
+    snprintf(overlay_text, sizeof(overlay_text), "%s", text != NULL ? text : "");
+}
+
+double display_refresh_rate()
+{
+    SDL_DisplayMode mode;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) != 0 || mode.refresh_rate <= 0)
+        return 60.0;
+
+    return mode.refresh_rate;
 }
\ No newline at end of file
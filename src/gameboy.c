@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/interrupts.h"
+#include "../inc/platform.h"
+#include "../inc/gameboy.h"
+#include "../inc/guestprof.h"
+#include "../inc/hostprof.h"
+#include "../inc/memstats.h"
+#include "../inc/trace.h"
+
+GameBoy* gameboy_init()
+{
+    GameBoy* gb = (GameBoy*) malloc(sizeof(GameBoy));
+    memset(gb, 0, sizeof(GameBoy));
+
+    gb->mem = memory_init();
+    gb->cpu = cpu_init();
+    gb->ppu = ppu_init();
+    gb->apu = apu_init();
+    gb->mem->apu = gb->apu;
+
+    return gb;
+}
+
+void gameboy_free(GameBoy* gb)
+{
+    free(gb->mem);
+    free(gb->cpu);
+    free(gb->ppu);
+    apu_free(gb->apu);
+    free(gb);
+}
+
+uint16_t gameboy_step(GameBoy* gb)
+{
+    // input lands on the first instruction boundary at or after its timestamp
+    if (unlikely(input_queue_pending(&gb->input)))
+        input_process(&gb->input, gb->mem, gb->mem->cycles);
+
+    gb->instructions += gb->cpu->state != CPU_HALTED;
+
+    GuestProfiler* gp = gb->guest_profiler;
+    if (unlikely(gp != NULL))
+        guestprof_before(gp, gb);
+
+    // a transfer started by this instruction runs from the next one on
+    uint8_t dma_running = gb->mem->dma_ticks != 0;
+
+    PROF_ENTER(PROF_CPU);
+    uint16_t ticks = cpu_step(gb->cpu, gb->mem);
+    PROF_LEAVE();
+
+    if (unlikely(gp != NULL))
+        guestprof_instruction(gp, gb, ticks);
+
+    PROF_ENTER(PROF_PPU_MODES);
+    ppu_step(gb->ppu, gb->mem, ticks);
+    PROF_LEAVE();
+
+    PROF_ENTER(PROF_INTERRUPTS);
+    handle_interrupts(gb->cpu, gb->ppu, gb->mem);
+    PROF_LEAVE();
+
+    if (unlikely(gp != NULL))
+        guestprof_interrupts(gp, gb);
+
+    PROF_ENTER(PROF_TIMER);
+    timer_update(&gb->timer, gb->mem, ticks);
+    PROF_LEAVE();
+
+    if (unlikely(dma_running))
+        memory_dma_update(gb->mem, ticks);
+
+    gb->mem->cycles += ticks;
+
+    return ticks;
+}
+
+static inline uint32_t fnv1a(uint32_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+#define FNV_FIELD(hash, field) hash = fnv1a(hash, &(field), sizeof(field))
+
+// hash of the emulated machine, used to verify replays. the framebuffer and what
+// the ppu only computes while drawing are left out, since frames that are never
+// shown (run-ahead, fast-forward) aren't drawn
+uint32_t gameboy_checksum(GameBoy* gb)
+{
+    uint32_t hash = 0x811C9DC5;
+    Cpu* cpu = gb->cpu;
+
+    FNV_FIELD(hash, cpu->a); FNV_FIELD(hash, cpu->f);
+    FNV_FIELD(hash, cpu->b); FNV_FIELD(hash, cpu->c);
+    FNV_FIELD(hash, cpu->d); FNV_FIELD(hash, cpu->e);
+    FNV_FIELD(hash, cpu->h); FNV_FIELD(hash, cpu->l);
+    FNV_FIELD(hash, cpu->sp); FNV_FIELD(hash, cpu->pc);
+    FNV_FIELD(hash, cpu->state); FNV_FIELD(hash, cpu->ime);
+
+    FNV_FIELD(hash, gb->ppu->mode);
+    FNV_FIELD(hash, gb->ppu->ticks);
+    FNV_FIELD(hash, gb->ppu->lcd_on);
+
+    FNV_FIELD(hash, gb->timer.ticks);
+    FNV_FIELD(hash, gb->timer.tima_counter);
+
+    hash = fnv1a(hash, (uint8_t*)gb->mem + MEMORY_STATE_OFFSET, MEMORY_STATE_SIZE);
+    hash = fnv1a(hash, gb->mem->sram, SRAM_SIZE);
+    hash = fnv1a(hash, &gb->mem->mbc, MBC_STATE_SIZE);
+    hash = fnv1a(hash, gb->apu, APU_CHECKSUM_SIZE);
+
+    return hash;
+}
+
+void gameboy_run_frame(GameBoy* gb)
+{
+    TRACE_BEGIN_ARG("frame", "emulation", "frame", gb->mem->cycles / TICKS_PER_FRAME);
+
+    // a frame ends on vblank entry, so every line of the framebuffer comes from the
+    // frame just run when it returns. with the lcd off there's no vblank to wait for
+    // and a frame lasts as long as an lcd frame would
+    uint32_t frame_ticks = 0;
+    gb->ppu->frame_ready = 0;
+    while (!gb->ppu->frame_ready && frame_ticks < LCD_FRAME_TICKS)
+        frame_ticks += gameboy_step(gb);
+
+    // events that fell inside the last instruction are applied now rather than after
+    // the next one, so a state captured between frames has applied exactly the events
+    // older than its own cycle count
+    if (unlikely(input_queue_pending(&gb->input)))
+        input_process(&gb->input, gb->mem, gb->mem->cycles - 1);
+
+    // sound is synthesized for the whole frame at once
+    apu_end_frame(gb->apu, gb->mem);
+
+    TRACE_END("frame", "emulation");
+    PROF_FRAME();
+    MEMSTATS_FRAME();
+}
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/guestprof.h"
+#include "../inc/interrupts.h"
+
+#define HALT_KEY 0xFFFFFFFF
+
+static uint16_t current_bank(Memory* mem, uint16_t addr)
+{
+    if (addr < 0x4000 || addr >= 0x8000)
+        return 0;
+
+    return mem->mbc.romx_bank;
+}
+
+static uint32_t new_node(GuestProfiler* gp, uint32_t parent, uint32_t key, GuestFrameKind kind)
+{
+    if (gp->node_count == gp->node_capacity)
+    {
+        gp->node_capacity *= 2;
+        gp->nodes = (GuestNode*) realloc(gp->nodes, gp->node_capacity * sizeof(GuestNode));
+    }
+
+    uint32_t index = gp->node_count++;
+    GuestNode* node = &gp->nodes[index];
+    memset(node, 0, sizeof(GuestNode));
+    node->key = key;
+    node->parent = parent;
+    node->kind = kind;
+
+    if (index != GUESTPROF_ROOT)
+    {
+        node->next_sibling = gp->nodes[parent].first_child;
+        gp->nodes[parent].first_child = index;
+    }
+
+    return index;
+}
+
+// children are few per node, a list is enough
+static uint32_t child_node(GuestProfiler* gp, uint32_t parent, uint32_t key, GuestFrameKind kind)
+{
+    for (uint32_t child = gp->nodes[parent].first_child; child != 0; child = gp->nodes[child].next_sibling)
+        if (gp->nodes[child].key == key && gp->nodes[child].kind == kind)
+            return child;
+
+    return new_node(gp, parent, key, kind);
+}
+
+GuestProfiler* guestprof_init()
+{
+    GuestProfiler* gp = (GuestProfiler*) malloc(sizeof(GuestProfiler));
+    memset(gp, 0, sizeof(GuestProfiler));
+
+    gp->node_capacity = 1024;
+    gp->nodes = (GuestNode*) malloc(gp->node_capacity * sizeof(GuestNode));
+    new_node(gp, GUESTPROF_ROOT, 0, GUEST_FRAME_ROOT);
+
+    gp->stack[0].node = GUESTPROF_ROOT;
+    gp->stack[0].sp = 0xFFFF;
+    gp->depth = 1;
+
+    gp->flat = (uint64_t*) calloc(0x10000, sizeof(uint64_t));
+
+    return gp;
+}
+
+void guestprof_free(GuestProfiler* gp)
+{
+    for (uint32_t i = 0; i < gp->symbol_count; i++)
+        free(gp->symbols[i].name);
+
+    for (uint32_t i = 0; i < sizeof(gp->banks) / sizeof(gp->banks[0]); i++)
+        free(gp->banks[i]);
+
+    free(gp->symbols);
+    free(gp->flat);
+    free(gp->nodes);
+    free(gp);
+}
+
+static int compare_symbols(const void* a, const void* b)
+{
+    uint32_t x = ((const GuestSymbol*)a)->key;
+    uint32_t y = ((const GuestSymbol*)b)->key;
+    return (x > y) - (x < y);
+}
+
+// rgbds .sym: "BB:AAAA Name" per line, ';' starts a comment
+uint8_t guestprof_load_symbols(GuestProfiler* gp, const char* filename)
+{
+    FILE* f = fopen(filename, "r");
+    if (f == NULL)
+        return 0;
+
+    char line[512];
+    char name[256];
+    uint32_t capacity = gp->symbol_count;
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        unsigned bank, addr;
+        if (line[0] == ';' || sscanf(line, "%x:%x %255s", &bank, &addr, name) != 3)
+            continue;
+
+        if (gp->symbol_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            gp->symbols = (GuestSymbol*) realloc(gp->symbols, capacity * sizeof(GuestSymbol));
+        }
+
+        // labels in the fixed bank or ram are listed with bank 0
+        if (addr < 0x4000 || addr >= 0x8000)
+            bank = 0;
+
+        gp->symbols[gp->symbol_count].key = (bank & 0xFFFF) << 16 | (addr & 0xFFFF);
+        gp->symbols[gp->symbol_count].name = strdup(name);
+        gp->symbol_count++;
+    }
+
+    fclose(f);
+
+    qsort(gp->symbols, gp->symbol_count, sizeof(GuestSymbol), compare_symbols);
+
+    return 1;
+}
+
+// nearest symbol at or before key in the same bank
+static GuestSymbol* find_symbol(GuestProfiler* gp, uint32_t key)
+{
+    int32_t low = 0, high = (int32_t)gp->symbol_count - 1;
+    GuestSymbol* found = NULL;
+
+    while (low <= high)
+    {
+        int32_t mid = (low + high) / 2;
+        if (gp->symbols[mid].key <= key)
+        {
+            found = &gp->symbols[mid];
+            low = mid + 1;
+        }
+        else
+            high = mid - 1;
+    }
+
+    if (found != NULL && (found->key >> 16) != (key >> 16))
+        return NULL;
+
+    return found;
+}
+
+static void name_key(GuestProfiler* gp, uint32_t key, char* out, size_t size)
+{
+    GuestSymbol* symbol = find_symbol(gp, key);
+
+    if (symbol == NULL)
+        snprintf(out, size, "%02X:%04X", key >> 16, key & 0xFFFF);
+    else if (symbol->key == key)
+        snprintf(out, size, "%s", symbol->name);
+    else
+        snprintf(out, size, "%s+%X", symbol->name, key - symbol->key);
+}
+
+static void name_node(GuestProfiler* gp, GuestNode* node, char* out, size_t size)
+{
+    static const char* INTERRUPT_NAMES[] = { "irq_vblank", "irq_stat", "irq_timer", "irq_serial", "irq_joypad" };
+
+    switch (node->kind)
+    {
+        case GUEST_FRAME_ROOT:
+            snprintf(out, size, "(root)");
+            return;
+        case GUEST_FRAME_HALT:
+            snprintf(out, size, "HALT");
+            return;
+        case GUEST_FRAME_INTERRUPT:
+            // a symbol on the vector wins over the generic name
+            if (find_symbol(gp, node->key) != NULL && find_symbol(gp, node->key)->key == node->key)
+                break;
+            snprintf(out, size, "%s", INTERRUPT_NAMES[((node->key & 0xFF) - VBLANK_ADDR) / 8]);
+            return;
+        default:
+            break;
+    }
+
+    name_key(gp, node->key, out, size);
+}
+
+static uint8_t is_call(uint8_t opcode)
+{
+    switch (opcode)
+    {
+        case 0xCD: case 0xC4: case 0xCC: case 0xD4: case 0xDC:  // call
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF:             // rst
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void push_frame(GuestProfiler* gp, uint32_t key, GuestFrameKind kind, uint16_t sp)
+{
+    if (gp->depth == GUESTPROF_MAX_DEPTH)
+    {
+        gp->overflows++;
+        return;
+    }
+
+    uint32_t node = child_node(gp, gp->stack[gp->depth - 1].node, key, kind);
+    gp->nodes[node].calls++;
+
+    gp->stack[gp->depth].node = node;
+    gp->stack[gp->depth].sp = sp;
+    gp->depth++;
+}
+
+// a frame is over once its return address slot has been popped
+static void unwind(GuestProfiler* gp, uint16_t sp)
+{
+    while (gp->depth > 1 && sp > gp->stack[gp->depth - 1].sp)
+        gp->depth--;
+}
+
+void guestprof_before(GuestProfiler* gp, GameBoy* gb)
+{
+    gp->pc = gb->cpu->pc;
+    gp->sp = gb->cpu->sp;
+    gp->bank = current_bank(gb->mem, gp->pc);
+    gp->halted = gb->cpu->state == CPU_HALTED;
+}
+
+void guestprof_instruction(GuestProfiler* gp, GameBoy* gb, uint16_t ticks)
+{
+    Cpu* cpu = gb->cpu;
+    uint32_t top = gp->stack[gp->depth - 1].node;
+
+    gp->total_cycles += ticks;
+
+    if (gp->halted)
+    {
+        gp->nodes[child_node(gp, top, HALT_KEY, GUEST_FRAME_HALT)].self_cycles += ticks;
+        gp->halt_cycles += ticks;
+        return;
+    }
+
+    gp->nodes[top].self_cycles += ticks;
+
+    if (gp->bank == 0)
+        gp->flat[gp->pc] += ticks;
+    else if (gp->bank < sizeof(gp->banks) / sizeof(gp->banks[0]))
+    {
+        if (gp->banks[gp->bank] == NULL)
+            gp->banks[gp->bank] = (uint64_t*) calloc(0x4000, sizeof(uint64_t));
+        gp->banks[gp->bank][gp->pc - 0x4000] += ticks;
+    }
+
+    if (cpu->sp == (uint16_t)(gp->sp - 2) && is_call(memory_read(gb->mem, gp->pc)))
+    {
+        uint32_t key = (uint32_t)current_bank(gb->mem, cpu->pc) << 16 | cpu->pc;
+        push_frame(gp, key, GUEST_FRAME_CALL, cpu->sp);
+    }
+    else
+        unwind(gp, cpu->sp);
+
+    gp->sp = cpu->sp;
+}
+
+void guestprof_interrupts(GuestProfiler* gp, GameBoy* gb)
+{
+    Cpu* cpu = gb->cpu;
+
+    uint8_t dispatched = cpu->sp == (uint16_t)(gp->sp - 2)
+        && cpu->pc >= VBLANK_ADDR && cpu->pc <= JOYPAD_ADDR && (cpu->pc & 7) == 0;
+
+    if (dispatched)
+        push_frame(gp, cpu->pc, GUEST_FRAME_INTERRUPT, cpu->sp);
+}
+
+static void write_path(GuestProfiler* gp, FILE* f, uint32_t index)
+{
+    if (index != GUESTPROF_ROOT)
+    {
+        write_path(gp, f, gp->nodes[index].parent);
+        fputc(';', f);
+    }
+
+    char name[300];
+    name_node(gp, &gp->nodes[index], name, sizeof(name));
+    fputs(name, f);
+}
+
+// one "frame;frame;frame cycles" line per call path, the input of flamegraph.pl and speedscope
+uint8_t guestprof_write_folded(GuestProfiler* gp, const char* filename)
+{
+    FILE* f = fopen(filename, "w");
+    if (f == NULL)
+        return 0;
+
+    for (uint32_t i = 0; i < gp->node_count; i++)
+    {
+        if (gp->nodes[i].self_cycles == 0)
+            continue;
+
+        write_path(gp, f, i);
+        fprintf(f, " %llu\n", (unsigned long long)gp->nodes[i].self_cycles);
+    }
+
+    fclose(f);
+
+    return 1;
+}
+
+typedef struct {
+    uint32_t key;
+    uint64_t cycles;
+} KeyCycles;
+
+static int compare_key(const void* a, const void* b)
+{
+    uint32_t x = ((const KeyCycles*)a)->key;
+    uint32_t y = ((const KeyCycles*)b)->key;
+    return (x > y) - (x < y);
+}
+
+static int compare_cycles_desc(const void* a, const void* b)
+{
+    uint64_t x = ((const KeyCycles*)a)->cycles;
+    uint64_t y = ((const KeyCycles*)b)->cycles;
+    return (x < y) - (x > y);
+}
+
+// keeps the `count` largest entries of a table, sorted
+static void insert_top(KeyCycles* top, uint32_t count, uint32_t key, uint64_t cycles)
+{
+    if (cycles <= top[count - 1].cycles)
+        return;
+
+    uint32_t i = count - 1;
+    while (i > 0 && top[i - 1].cycles < cycles)
+    {
+        top[i] = top[i - 1];
+        i--;
+    }
+
+    top[i].key = key;
+    top[i].cycles = cycles;
+}
+
+void guestprof_print_top(GuestProfiler* gp, FILE* f, uint32_t count)
+{
+    if (gp->total_cycles == 0 || count == 0)
+        return;
+
+    double total = (double)gp->total_cycles;
+    char name[300];
+
+    fprintf(f, "guest profile: %llu cycles, %.1f%% halted\n", (unsigned long long)gp->total_cycles, 100.0 * gp->halt_cycles / total);
+
+    // routines by self time, summed over every path that reaches them
+    KeyCycles* routines = (KeyCycles*) malloc(gp->node_count * sizeof(KeyCycles));
+    uint32_t routine_count = 0;
+    for (uint32_t i = 0; i < gp->node_count; i++)
+    {
+        if (gp->nodes[i].kind == GUEST_FRAME_HALT || gp->nodes[i].self_cycles == 0)
+            continue;
+
+        routines[routine_count].key = gp->nodes[i].kind == GUEST_FRAME_ROOT ? HALT_KEY : gp->nodes[i].key;
+        routines[routine_count].cycles = gp->nodes[i].self_cycles;
+        routine_count++;
+    }
+
+    qsort(routines, routine_count, sizeof(KeyCycles), compare_key);
+
+    uint32_t merged = 0;
+    for (uint32_t i = 0; i < routine_count; i++)
+    {
+        if (merged > 0 && routines[merged - 1].key == routines[i].key)
+            routines[merged - 1].cycles += routines[i].cycles;
+        else
+            routines[merged++] = routines[i];
+    }
+
+    qsort(routines, merged, sizeof(KeyCycles), compare_cycles_desc);
+
+    fprintf(f, "%-32s %14s %7s\n", "routine", "self cycles", "share");
+    for (uint32_t i = 0; i < merged && i < count; i++)
+    {
+        if (routines[i].key == HALT_KEY)
+            snprintf(name, sizeof(name), "(outside any call)");
+        else
+            name_key(gp, routines[i].key, name, sizeof(name));
+
+        fprintf(f, "%-32s %14llu %6.1f%%\n", name, (unsigned long long)routines[i].cycles, 100.0 * routines[i].cycles / total);
+    }
+
+    free(routines);
+
+    // hottest instructions
+    KeyCycles* top = (KeyCycles*) calloc(count, sizeof(KeyCycles));
+    for (uint32_t pc = 0; pc < 0x10000; pc++)
+        if (gp->flat[pc])
+            insert_top(top, count, pc, gp->flat[pc]);
+
+    for (uint32_t bank = 1; bank < sizeof(gp->banks) / sizeof(gp->banks[0]); bank++)
+        if (gp->banks[bank] != NULL)
+            for (uint32_t offset = 0; offset < 0x4000; offset++)
+                if (gp->banks[bank][offset])
+                    insert_top(top, count, bank << 16 | (0x4000 + offset), gp->banks[bank][offset]);
+
+    fprintf(f, "%-32s %14s %7s\n", "pc", "cycles", "share");
+    for (uint32_t i = 0; i < count && top[i].cycles; i++)
+    {
+        char location[sizeof(name) + 16];   // "bank:addr " in front of the name
+        name_key(gp, top[i].key, name, sizeof(name));
+        snprintf(location, sizeof(location), "%02X:%04X %s", top[i].key >> 16, top[i].key & 0xFFFF, name);
+        fprintf(f, "%-32s %14llu %6.1f%%\n", location, (unsigned long long)top[i].cycles, 100.0 * top[i].cycles / total);
+    }
+
+    free(top);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#ifdef OAMX_PROFILE
+
+#include <string.h>
+#include <time.h>
+
+#include "../inc/hostprof.h"
+
+HostProfiler hostprof;
+
+static const char* SECTION_NAMES[PROF_SECTION_COUNT] = {
+    "other",
+    "cpu execute",
+    "memory dispatch",
+    "ppu render",
+    "ppu modes",
+    "timer",
+    "apu",
+    "interrupts",
+    "presentation"
+};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void hostprof_init(FILE* csv)
+{
+    memset(&hostprof, 0, sizeof(HostProfiler));
+
+    hostprof.csv = csv;
+    hostprof.start_ns = now_ns();
+    hostprof.start_ticks = hostprof_ticks();
+    hostprof.last = hostprof.start_ticks;
+
+    if (csv != NULL)
+    {
+        fprintf(csv, "frame");
+        for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++)
+            fprintf(csv, ",%s", SECTION_NAMES[i]);
+        fprintf(csv, "\n");
+    }
+}
+
+// ticks per nanosecond, measured over the whole run so far
+static double ticks_per_ns()
+{
+    uint64_t elapsed = now_ns() - hostprof.start_ns;
+    if (elapsed == 0)
+        return 1.0;
+
+    return (double)(hostprof_ticks() - hostprof.start_ticks) / elapsed;
+}
+
+static void print_sections(FILE* f, const uint64_t* ticks, uint64_t frames)
+{
+    uint64_t sum = 0;
+    for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++)
+        sum += ticks[i];
+
+    if (frames == 0 || sum == 0)
+        return;
+
+    double scale = ticks_per_ns() * 1000.0;
+
+    fprintf(f, "%-16s %12s %8s\n", "section", "us/frame", "share");
+    for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++)
+        fprintf(f, "%-16s %12.1f %7.1f%%\n", SECTION_NAMES[i], ticks[i] / scale / frames, 100.0 * ticks[i] / sum);
+    fprintf(f, "%-16s %12.1f\n", "total", sum / scale / frames);
+}
+
+void hostprof_frame_end()
+{
+    // close the running section so the frame gets everything up to now
+    uint64_t now = hostprof_ticks();
+    hostprof.frame[hostprof.stack[hostprof.depth]] += now - hostprof.last;
+    hostprof.last = now;
+
+    if (hostprof.csv != NULL)
+        fprintf(hostprof.csv, "%llu", (unsigned long long)hostprof.frames);
+
+    for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++)
+    {
+        if (hostprof.csv != NULL)
+            fprintf(hostprof.csv, ",%llu", (unsigned long long)hostprof.frame[i]);
+
+        hostprof.period[i] += hostprof.frame[i];
+        hostprof.total[i] += hostprof.frame[i];
+        hostprof.frame[i] = 0;
+    }
+
+    if (hostprof.csv != NULL)
+        fprintf(hostprof.csv, "\n");
+
+    hostprof.frames++;
+
+    if (++hostprof.period_frames == PROF_REPORT_FRAMES)
+    {
+        fprintf(stderr, "host profile, frames %llu-%llu:\n",
+            (unsigned long long)(hostprof.frames - PROF_REPORT_FRAMES), (unsigned long long)hostprof.frames - 1);
+        print_sections(stderr, hostprof.period, hostprof.period_frames);
+
+        memset(hostprof.period, 0, sizeof(hostprof.period));
+        hostprof.period_frames = 0;
+    }
+}
+
+// prints the totals of the whole run and closes the per-frame csv
+void hostprof_finish(FILE* f)
+{
+    fprintf(f, "host profile, %llu frames:\n", (unsigned long long)hostprof.frames);
+    print_sections(f, hostprof.total, hostprof.frames);
+
+    if (hostprof.csv != NULL)
+        fclose(hostprof.csv);
+    hostprof.csv = NULL;
+}
+
+#endif
\ No newline at end of file
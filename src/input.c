@@ -1,17 +1,61 @@
-#include <SDL2/SDL.h>
+#include "../inc/interrupts.h"
 #include "../inc/input.h"
 
-void update_key_states(Memory* mem)
+// state of the P10-P13 lines as the cpu would see them with the current JOYP selection
+static uint8_t joypad_lines(Memory* mem, uint8_t buttons)
 {
-    const Uint8* key_states = SDL_GetKeyboardState(NULL);
+    uint8_t lines = 0x0F;
 
-    if (key_states[SDL_SCANCODE_Z]) mem->joypad_state &= ~(KEY_A << 4); else mem->joypad_state |= (KEY_A << 4);
-    if (key_states[SDL_SCANCODE_X]) mem->joypad_state &= ~(KEY_B << 4); else mem->joypad_state |= (KEY_B << 4);
-    if (key_states[SDL_SCANCODE_RSHIFT]) mem->joypad_state &= ~(KEY_SELECT << 4); else mem->joypad_state |= (KEY_SELECT << 4);
-    if (key_states[SDL_SCANCODE_RETURN]) mem->joypad_state &= ~(KEY_START << 4); else mem->joypad_state |= (KEY_START << 4);
+    if (!(mem->joyp & 0x10))
+        lines &= buttons & 0x0F;
 
-    if (key_states[SDL_SCANCODE_RIGHT]) mem->joypad_state &= ~KEY_RIGHT; else mem->joypad_state |= KEY_RIGHT;
-    if (key_states[SDL_SCANCODE_LEFT]) mem->joypad_state &= ~KEY_LEFT; else mem->joypad_state |= KEY_LEFT;
-    if (key_states[SDL_SCANCODE_UP]) mem->joypad_state &= ~KEY_UP; else mem->joypad_state |= KEY_UP;
-    if (key_states[SDL_SCANCODE_DOWN]) mem->joypad_state &= ~KEY_DOWN; else mem->joypad_state |= KEY_DOWN;
+    if (!(mem->joyp & 0x20))
+        lines &= buttons >> 4;
+
+    return lines;
+}
+
+// events must be pushed in cycle order, returns 0 if the queue is full
+uint8_t input_queue_push(InputQueue* queue, uint64_t cycle, uint8_t buttons)
+{
+    if (queue->tail - queue->head == INPUT_QUEUE_SIZE)
+        return 0;
+
+    InputEvent* event = &queue->events[queue->tail & (INPUT_QUEUE_SIZE - 1)];
+    event->cycle = cycle;
+    event->buttons = buttons;
+    queue->tail++;
+
+    return 1;
+}
+
+void input_queue_clear(InputQueue* queue)
+{
+    queue->head = queue->tail;
+}
+
+void input_apply(Memory* mem, uint8_t buttons)
+{
+    uint8_t before = joypad_lines(mem, mem->joypad_state);
+    uint8_t after = joypad_lines(mem, buttons);
+
+    mem->joypad_state = buttons;
+
+    // the joypad interrupt fires when any selected line goes from high to low
+    if (before & ~after)
+        request_interrupt(mem, JOYPAD_INTERRUPT);
+}
+
+// applies every queued event timestamped at or before `until`
+void input_process(InputQueue* queue, Memory* mem, uint64_t until)
+{
+    while (queue->head != queue->tail)
+    {
+        InputEvent* event = &queue->events[queue->head & (INPUT_QUEUE_SIZE - 1)];
+        if (event->cycle > until)
+            return;
+
+        input_apply(mem, event->buttons);
+        queue->head++;
+    }
 }
\ No newline at end of file
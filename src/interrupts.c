@@ -1,5 +1,6 @@
 #include "../inc/interrupts.h"
 #include "../inc/display.h"
+#include "../inc/trace.h"
 
 void handle_interrupts(Cpu* cpu, Ppu* ppu, Memory* mem)
 {
@@ -45,6 +46,8 @@ void handle_interrupts(Cpu* cpu, Ppu* ppu, Memory* mem)
             mem->IF &= ~(JOYPAD_INTERRUPT);
             cpu_call(cpu, mem, JOYPAD_ADDR);
         }
+
+        TRACE_INSTANT("interrupt", "cpu", "vector", cpu->pc);
     }
 }
 
@@ -1,67 +1,683 @@
-#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
-#include "../inc/interrupts.h"
+#include "../inc/runahead.h"
 #include "../inc/display.h"
-#include "../inc/memory.h"
-#include "../inc/timer.h"
+#include "../inc/gameboy.h"
+#include "../inc/movie.h"
+#include "../inc/verify.h"
+#include "../inc/pacing.h"
+#include "../inc/rewind.h"
 #include "../inc/input.h"
-#include "../inc/cpu.h"
-#include "../inc/ppu.h"
 #include "../inc/rom.h"
+#include "../inc/hostprof.h"
+#include "../inc/memstats.h"
+#include "../inc/trace.h"
+#include "../inc/guestprof.h"
+#include "../inc/telemetry.h"
+#include "../inc/battery.h"
+#include "../inc/audio.h"
+#include "../inc/wav.h"
 
-#define GB_CLOCK_SPEED    4194304
-#define GB_FPS            59.73
-#define TICKS_PER_FRAME   (GB_CLOCK_SPEED / GB_FPS)
-#define FRAME_DURATION    (1000000ULL / GB_FPS)
+// speeds reachable with the +/- hotkeys, the last one runs unthrottled
+static const double SPEED_STEPS[] = { 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, PACER_UNLIMITED };
+#define SPEED_STEP_COUNT (sizeof(SPEED_STEPS) / sizeof(SPEED_STEPS[0]))
 
-static inline uint64_t get_time_us() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000000ULL + (ts.tv_nsec / 1000ULL);
+typedef struct {
+    char* rom_path;
+    uint8_t rewind;
+    RewindConfig rewind_config;
+    uint8_t runahead_frames;
+    uint8_t vsync;
+    uint8_t pacing_stats;
+    double speed;
+    char* state_path;
+    char* record_path;
+    char* play_path;
+    char* verify_path;
+    uint32_t verify_jobs;
+    uint32_t checkpoint_interval;
+    uint8_t headless;
+    char* profile_path;
+    char* trace_path;
+    char* guest_profile_path;
+    char* symbols_path;
+    uint8_t overlay;
+    uint8_t telemetry_log;
+    char* metrics_path;
+    char* save_path;
+    uint8_t mute;
+    char* audio_out_path;
+} Options;
+
+static Options parse_options(int argc, char **argv)
+{
+    Options options = { 0 };
+    options.rewind_config = rewind_default_config();
+    options.speed = 1.0;
+    options.checkpoint_interval = MOVIE_DEFAULT_CHECKPOINT_INTERVAL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        char* arg = argv[i];
+        char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--rewind") == 0)
+        {
+            options.rewind = 1;
+        }
+        else if (strcmp(arg, "--rewind-budget") == 0 && value != NULL)
+        {
+            // in megabytes
+            options.rewind = 1;
+            options.rewind_config.budget_bytes = (size_t)(atof(value) * 1024 * 1024);
+            i++;
+        }
+        else if (strcmp(arg, "--rewind-interval") == 0 && value != NULL)
+        {
+            options.rewind = 1;
+            options.rewind_config.capture_interval = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--rewind-keyframes") == 0 && value != NULL)
+        {
+            options.rewind = 1;
+            options.rewind_config.keyframe_interval = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--vsync") == 0)
+        {
+            options.vsync = 1;
+        }
+        else if (strcmp(arg, "--pacing-stats") == 0)
+        {
+            options.pacing_stats = 1;
+        }
+        else if (strcmp(arg, "--speed") == 0 && value != NULL)
+        {
+            // a multiplier over real time, 0 or "max" for unthrottled
+            options.speed = strcmp(value, "max") == 0 ? PACER_UNLIMITED : atof(value);
+            if (options.speed != PACER_UNLIMITED && options.speed < SPEED_STEPS[0])
+                options.speed = SPEED_STEPS[0];
+            i++;
+        }
+        else if (strcmp(arg, "--load-state") == 0 && value != NULL)
+        {
+            options.state_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--record") == 0 && value != NULL)
+        {
+            options.record_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--play") == 0 && value != NULL)
+        {
+            options.play_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--checkpoint-interval") == 0 && value != NULL)
+        {
+            options.checkpoint_interval = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--verify") == 0 && value != NULL)
+        {
+            options.verify_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--jobs") == 0 && value != NULL)
+        {
+            options.verify_jobs = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--headless") == 0)
+        {
+            options.headless = 1;
+        }
+        else if (strcmp(arg, "--trace") == 0 && value != NULL)
+        {
+            options.trace_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--profile") == 0 && value != NULL)
+        {
+            options.profile_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--guest-profile") == 0 && value != NULL)
+        {
+            options.guest_profile_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--symbols") == 0 && value != NULL)
+        {
+            options.symbols_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--overlay") == 0)
+        {
+            options.overlay = 1;
+        }
+        else if (strcmp(arg, "--telemetry") == 0)
+        {
+            options.telemetry_log = 1;
+        }
+        else if (strcmp(arg, "--metrics") == 0 && value != NULL)
+        {
+            options.metrics_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--save") == 0 && value != NULL)
+        {
+            options.save_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--no-audio") == 0)
+        {
+            options.mute = 1;
+        }
+        else if (strcmp(arg, "--audio-out") == 0 && value != NULL)
+        {
+            options.audio_out_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--runahead") == 0 && value != NULL)
+        {
+            options.runahead_frames = atoi(value);
+            i++;
+        }
+        else
+        {
+            options.rom_path = arg;
+        }
+    }
+
+    return options;
+}
+
+static double step_speed(double speed, int8_t steps)
+{
+    size_t index = 0;
+    while (index + 1 < SPEED_STEP_COUNT && SPEED_STEPS[index] != PACER_UNLIMITED && SPEED_STEPS[index] < speed)
+        index++;
+
+    if (speed == PACER_UNLIMITED)
+        index = SPEED_STEP_COUNT - 1;
+
+    int target = (int)index + steps;
+    if (target < 0)
+        target = 0;
+    if (target >= (int)SPEED_STEP_COUNT)
+        target = SPEED_STEP_COUNT - 1;
+
+    return SPEED_STEPS[target];
+}
+
+// above the display rate there's no point drawing every frame, only those that will be shown
+static uint8_t should_present(double speed, double refresh_rate, uint64_t last_present, uint64_t now)
+{
+    if (speed != PACER_UNLIMITED && GB_FPS * speed <= refresh_rate)
+        return 1;
+
+    return now - last_present >= (uint64_t)(1000000000.0 / refresh_rate);
+}
+
+static void print_playback_result(MoviePlayer* player, uint64_t elapsed_ns)
+{
+    double seconds = elapsed_ns / 1e9;
+
+    printf("movie: %u frames, %u events in %.2fs (%.1f fps)\n",
+        player->frame, player->next_event, seconds, seconds > 0 ? player->frame / seconds : 0.0);
+
+    if (player->mismatches == 0)
+        printf("movie: verified, all checksums match\n");
+    else
+        printf("movie: %u checksum mismatches, first at frame %u\n", player->mismatches, player->first_mismatch);
+}
+
+// the rom path with its extension replaced, e.g. game.gb -> game.sav
+static uint8_t rom_sibling_path(const char* rom_path, const char* extension, char* out, size_t size)
+{
+    const char* dot = strrchr(rom_path, '.');
+    const char* slash = strrchr(rom_path, '/');
+    size_t length = dot != NULL && (slash == NULL || dot > slash) ? (size_t)(dot - rom_path) : strlen(rom_path);
+
+    if (length + strlen(extension) + 1 > size)
+        return 0;
+
+    snprintf(out, size, "%.*s%s", (int)length, rom_path, extension);
+
+    return 1;
+}
+
+// rgbds writes game.sym next to game.gb, use it unless another file was given
+static void start_guest_profiler(GameBoy* gb, Options* options)
+{
+    GuestProfiler* gp = guestprof_init();
+
+    if (options->symbols_path != NULL)
+    {
+        if (!guestprof_load_symbols(gp, options->symbols_path))
+            printf("couldn't read symbols %s\n", options->symbols_path);
+    }
+    else
+    {
+        char path[4096];
+        if (rom_sibling_path(options->rom_path, ".sym", path, sizeof(path)))
+            guestprof_load_symbols(gp, path);
+    }
+
+    gb->guest_profiler = gp;
+}
+
+static void finish_guest_profiler(GameBoy* gb, const char* path)
+{
+    GuestProfiler* gp = gb->guest_profiler;
+    if (gp == NULL)
+        return;
+
+    guestprof_print_top(gp, stdout, 20);
+
+    if (!guestprof_write_folded(gp, path))
+        printf("couldn't write guest profile %s\n", path);
+
+    gb->guest_profiler = NULL;
+    guestprof_free(gp);
+}
+
+// replays a movie as fast as possible without a window; frames are never drawn.
+// with a writer the sound is captured, the same for every run of the same movie
+static int run_headless(GameBoy* gb, Movie* movie, WavWriter* wav)
+{
+    MoviePlayer player;
+    if (!movie_player_start(&player, movie, gb))
+    {
+        printf("movie: recorded on a different rom or has an unreadable start state\n");
+        return 1;
+    }
+
+    gb->ppu->skip_render = 1;
+
+    uint64_t start = pacer_now_ns();
+    while (!movie_player_done(&player))
+    {
+        movie_player_run_frame(&player, gb);
+
+        if (wav != NULL)
+            wav_write(wav, gb->apu->mixer->samples, gb->apu->mixer->sample_count);
+    }
+
+    print_playback_result(&player, pacer_now_ns() - start);
+
+    return player.mismatches != 0;
 }
 
 int main(int argc, char **argv)
 {
-    Memory* mem = memory_init();
-    Cpu* cpu = cpu_init();
-    Ppu* ppu = ppu_init();
-    Timer timer = { 0, 0 };
+    Options options = parse_options(argc, argv);
+    assert(options.rom_path != NULL);
+
+    if (options.headless && options.play_path == NULL)
+    {
+        printf("--headless replays a movie, pass one with --play\n");
+        return 1;
+    }
+
+    GameBoy* gb = gameboy_init();
+    Rewind* rw = options.rewind ? rewind_init(options.rewind_config) : NULL;
+    RunAhead* ra = options.runahead_frames ? runahead_init(options.runahead_frames) : NULL;
+
+    load_rom(gb->mem, options.rom_path);
+
+    // battery saves go to game.sav next to the rom. movies and states bring their own
+    // cartridge ram, those runs leave the player's save alone
+    Battery* battery = NULL;
+    if (options.verify_path == NULL && !options.headless && options.play_path == NULL
+        && options.state_path == NULL)
+    {
+        char path[4096];
+        if (options.save_path != NULL)
+            battery = battery_open(gb->mem, options.save_path);
+        else if (rom_sibling_path(options.rom_path, ".sav", path, sizeof(path)))
+            battery = battery_open(gb->mem, path);
+    }
+
+#ifdef OAMX_PROFILE
+    PROF_INIT(options.profile_path != NULL ? fopen(options.profile_path, "w") : NULL);
+#else
+    if (options.profile_path != NULL)
+        printf("--profile needs a build with PROFILE=1\n");
+#endif
+
+    if (options.guest_profile_path != NULL)
+        start_guest_profiler(gb, &options);
+
+    if (options.state_path != NULL && !savestate_read_file(gb, options.state_path))
+    {
+        printf("couldn't load state %s\n", options.state_path);
+        return 1;
+    }
+
+    if (options.verify_path != NULL)
+    {
+        Movie* movie = movie_read_file(options.verify_path);
+        if (movie == NULL)
+        {
+            printf("couldn't read movie %s\n", options.verify_path);
+            return 1;
+        }
+
+        // the host profiler and the memory counters are process wide, unlocked globals:
+        // builds with either check one segment at a time so their figures stay whole
+        uint32_t jobs = options.verify_jobs;
+#if defined(OAMX_PROFILE) || defined(OAMX_MEMSTATS)
+        jobs = 1;
+#endif
+
+        VerifyResult result;
+        uint8_t verified = movie_verify(movie, gb, jobs, &result);
+
+        if (result.status == VERIFY_OTHER_ROM)
+            printf("verify: movie was recorded on a different rom\n");
+        else if (result.status == VERIFY_EMPTY)
+            printf("verify: movie has no frames to check\n");
+        else
+            verify_print_result(&result);
+
+        PROF_FINISH(stdout);
+        MEMSTATS_FINISH(stdout);
+        movie_free(movie);
+        gameboy_free(gb);
+
+        return !verified;
+    }
+
+    // opened after --verify: its workers run in parallel and the tracer is a single
+    // unlocked buffer
+    if (options.trace_path != NULL && !trace_open(options.trace_path))
+        printf("couldn't write trace %s\n", options.trace_path);
+
+    Movie* playback = NULL;
+    if (options.play_path != NULL)
+    {
+        playback = movie_read_file(options.play_path);
+        if (playback == NULL)
+        {
+            printf("couldn't read movie %s\n", options.play_path);
+            trace_close();
+            return 1;
+        }
+    }
+
+    if (options.headless)
+    {
+        WavWriter* wav = NULL;
+        Mixer* mixer = NULL;
+        if (options.audio_out_path != NULL)
+        {
+            wav = wav_open(options.audio_out_path, AUDIO_SAMPLE_RATE);
+            if (wav == NULL)
+            {
+                printf("couldn't write audio %s\n", options.audio_out_path);
+                trace_close();
+                return 1;
+            }
+
+            mixer = mixer_init(AUDIO_SAMPLE_RATE, GB_CLOCK_SPEED);
+            apu_set_mixer(gb->apu, gb->mem, mixer);
+        }
+
+        int result = run_headless(gb, playback, wav);
+
+        if (wav != NULL)
+        {
+            uint64_t frames = wav->queued;
+            if (!wav_close(wav))
+            {
+                printf("couldn't write audio %s\n", options.audio_out_path);
+                result = 1;
+            }
+            else
+                printf("audio: %.1fs written to %s\n", (double)frames / AUDIO_SAMPLE_RATE, options.audio_out_path);
+        }
+        finish_guest_profiler(gb, options.guest_profile_path);
+        PROF_FINISH(stdout);
+        MEMSTATS_FINISH(stdout);
+        trace_close();
+        movie_free(playback);
+        gameboy_free(gb);
+
+        if (mixer != NULL)
+            mixer_free(mixer);
+
+        return result;
+    }
+
+    MoviePlayer player;
+    uint64_t playback_start = pacer_now_ns();
+    if (playback != NULL && !movie_player_start(&player, playback, gb))
+    {
+        printf("movie: recorded on a different rom or has an unreadable start state\n");
+        trace_close();
+        return 1;
+    }
+
+    Movie* recording = NULL;
+    if (options.record_path != NULL)
+    {
+        recording = movie_init();
+        recording->header.checkpoint_interval = options.checkpoint_interval;
+        movie_record_start(recording, gb);
+    }
 
     DisplayContext ctx;
+    ctx.vsync = options.vsync;
     display_init(&ctx);
+    ctx.overlay = options.overlay;
+
+    double refresh_rate = display_refresh_rate();
+    uint8_t vsync_paces = options.vsync && pacer_vsync_paces(GB_FPS, refresh_rate);
+    if (options.vsync && !vsync_paces)
+        printf("vsync: %.0f Hz display doesn't match the game boy, pacing with timers\n", refresh_rate);
+
+    Pacer pacer;
+    pacer_init(&pacer, GB_FPS, vsync_paces);
+
+    // the apu is only synthesized when there's a device to play it on
+    AudioRing* audio = NULL;
+    Mixer* mixer = NULL;
+    if (!options.mute)
+    {
+        audio = ring_init(AUDIO_RING_FRAMES);
+        if (audio_open(audio, AUDIO_SAMPLE_RATE))
+        {
+            mixer = mixer_init(AUDIO_SAMPLE_RATE, GB_CLOCK_SPEED);
+            apu_set_mixer(gb->apu, gb->mem, mixer);
+            pacer_set_audio(&pacer, audio, AUDIO_TARGET_FRAMES);
+        }
+        else
+        {
+            ring_free(audio);
+            audio = NULL;
+        }
+    }
+
+    uint64_t last_present = 0;
 
-    assert(argc > 1);
-    load_rom(mem, argv[1]);
+    uint8_t buttons = INPUT_RELEASED;
+
+    Telemetry telemetry;
+    telemetry_init(&telemetry, GB_FPS);
+    uint32_t emulated_frames = 0;
 
-    uint64_t next_frame_time = get_time_us() + FRAME_DURATION;
     while (ctx.is_running)
     {
-        update_key_states(mem);
+        // wait first and sample the host as late as possible, right before the frame
+        // that will react to it is emulated and presented
+        uint64_t frame_start = pacer.last_frame;
+        uint64_t slept = pacer.sleep_ns;
+        pacer_wait(&pacer);
+
+        if (mixer != NULL)
+            mixer_set_rate(mixer, (uint32_t)(AUDIO_SAMPLE_RATE * pacer.audio_ratio + 0.5));
+
+        telemetry_record(&telemetry, pacer.last_frame - frame_start, pacer.sleep_ns - slept, emulated_frames);
+        emulated_frames = 0;
+
+        if (options.telemetry_log && telemetry.frames % TELEMETRY_WINDOW == 0)
+            telemetry_print(&telemetry, stdout);
 
-        uint32_t frame_ticks = 0;
-        while (frame_ticks < TICKS_PER_FRAME)
+        // refreshed a few times a second, faster would be unreadable
+        if (ctx.overlay && telemetry.frames % 15 == 1)
         {
-            uint16_t ticks = cpu_step(cpu, mem);
-            ppu_step(ppu, mem, ticks);
-            handle_interrupts(cpu, ppu, mem);
-            timer_update(&timer, mem, ticks);
-            frame_ticks += ticks;
+            char text[128];
+            TelemetrySnapshot snapshot;
+            telemetry_snapshot(&telemetry, 0, &snapshot);
+            telemetry_format_overlay(&snapshot, text, sizeof(text));
+            display_set_overlay(text);
         }
-    
-        uint64_t now = get_time_us();
-        if (now < next_frame_time)
+        else if (!ctx.overlay)
+            display_set_overlay(NULL);
+
+        display_poll(&ctx);
+        if (!ctx.is_running)
+            break;
+
+        if (ctx.speed_steps != 0)
         {
-            uint64_t sleep_us = next_frame_time - now;
-            struct timespec ts;
-            ts.tv_sec = sleep_us / 1000000ULL;
-            ts.tv_nsec = (sleep_us % 1000000ULL) * 1000ULL;
-            nanosleep(&ts, NULL);
+            options.speed = step_speed(options.speed, ctx.speed_steps);
+            ctx.speed_steps = 0;
+
+            if (options.speed == PACER_UNLIMITED)
+                printf("speed: unlimited\n");
+            else
+                printf("speed: %.2fx\n", options.speed);
         }
-        next_frame_time += FRAME_DURATION;
 
-        display_poll(&ctx);
+        double speed = ctx.fast_forward ? PACER_UNLIMITED : options.speed;
+        pacer_set_speed(&pacer, speed);
+
+        uint64_t now = pacer_now_ns();
+        uint8_t present = should_present(speed, refresh_rate, last_present, now);
+        if (present)
+            last_present = now;
+
+        gb->ppu->skip_render = !present;
+
+        // rewinding would desync a movie being recorded or played back
+        if (rw != NULL && ctx.rewinding && recording == NULL && playback == NULL)
+        {
+            if (rewind_step_back(rw, gb) && present)
+                display_render(gb->ppu);
+
+            continue;
+        }
+
+        if (playback != NULL)
+        {
+            movie_player_feed(&player, gb);
+        }
+        else
+        {
+            uint8_t sampled = display_read_buttons();
+            if (sampled != buttons)
+            {
+                input_queue_push(&gb->input, gb->mem->cycles, sampled);
+                buttons = sampled;
+
+                if (recording != NULL)
+                    movie_record_input(recording, gb->mem->cycles, sampled);
+            }
+        }
+
+        emulated_frames++;
+
+        if (ra != NULL)
+        {
+            runahead_run_frame(ra, gb, display_render);
+        }
+        else
+        {
+            gameboy_run_frame(gb);
+
+            if (gb->ppu->frame_ready && present)
+                display_render(gb->ppu);
+
+            gb->ppu->frame_ready = 0;
+        }
+
+        // off 1x the samples don't come at the device's pace, so sound is muted
+        if (audio != NULL && speed == 1.0)
+            ring_write(audio, mixer->samples, mixer->sample_count);
+
+        if (recording != NULL)
+            movie_record_frame(recording, gb);
+
+        if (playback != NULL)
+        {
+            movie_player_end_frame(&player, gb);
+
+            // once the movie ends, control goes back to the keyboard
+            if (movie_player_done(&player))
+            {
+                print_playback_result(&player, pacer_now_ns() - playback_start);
+                movie_free(playback);
+                playback = NULL;
+            }
+        }
+
+        if (rw != NULL)
+            rewind_capture(rw, gb);
     }
 
+    if (recording != NULL)
+    {
+        if (!movie_write_file(recording, options.record_path))
+            printf("couldn't write movie %s\n", options.record_path);
+
+        movie_free(recording);
+    }
+
+    if (playback != NULL)
+        movie_free(playback);
+
+    if (options.pacing_stats)
+        pacer_print_stats(&pacer);
+
+    if (options.pacing_stats && audio != NULL)
+        printf("audio: %llu underruns\n", (unsigned long long)audio_underruns());
+
+    if (options.metrics_path != NULL && !telemetry_write_metrics(&telemetry, options.metrics_path))
+        printf("couldn't write metrics %s\n", options.metrics_path);
+
+    finish_guest_profiler(gb, options.guest_profile_path);
+    PROF_FINISH(stdout);
+    MEMSTATS_FINISH(stdout);
+    trace_close();
+
+    if (rw != NULL)
+    {
+        rewind_print_stats(rw);
+        rewind_free(rw);
+    }
+
+    if (ra != NULL)
+        runahead_free(ra);
+
+    if (battery != NULL)
+        battery_close(battery, gb->mem);
+
+    if (audio != NULL)
+    {
+        audio_close();
+        ring_free(audio);
+        mixer_free(mixer);
+    }
+
+    gameboy_free(gb);
+
     return 0;
 }
\ No newline at end of file
@@ -1,126 +1,373 @@
 #include "../inc/mbc.h"
 #include "../inc/memory.h"
+#include "../inc/rom.h"
+#include "../inc/trace.h"
+#include "../inc/memstats.h"
+#include "../inc/battery.h"
 
-// --- MBC1 and MBC_NONE implementations --- //
+#define ROM_BANK_SIZE 0x4000
+#define RAM_BANK_SIZE 0x2000
 
-void rom_write_mbc_none(Memory* memory, uint16_t addr, uint8_t value)
+// banks the header declares, always a power of two
+static uint32_t rom_bank_mask(Memory* mem)
 {
-    // no writes to rom for mbc none
+    return rom_size(mem) / ROM_BANK_SIZE - 1;
 }
 
-uint8_t rom_read_mbc_none(Memory* memory, uint16_t addr)
+// ram banks the header declares, bank numbers past them mirror back onto the cart's
+// ram instead of reaching memory the .sav doesn't cover. smaller rams use bank 0
+static uint32_t ram_bank_mask(Memory* mem)
 {
-    if (addr < 0 || addr > 0x8000)
-        return 0xFF;
-        
-    return memory->rom[addr];    
+    uint32_t banks = rom_ram_size(mem) / RAM_BANK_SIZE;
+    return banks > 0 ? banks - 1 : 0;
 }
 
+// --- MBC_NONE --- //
+
 // some cartridges without an MBC chip may include a fixed 8 KB SRAM at $A000–$BFFF.
 // in this case, the game code can read/write this RAM, even without banking logic.
 // most MBC-less cartridges, however, do not have external RAM, so accesses to this area would do nothing.
-void ram_write_mbc_none(Memory* memory, uint16_t addr, uint8_t value)
+static uint8_t control_none(Memory* mem, uint16_t addr, uint8_t value)
 {
-    if (addr < 0xA000 || addr > 0xBFFF)
-        return;
-
-    memory->sram[addr - 0xA000] = value;
+    // no writes to rom for mbc none
+    return 0;
 }
 
-uint8_t ram_read_mbc_none(Memory* memory, uint16_t addr)
+static MbcBanks banks_none(Memory* mem)
 {
-    if (addr < 0xA000 || addr > 0xBFFF)
-        return 0xFF;
-
-    return memory->sram[addr - 0xA000];
+    return (MbcBanks) { 0, 1, 0 };
 }
 
-void rom_write_mbc1(Memory* memory, uint16_t addr, uint8_t value)
+// --- MBC1 --- //
+
+static uint8_t control_mbc1(Memory* mem, uint16_t addr, uint8_t value)
 {
+    MBC* mbc = &mem->mbc;
+
     if (addr <= 0x1FFF)
     {
-        memory->mbc.ram_enabled = (value & 0x0F) == 0x0A;
+        mbc->ram_enabled = (value & 0x0F) == 0x0A;
     }
     else if (addr <= 0x3FFF)
     {
-        uint8_t rom_size_code = memory->rom[0x148];
+        uint8_t rom_size_code = mem->rom[0x148];
         uint8_t mask = (2 << rom_size_code) - 1;
 
-        memory->mbc.rom_bank = (value & 0x1F) & mask;
+        mbc->rom_bank = (value & 0x1F) & mask;
 
         // for MBC1, bank 0 is normally translated to bank 1 in the switchable ROM area.
         // however, the original MBC1 chips have a 5-bit trick: if a cartridge uses only 4 bits (16 banks),
         // the highest bit (5th bit) is ignored and switching to bank 0 would be possible in this scenario.
         // e.g.: 0b10000 -> 0b0000
         // this simplification ignores it.
-        memory->mbc.rom_bank = memory->mbc.rom_bank == 0 ? 1 : memory->mbc.rom_bank;
+        mbc->rom_bank = mbc->rom_bank == 0 ? 1 : mbc->rom_bank;
+        return MBC_WROTE_ROM_BANK;
     }
     else if (addr <= 0x5FFF)
     {
         uint8_t ram_bank = value & 0x03;
 
-        if (memory->mbc.banking_mode == 0)
+        if (mbc->banking_mode == 0)
         {
-            memory->mbc.rom_bank = (ram_bank << 5) | (memory->mbc.rom_bank & 0x1F);
-            return;
+            mbc->rom_bank = (ram_bank << 5) | (mbc->rom_bank & 0x1F);
+            return MBC_WROTE_ROM_BANK;
         }
 
-        memory->mbc.ram_bank = ram_bank;
+        mbc->ram_bank = ram_bank;
+        return MBC_WROTE_RAM_BANK;
     }
-    else if (addr <= 0x7FFF)
+    else
     {
-        memory->mbc.banking_mode = value & 0x01;
+        mbc->banking_mode = value & 0x01;
     }
+
+    return 0;
 }
 
-uint8_t rom_read_mbc1(Memory* memory, uint16_t addr)
+static MbcBanks banks_mbc1(Memory* mem)
 {
-    if (addr <= 0x3FFF)
-        return rom_read_mbc_none(memory, addr);
+    MBC* mbc = &mem->mbc;
 
-    if (addr >= 0x8000)
-        return 0xFF;
-
-    uint8_t bank = memory->mbc.rom_bank;
     // bank 0 is fixed, so we set it to bank 1
-    if (bank == 0)
-        bank = 1;
+    MbcBanks banks = { 0, mbc->rom_bank == 0 ? 1 : mbc->rom_bank, MBC_RAM_UNMAPPED };
+
+    if (mbc->ram_enabled)
+        banks.ram = mbc->banking_mode == 0 ? 0 : mbc->ram_bank;
 
-    uint32_t final_addr = 0x4000 * bank + (addr - 0x4000);
-    return memory->rom[final_addr];
+    return banks;
 }
 
-void ram_write_mbc1(Memory* memory, uint16_t addr, uint8_t value)
+// --- MBC3 --- //
+
+// advances the clock to the current cycle count
+void mbc_rtc_sync(Memory* mem)
 {
-    if (addr < 0xA000 || addr > 0xBFFF)
+    MbcRtc* rtc = &mem->mbc.rtc;
+    uint64_t elapsed = mem->cycles - rtc->synced;
+    rtc->synced = mem->cycles;
+
+    if (rtc->halt)
         return;
 
-    if (memory->mbc.ram_enabled == 0)
+    uint64_t ticks = rtc->subsecond + elapsed;
+    uint64_t seconds = ticks / RTC_TICKS_PER_SECOND;
+    rtc->subsecond = ticks % RTC_TICKS_PER_SECOND;
+
+    if (seconds == 0)
         return;
 
-    if (memory->mbc.banking_mode == 0)
+    uint64_t total = rtc->seconds + seconds;
+    rtc->seconds = total % 60;
+    total = rtc->minutes + total / 60;
+    rtc->minutes = total % 60;
+    total = rtc->hours + total / 60;
+    rtc->hours = total % 24;
+    total = rtc->days + total / 24;
+
+    if (total > 0x1FF)
+        rtc->carry = 1;
+
+    rtc->days = total & 0x1FF;
+}
+
+static void rtc_latch(MbcRtc* rtc)
+{
+    rtc->latched[0] = rtc->seconds;
+    rtc->latched[1] = rtc->minutes;
+    rtc->latched[2] = rtc->hours;
+    rtc->latched[3] = rtc->days & 0xFF;
+    rtc->latched[4] = (rtc->days >> 8) | (rtc->halt << 6) | (rtc->carry << 7);
+}
+
+static uint8_t control_mbc3(Memory* mem, uint16_t addr, uint8_t value)
+{
+    MBC* mbc = &mem->mbc;
+
+    if (addr <= 0x1FFF)
     {
-        memory->sram[addr - 0xA000] = value;
-        return;
+        // enables the rtc registers along with the ram
+        mbc->ram_enabled = (value & 0x0F) == 0x0A;
+    }
+    else if (addr <= 0x3FFF)
+    {
+        uint8_t bank = value & 0x7F;
+        mbc->rom_bank = (bank == 0 ? 1 : bank) & rom_bank_mask(mem);
+        return MBC_WROTE_ROM_BANK;
+    }
+    else if (addr <= 0x5FFF)
+    {
+        if (value >= 0x08 && value <= 0x0C)
+        {
+            mbc->rtc_select = value;
+            return 0;
+        }
+
+        // 4 banks on mbc3, 8 on mbc30
+        mbc->rtc_select = 0;
+        mbc->ram_bank = value & 0x07;
+        return MBC_WROTE_RAM_BANK;
+    }
+    else
+    {
+        // writing 0 then 1 copies the running clock into the readable registers
+        if (mbc->rtc.latch == 0x00 && value == 0x01)
+        {
+            mbc_rtc_sync(mem);
+            rtc_latch(&mbc->rtc);
+        }
+
+        mbc->rtc.latch = value;
     }
 
-    uint16_t final_addr = memory->mbc.ram_bank * 0x2000 + (addr - 0xA000);
+    return 0;
+}
+
+static MbcBanks banks_mbc3(Memory* mem)
+{
+    MBC* mbc = &mem->mbc;
+    MbcBanks banks = { 0, mbc->rom_bank == 0 ? 1 : mbc->rom_bank, MBC_RAM_UNMAPPED };
+
+    if (mbc->ram_enabled && mbc->rtc_select == 0)
+        banks.ram = mbc->ram_bank;
 
-    memory->sram[final_addr] = value;
+    return banks;
 }
 
-uint8_t ram_read_mbc1(Memory* memory, uint16_t addr)
+static uint8_t rtc_read(Memory* mem, uint16_t addr)
 {
-    if (addr < 0xA000 || addr > 0xBFFF)
+    MBC* mbc = &mem->mbc;
+
+    if (!mbc->ram_enabled || mbc->rtc_select == 0)
         return 0xFF;
 
-    if (memory->mbc.ram_enabled == 0)
+    return mbc->rtc.latched[mbc->rtc_select - 0x08];
+}
+
+static void rtc_write(Memory* mem, uint16_t addr, uint8_t value)
+{
+    MBC* mbc = &mem->mbc;
+    MbcRtc* rtc = &mbc->rtc;
+
+    if (!mbc->ram_enabled || mbc->rtc_select == 0)
+        return;
+
+    // writes land in the running counters, bring them up to date first
+    mbc_rtc_sync(mem);
+
+    switch (mbc->rtc_select)
+    {
+        case 0x08:
+            rtc->seconds = value & 0x3F;
+            rtc->subsecond = 0;
+            break;
+        case 0x09:
+            rtc->minutes = value & 0x3F;
+            break;
+        case 0x0A:
+            rtc->hours = value & 0x1F;
+            break;
+        case 0x0B:
+            rtc->days = (rtc->days & 0x100) | value;
+            break;
+        case 0x0C:
+            rtc->days = (rtc->days & 0xFF) | ((value & 0x01) << 8);
+            rtc->halt = (value >> 6) & 0x01;
+            rtc->carry = (value >> 7) & 0x01;
+            break;
+    }
+}
+
+// --- MBC5 --- //
+
+static uint8_t control_mbc5(Memory* mem, uint16_t addr, uint8_t value)
+{
+    MBC* mbc = &mem->mbc;
+
+    if (addr <= 0x1FFF)
+    {
+        mbc->ram_enabled = (value & 0x0F) == 0x0A;
+    }
+    else if (addr <= 0x2FFF)
+    {
+        mbc->rom_bank = (mbc->rom_bank & 0x100) | value;
+        return MBC_WROTE_ROM_BANK;
+    }
+    else if (addr <= 0x3FFF)
+    {
+        mbc->rom_bank = (mbc->rom_bank & 0xFF) | ((value & 0x01) << 8);
+        return MBC_WROTE_ROM_BANK;
+    }
+    else if (addr <= 0x5FFF)
+    {
+        // bit 3 drives the motor on rumble carts, only the bits below it pick a bank
+        mbc->ram_bank = value & (rom_has_rumble(mem) ? 0x07 : 0x0F);
+        return MBC_WROTE_RAM_BANK;
+    }
+
+    return 0;
+}
+
+static MbcBanks banks_mbc5(Memory* mem)
+{
+    MBC* mbc = &mem->mbc;
+
+    // no bank 0 translation, and the unused upper bits simply aren't wired
+    MbcBanks banks = { 0, mbc->rom_bank & rom_bank_mask(mem), MBC_RAM_UNMAPPED };
+
+    if (mbc->ram_enabled)
+        banks.ram = mbc->ram_bank;
+
+    return banks;
+}
+
+static const Mapper MAPPERS[MBC_TYPE_COUNT] = {
+    [MBC_NONE] = { MBC_NONE, "none", control_none, banks_none, NULL, NULL },
+    [MBC1]     = { MBC1, "mbc1", control_mbc1, banks_mbc1, NULL, NULL },
+    [MBC3]     = { MBC3, "mbc3", control_mbc3, banks_mbc3, rtc_read, rtc_write },
+    [MBC5]     = { MBC5, "mbc5", control_mbc5, banks_mbc5, NULL, NULL },
+};
+
+// --- shared layer --- //
+
+void mbc_update_mapping(Memory* mem)
+{
+    MBC* mbc = &mem->mbc;
+    MbcBanks banks = mbc->mapper->banks(mem);
+    uint32_t rom_banks = sizeof(mem->rom) / ROM_BANK_SIZE;
+
+    banks.rom0 &= rom_banks - 1;
+    banks.romx &= rom_banks - 1;
+
+    mbc->rom0 = &mem->rom[banks.rom0 * ROM_BANK_SIZE];
+    mbc->romx = &mem->rom[banks.romx * ROM_BANK_SIZE];
+    mbc->romx_bank = banks.romx;
+
+    if (banks.ram == MBC_RAM_UNMAPPED)
+        mbc->ram = NULL;
+    else
+        mbc->ram = &mem->sram[(banks.ram & ram_bank_mask(mem)) * RAM_BANK_SIZE];
+}
+
+void mbc_control_write(Memory* mem, uint16_t addr, uint8_t value)
+{
+    MBC* mbc = &mem->mbc;
+#ifdef OAMX_MEMSTATS
+    // only read to tell redundant bank switches apart
+    uint16_t rom_bank = mbc->rom_bank;
+    uint8_t ram_bank = mbc->ram_bank;
+#endif
+    uint8_t ram_enabled = mbc->ram_enabled;
+
+    uint8_t wrote = mbc->mapper->control(mem, addr, value);
+
+    if (wrote & MBC_WROTE_ROM_BANK)
+    {
+        TRACE_INSTANT("rom bank", "mbc", "bank", mbc->rom_bank);
+        MEMSTATS_BANK_SWITCH(mbc->rom_bank != rom_bank);
+    }
+
+    if (wrote & MBC_WROTE_RAM_BANK)
+    {
+        TRACE_INSTANT("ram bank", "mbc", "bank", mbc->ram_bank);
+        MEMSTATS_BANK_SWITCH(mbc->ram_bank != ram_bank);
+    }
+
+    // games disable ram once they are done saving, a good moment to persist it
+    if (ram_enabled && !mbc->ram_enabled && mem->sram_dirty && mem->battery != NULL)
+    {
+        mem->sram_dirty = 0;
+        battery_request_flush(mem->battery);
+    }
+
+    mbc_update_mapping(mem);
+}
+
+uint8_t mbc_ram_read(Memory* mem, uint16_t addr)
+{
+    if (mem->mbc.mapper->ram_read == NULL)
         return 0xFF;
 
-    if (memory->mbc.banking_mode == 0)
-        return memory->sram[addr - 0xA000];
+    return mem->mbc.mapper->ram_read(mem, addr);
+}
+
+void mbc_ram_write(Memory* mem, uint16_t addr, uint8_t value)
+{
+    if (mem->mbc.mapper->ram_write != NULL)
+        mem->mbc.mapper->ram_write(mem, addr, value);
+}
 
-    uint16_t final_addr = memory->mbc.ram_bank * 0x2000 + (addr - 0xA000);
+const char* mbc_name(MBCType type)
+{
+    return type < MBC_TYPE_COUNT ? MAPPERS[type].name : "unknown";
+}
+
+// switches the mapper, keeping the bank registers as they are
+void set_mbc_type(Memory* mem, MBCType type)
+{
+    if (type >= MBC_TYPE_COUNT)
+        type = MBC1;
 
-    return memory->sram[final_addr];
+    mem->mbc.mbc_type = type;
+    mem->mbc.mapper = &MAPPERS[type];
+    mbc_update_mapping(mem);
 }
\ No newline at end of file
@@ -1,70 +1,163 @@
 #include "../inc/memory.h"
+#include "../inc/apu.h"
+#include "../inc/hostprof.h"
+#include "../inc/memstats.h"
+#include "../inc/platform.h"
 #include <stdlib.h>
 #include <string.h>
 
-void memory_write(Memory* mem, uint16_t addr, uint8_t value)
+// the named registers have to land on their address in io[]
+#define IO_OFFSET(field) (offsetof(Memory, field) - offsetof(Memory, io))
+_Static_assert(IO_OFFSET(div) == (DIV_ADDR & 0x7F), "io layout");
+_Static_assert(IO_OFFSET(IF) == (IF_ADDR & 0x7F), "io layout");
+_Static_assert(IO_OFFSET(lcdc) == (LCDC_ADDR & 0x7F), "io layout");
+_Static_assert(IO_OFFSET(wx) == (WX_ADDR & 0x7F), "io layout");
+_Static_assert(sizeof(((Memory*)0)->io) == 0x80, "io layout");
+
+static inline uint8_t memory_read_dispatch(Memory* mem, uint16_t addr);
+
+// the source page as a plain array, or NULL when reads have to go through the handlers
+static const uint8_t* dma_source(Memory* mem, uint8_t page)
+{
+    uint16_t addr = page << 8;
+
+    if (page <= 0x3F)
+        return &mem->mbc.rom0[addr];
+    if (page <= 0x7F)
+        return &mem->mbc.romx[addr - 0x4000];
+    if (page <= 0x9F)
+        return &mem->vram[addr - 0x8000];
+
+    // unmapped or mbc3 rtc registers
+    if (page <= 0xBF)
+        return mem->mbc.ram != NULL ? &mem->mbc.ram[addr - 0xA000] : NULL;
+
+    if (page <= 0xCF)
+        return &mem->wram0[addr - 0xC000];
+    if (page <= 0xDF)
+        return &mem->wram1[addr - 0xD000];
+    if (page <= 0xEF)
+        return &mem->wram0[addr - 0xE000];
+    if (page <= 0xFD)
+        return &mem->wram1[addr - 0xF000];
+
+    return NULL;
+}
+
+static void memory_dma_start(Memory* mem, uint8_t page)
 {
-    switch (addr)
+    const uint8_t* source = dma_source(mem, page);
+
+    if (source != NULL)
     {
-        case JOYP_ADDR:
-            mem->joyp = (mem->joyp & 0x0F) | (value & 0x30) | 0xC0;
-            break;
-        case DIV_ADDR:
-            mem->div = value;
-            break;
-        case TIMA_ADDR:
-            mem->tima = value;
-            break;
-        case TMA_ADDR:
-            mem->tma = value;
-            break;
-        case TAC_ADDR:
-            mem->tac = value;
-            break;
-        case LCDC_ADDR:
-            mem->lcdc = value;
-            break;
-        case STAT_ADDR:
-            mem->stat = value;
-            break;
-        case LY_ADDR:
-            mem->ly = value;
-            break;
-        case LYC_ADDR:
-            mem->lyc = value;
-            break;
-        case SCY_ADDR:
-            mem->scy = value;
-            break;
-        case SCX_ADDR:
-            mem->scx = value;
-            break;
-        case BGP_ADDR:
-            mem->bgp = value;
-            break;
-        case OBP0_ADDR:
-            mem->obp0 = value;
-            break;
-        case OBP1_ADDR:
-            mem->obp1 = value;
-            break;
-        case WY_ADDR:
-            mem->wy = value;
-            break;
-        case WX_ADDR:
-            mem->wx = value;
-            break;
-        case IE_ADDR:
-            mem->IE = value;
-            break;
-        case IF_ADDR:
-            mem->IF = value;
-            break;
+        memcpy(mem->oam, source, DMA_LENGTH);
     }
+    else
+    {
+        for (uint16_t i = 0; i < DMA_LENGTH; i++)
+            mem->oam[i] = memory_read_dispatch(mem, (page << 8) + i);
+    }
+
+    // writing the register again restarts the transfer
+    mem->dma_ticks = DMA_TICKS;
+}
+
+// --- I/O registers --- //
+
+typedef uint8_t (*IoRead)(Memory* mem, uint8_t reg);
+typedef void (*IoWrite)(Memory* mem, uint8_t reg, uint8_t value);
+
+static uint8_t io_read_plain(Memory* mem, uint8_t reg)
+{
+    return mem->io[reg];
+}
+
+static void io_write_plain(Memory* mem, uint8_t reg, uint8_t value)
+{
+    mem->io[reg] = value;
+}
+
+static void io_write_ignore(Memory* mem, uint8_t reg, uint8_t value)
+{
+}
+
+// the game selects a button row with bits 4-5, the row comes back active low in bits 0-3
+static uint8_t io_read_joyp(Memory* mem, uint8_t reg)
+{
+    if (!(mem->joyp & 0x20))
+        return (mem->joypad_state >> 4) | (1 << 4);
+
+    if (!(mem->joyp & 0x10))
+        return (mem->joypad_state & 0x0F) | (1 << 5);
+
+    return mem->joyp | 0xFF;
+}
+
+static void io_write_joyp(Memory* mem, uint8_t reg, uint8_t value)
+{
+    mem->joyp = (mem->joyp & 0x0F) | (value & 0x30) | 0xC0;
+}
+
+// any write clears the divider
+static void io_write_div(Memory* mem, uint8_t reg, uint8_t value)
+{
+    mem->div = 0;
+}
+
+// mode and coincidence flag belong to the ppu, only the interrupt selects are writable
+static void io_write_stat(Memory* mem, uint8_t reg, uint8_t value)
+{
+    mem->stat = (mem->stat & 0x87) | (value & 0x78);
+}
+
+static void io_write_dma(Memory* mem, uint8_t reg, uint8_t value)
+{
+    mem->dma = value;
+    memory_dma_start(mem, value);
+}
+
+// FF10-FF3F, plain storage for a bare Memory without an apu
+static uint8_t io_read_sound(Memory* mem, uint8_t reg)
+{
+    if (mem->apu == NULL)
+        return mem->io[reg];
 
+    return apu_read(mem->apu, mem, reg);
+}
+
+static void io_write_sound(Memory* mem, uint8_t reg, uint8_t value)
+{
+    if (mem->apu == NULL)
+    {
+        mem->io[reg] = value;
+        return;
+    }
+
+    apu_write(mem->apu, mem, reg, value);
+}
+
+static const IoRead IO_READ[0x80] = {
+    [0x00 ... 0x7F] = io_read_plain,
+    [JOYP_ADDR & 0x7F] = io_read_joyp,
+    [0x10 ... 0x3F] = io_read_sound,
+};
+
+// LY is driven by the ppu and read-only
+static const IoWrite IO_WRITE[0x80] = {
+    [0x00 ... 0x7F] = io_write_plain,
+    [JOYP_ADDR & 0x7F] = io_write_joyp,
+    [DIV_ADDR & 0x7F] = io_write_div,
+    [STAT_ADDR & 0x7F] = io_write_stat,
+    [LY_ADDR & 0x7F] = io_write_ignore,
+    [DMA_ADDR & 0x7F] = io_write_dma,
+    [0x10 ... 0x3F] = io_write_sound,
+};
+
+static inline void memory_write_dispatch(Memory* mem, uint16_t addr, uint8_t value)
+{
     if (addr <= 0x7FFF)
     {
-        mem->mbc.rom_write(mem, addr, value);
+        mbc_control_write(mem, addr, value);
     }
     else if (addr <= 0x9FFF)
     {
@@ -72,7 +165,14 @@ void memory_write(Memory* mem, uint16_t addr, uint8_t value)
     }
     else if (addr <= 0xBFFF)
     {
-        mem->mbc.ram_write(mem, addr, value);
+        if (mem->mbc.ram == NULL)
+        {
+            mbc_ram_write(mem, addr, value);
+            return;
+        }
+
+        mem->mbc.ram[addr - 0xA000] = value;
+        mem->sram_dirty = 1;
     }
     else if (addr <= 0xCFFF)
     {
@@ -104,73 +204,27 @@ void memory_write(Memory* mem, uint16_t addr, uint8_t value)
     }
     else if (addr <= 0xFF7F)
     {
-        if (addr == 0xFF46)
-        {
-            mem->io[0x46] = value;
-            for (uint16_t i = 0; i < 0xA0; i++)
-                mem->oam[i] = memory_read(mem, (value << 8) + i);
-            return;
-        }
-
-        mem->io[addr - 0xFF00] = value;
+        IO_WRITE[addr & 0x7F](mem, addr & 0x7F, value);
     }
     else if (addr <= 0xFFFE)
     {
         mem->hram[addr - 0xFF80] = value;
     }
+    else
+    {
+        mem->IE = value;
+    }
 }
 
-uint8_t memory_read(Memory* mem, uint16_t addr)
+static inline uint8_t memory_read_dispatch(Memory* mem, uint16_t addr)
 {
-    switch (addr)
+    if (addr <= 0x3FFF)
     {
-        case JOYP_ADDR:
-            if (!(mem->joyp & 0x20))
-                return (mem->joypad_state >> 4) | (1 << 4);
-
-            if (!(mem->joyp & 0x10))
-                return (mem->joypad_state & 0x0F) | (1 << 5);
-
-            return mem->joyp | 0xFF;
-        case DIV_ADDR:
-            return mem->div;
-        case TIMA_ADDR:
-            return mem->tima;
-        case TMA_ADDR:
-            return mem->tma;
-        case TAC_ADDR:
-            return mem->tac;
-        case LCDC_ADDR:
-            return mem->lcdc;
-        case STAT_ADDR:
-            return mem->stat;
-        case LY_ADDR:
-            return mem->ly;
-        case LYC_ADDR:
-            return mem->lyc;
-        case SCY_ADDR:
-            return mem->scy;
-        case SCX_ADDR:
-            return mem->scx;
-        case BGP_ADDR:
-            return mem->bgp;
-        case OBP0_ADDR:
-            return mem->obp0;
-        case OBP1_ADDR:
-            return mem->obp1;
-        case WY_ADDR:
-            return mem->wy;
-        case WX_ADDR:
-            return mem->wx;
-        case IE_ADDR:
-            return mem->IE;
-        case IF_ADDR:
-            return mem->IF;
+        return mem->mbc.rom0[addr];
     }
-
-    if (addr <= 0x7FFF)
+    else if (addr <= 0x7FFF)
     {
-        return mem->mbc.rom_read(mem, addr);
+        return mem->mbc.romx[addr - 0x4000];
     }
     else if (addr <= 0x9FFF)
     {
@@ -178,7 +232,10 @@ uint8_t memory_read(Memory* mem, uint16_t addr)
     }
     else if (addr <= 0xBFFF)
     {
-        return mem->mbc.ram_read(mem, addr);
+        if (mem->mbc.ram == NULL)
+            return mbc_ram_read(mem, addr);
+
+        return mem->mbc.ram[addr - 0xA000];
     }
     else if (addr <= 0xCFFF)
     {
@@ -208,14 +265,35 @@ uint8_t memory_read(Memory* mem, uint16_t addr)
     }
     else if (addr <= 0xFF7F)
     {
-        return mem->io[addr - 0xFF00];
+        return IO_READ[addr & 0x7F](mem, addr & 0x7F);
     }
     else if (addr <= 0xFFFE)
     {
         return mem->hram[addr - 0xFF80];
     }
 
-    return 0xFF;
+    return mem->IE;
+}
+
+// while an oam dma runs the cpu only reaches i/o, hram and ie, which sit on the
+// chip's internal bus; everything else reads 0xFF and ignores writes
+void memory_write(Memory* mem, uint16_t addr, uint8_t value)
+{
+    PROF_ENTER(PROF_MEMORY);
+    MEMSTATS_WRITE(addr);
+    if (likely(mem->dma_ticks == 0 || addr >= 0xFF00))
+        memory_write_dispatch(mem, addr, value);
+    PROF_LEAVE();
+}
+
+uint8_t memory_read(Memory* mem, uint16_t addr)
+{
+    PROF_ENTER(PROF_MEMORY);
+    MEMSTATS_READ(addr, mem->mbc.romx_bank);
+    uint8_t value = likely(mem->dma_ticks == 0 || addr >= 0xFF00) ? memory_read_dispatch(mem, addr) : 0xFF;
+    PROF_LEAVE();
+
+    return value;
 }
 
 void memory_write16(Memory* mem, uint16_t addr, uint16_t value)
@@ -224,6 +302,11 @@ void memory_write16(Memory* mem, uint16_t addr, uint16_t value)
     memory_write(mem, addr + 1, (value >> 8) & 0xFF);
 }
 
+void memory_dma_update(Memory* mem, uint16_t ticks)
+{
+    mem->dma_ticks = ticks < mem->dma_ticks ? mem->dma_ticks - ticks : 0;
+}
+
 uint16_t memory_read16(Memory* mem, uint16_t addr)
 {
     uint8_t lo = memory_read(mem, addr);
@@ -232,6 +315,15 @@ uint16_t memory_read16(Memory* mem, uint16_t addr)
     return (hi << 8) | lo;
 }
 
+// NR10-NR52 as the boot rom leaves them
+static const uint8_t SOUND_RESET[0x17] = {
+    0x80, 0xBF, 0xF3, 0xFF, 0xBF,
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,
+    0x77, 0xF3, 0x80
+};
+
 void memory_reset(Memory* mem)
 {
     mem->joypad_state = 0xFF;
@@ -240,36 +332,17 @@ void memory_reset(Memory* mem)
     mem->stat = 0x85;
     mem->bgp = 0xFC;
     mem->IF = 0xE1;
+    memcpy(mem->sound, SOUND_RESET, sizeof(SOUND_RESET));
 }
 
 Memory* memory_init()
 {
-    Memory *mem = (Memory*) malloc(sizeof(Memory));     
-    memset(mem, 0, sizeof(Memory));
+    // calloc so the untouched part of the 8 MB rom array never gets paged in
+    Memory *mem = (Memory*) calloc(1, sizeof(Memory));
+    mem->sram = mem->sram_buffer;
     memory_reset(mem);
 
     set_mbc_type(mem, MBC1);
 
     return mem;
-}
-
-void set_mbc_type(Memory* mem, MBCType type)
-{
-    switch (type)
-    {
-        case MBC_NONE:
-            mem->mbc.mbc_type = MBC_NONE;
-            mem->mbc.rom_write = rom_write_mbc_none;
-            mem->mbc.rom_read = rom_read_mbc_none;
-            mem->mbc.ram_write = ram_write_mbc_none;
-            mem->mbc.ram_read = ram_read_mbc_none;
-            break;
-        case MBC1:
-            mem->mbc.mbc_type = MBC1;
-            mem->mbc.rom_write = rom_write_mbc1;
-            mem->mbc.rom_read = rom_read_mbc1;
-            mem->mbc.ram_write = ram_write_mbc1;
-            mem->mbc.ram_read = ram_read_mbc1;
-            break;
-    }
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifdef OAMX_MEMSTATS
+
+#include <string.h>
+
+#include "../inc/memstats.h"
+
+MemStats memstats;
+static MemStats suspended;
+
+static const char* REGION_NAMES[MEM_REGION_COUNT] = {
+    "rom0",
+    "romx",
+    "vram",
+    "sram",
+    "wram",
+    "echo",
+    "oam",
+    "unusable",
+    "io",
+    "hram",
+    "ie"
+};
+
+static const char* IO_NAMES[0x80] = {
+    [0x00] = "JOYP", [0x01] = "SB",   [0x02] = "SC",   [0x04] = "DIV",
+    [0x05] = "TIMA", [0x06] = "TMA",  [0x07] = "TAC",  [0x0F] = "IF",
+    [0x10] = "NR10", [0x11] = "NR11", [0x12] = "NR12", [0x13] = "NR13", [0x14] = "NR14",
+    [0x16] = "NR21", [0x17] = "NR22", [0x18] = "NR23", [0x19] = "NR24",
+    [0x1A] = "NR30", [0x1B] = "NR31", [0x1C] = "NR32", [0x1D] = "NR33", [0x1E] = "NR34",
+    [0x20] = "NR41", [0x21] = "NR42", [0x22] = "NR43", [0x23] = "NR44",
+    [0x24] = "NR50", [0x25] = "NR51", [0x26] = "NR52",
+    [0x40] = "LCDC", [0x41] = "STAT", [0x42] = "SCY",  [0x43] = "SCX",
+    [0x44] = "LY",   [0x45] = "LYC",  [0x46] = "DMA",  [0x47] = "BGP",
+    [0x48] = "OBP0", [0x49] = "OBP1", [0x4A] = "WY",   [0x4B] = "WX"
+};
+
+void memstats_frame_end()
+{
+    uint32_t switches = memstats.frame_switches;
+
+    memstats.switch_histogram[switches < MEMSTATS_SWITCH_BUCKETS ? switches : MEMSTATS_SWITCH_BUCKETS - 1]++;
+    if (switches > memstats.max_switches)
+        memstats.max_switches = switches;
+
+    memstats.frame_switches = 0;
+    memstats.frames++;
+}
+
+// counting stays branch free: whatever runs between suspend and resume is rolled
+// back along with the machine state it ran on
+void memstats_suspend()
+{
+    memcpy(&suspended, &memstats, sizeof(MemStats));
+}
+
+void memstats_resume()
+{
+    memcpy(&memstats, &suspended, sizeof(MemStats));
+}
+
+static double share(uint64_t count, uint64_t total)
+{
+    return total ? 100.0 * count / total : 0.0;
+}
+
+void memstats_finish(FILE* f)
+{
+    uint64_t total = 0;
+    for (uint8_t i = 0; i < MEM_REGION_COUNT; i++)
+        total += memstats.reads[i] + memstats.writes[i];
+
+    uint64_t frames = memstats.frames ? memstats.frames : 1;
+
+    fprintf(f, "memory stats, %llu frames, %llu accesses:\n", (unsigned long long)memstats.frames, (unsigned long long)total);
+    fprintf(f, "%-10s %14s %14s %12s %7s\n", "region", "reads", "writes", "per frame", "share");
+    for (uint8_t i = 0; i < MEM_REGION_COUNT; i++)
+    {
+        uint64_t accesses = memstats.reads[i] + memstats.writes[i];
+        fprintf(f, "%-10s %14llu %14llu %12.0f %6.1f%%\n", REGION_NAMES[i],
+            (unsigned long long)memstats.reads[i], (unsigned long long)memstats.writes[i],
+            (double)accesses / frames, share(accesses, total));
+    }
+
+    fprintf(f, "%-10s %14s %7s\n", "rom bank", "reads", "share");
+    for (uint32_t bank = 0; bank < MEMSTATS_BANKS; bank++)
+        if (memstats.bank_reads[bank])
+            fprintf(f, "%-10u %14llu %6.1f%%\n", bank, (unsigned long long)memstats.bank_reads[bank],
+                share(memstats.bank_reads[bank], memstats.reads[MEM_ROMX]));
+
+    fprintf(f, "%-10s %14s %14s %12s\n", "register", "reads", "writes", "per frame");
+    for (uint32_t reg = 0; reg < 0x80; reg++)
+    {
+        uint64_t accesses = memstats.io_reads[reg] + memstats.io_writes[reg];
+        if (accesses == 0)
+            continue;
+
+        char name[8];
+        snprintf(name, sizeof(name), "%s", IO_NAMES[reg] != NULL ? IO_NAMES[reg] : "");
+        if (name[0] == '\0')
+            snprintf(name, sizeof(name), "FF%02X", reg);
+
+        fprintf(f, "%-10s %14llu %14llu %12.1f\n", name,
+            (unsigned long long)memstats.io_reads[reg], (unsigned long long)memstats.io_writes[reg], (double)accesses / frames);
+    }
+
+    fprintf(f, "bank switches: %llu (%llu to the bank already mapped), %.2f per frame, max %u in a frame\n",
+        (unsigned long long)memstats.switches, (unsigned long long)memstats.redundant_switches,
+        (double)memstats.switches / frames, memstats.max_switches);
+
+    fprintf(f, "%-10s %14s %7s\n", "switches", "frames", "share");
+    for (uint32_t i = 0; i < MEMSTATS_SWITCH_BUCKETS; i++)
+        if (memstats.switch_histogram[i])
+            fprintf(f, "%-2u%-8s %14llu %6.1f%%\n", i, i == MEMSTATS_SWITCH_BUCKETS - 1 ? "+" : "",
+                (unsigned long long)memstats.switch_histogram[i], share(memstats.switch_histogram[i], memstats.frames));
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../inc/mixer.h"
+
+// gcc/clang vector extensions, lowered to sse or neon. the unaligned variants are
+// for the delta buffer, where an impulse starts at any sample
+typedef float Float4 __attribute__((vector_size(16), aligned(4)));
+typedef float Float2 __attribute__((vector_size(8), aligned(4)));
+
+// sinc low-passed a little under nyquist, blackman windowed. every phase is
+// normalized to a gain of exactly 1, so integrated steps land on their level
+static void build_kernel(Mixer* mixer)
+{
+    const double cutoff = 0.8;  // of nyquist
+
+    for (uint32_t phase = 0; phase < BLEP_PHASES; phase++)
+    {
+        double taps[BLEP_TAPS];
+        double sum = 0.0;
+
+        for (uint32_t k = 0; k < BLEP_TAPS; k++)
+        {
+            // distance of the tap from the impulse's center
+            double x = (double)k - BLEP_DELAY - (double)phase / BLEP_PHASES;
+            double t = x * cutoff;
+            double sinc = t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+            double w = (x + BLEP_TAPS / 2.0) / BLEP_TAPS;
+            double window = w <= 0.0 || w >= 1.0 ? 0.0 : 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w);
+
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+
+        for (uint32_t k = 0; k < BLEP_TAPS; k++)
+            mixer->kernel[phase][k * 2] = mixer->kernel[phase][k * 2 + 1] = taps[k] / sum;
+    }
+}
+
+Mixer* mixer_init(uint32_t sample_rate, uint32_t clock_rate)
+{
+    Mixer* mixer = (Mixer*) malloc(sizeof(Mixer));
+    memset(mixer, 0, sizeof(Mixer));
+
+    mixer->sample_rate = sample_rate;
+    mixer->clock_rate = clock_rate;
+    mixer->highpass_coefficient = 1.0 - exp(-2.0 * M_PI * MIXER_HIGHPASS_HZ / sample_rate);
+
+    build_kernel(mixer);
+
+    return mixer;
+}
+
+void mixer_free(Mixer* mixer)
+{
+    free(mixer);
+}
+
+void mixer_set_rate(Mixer* mixer, uint32_t sample_rate)
+{
+    mixer->sample_rate = sample_rate;
+}
+
+void mixer_add_delta(Mixer* mixer, uint32_t time, int32_t left, int32_t right)
+{
+    uint64_t position = mixer->phase + (uint64_t)time * mixer->sample_rate;
+    uint64_t index = position / mixer->clock_rate;
+    uint32_t phase = (position % mixer->clock_rate) * BLEP_PHASES / mixer->clock_rate;
+
+    if (index > MIXER_MAX_FRAME)
+        index = MIXER_MAX_FRAME;
+
+    float* out = &mixer->deltas[index * 2];
+    const float* kernel = mixer->kernel[phase];
+    Float4 delta = { left, right, left, right };
+
+    for (uint32_t i = 0; i < BLEP_TAPS * 2; i += 4)
+        *(Float4*)&out[i] += delta * *(const Float4*)&kernel[i];
+}
+
+static inline int16_t clamp16(float value)
+{
+    return value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : (int16_t)lrintf(value);
+}
+
+void mixer_end_frame(Mixer* mixer, uint32_t cycles)
+{
+    uint64_t total = mixer->phase + (uint64_t)cycles * mixer->sample_rate;
+    uint64_t count = total / mixer->clock_rate;
+
+    if (count > MIXER_MAX_FRAME)
+        count = MIXER_MAX_FRAME;
+
+    // integrating and the dc blocker carry state from sample to sample, so left and
+    // right go through them side by side
+    Float2 level = { mixer->level[0], mixer->level[1] };
+    Float2 highpass = { mixer->highpass[0], mixer->highpass[1] };
+    float coefficient = mixer->highpass_coefficient;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        level += *(const Float2*)&mixer->deltas[i * 2];
+        Float2 out = level - highpass;
+        highpass += out * coefficient;
+
+        mixer->samples[i * 2] = clamp16(out[0] * MIXER_SCALE);
+        mixer->samples[i * 2 + 1] = clamp16(out[1] * MIXER_SCALE);
+    }
+
+    mixer->level[0] = level[0];
+    mixer->level[1] = level[1];
+    mixer->highpass[0] = highpass[0];
+    mixer->highpass[1] = highpass[1];
+
+    // impulses that reach past the frame move to the front
+    memmove(mixer->deltas, &mixer->deltas[count * 2], BLEP_TAPS * 2 * sizeof(float));
+    memset(&mixer->deltas[BLEP_TAPS * 2], 0, count * 2 * sizeof(float));
+
+    mixer->sample_count = count;
+    mixer->phase = count < MIXER_MAX_FRAME ? total % mixer->clock_rate : 0;
+}
\ No newline at end of file
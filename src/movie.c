@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/movie.h"
+#include "../inc/rom.h"
+
+static uint8_t* capture_state(GameBoy* gb, uint32_t* size)
+{
+    SaveState* state = (SaveState*) malloc(sizeof(SaveState));
+    uint8_t* blob = (uint8_t*) malloc(SAVESTATE_MAX_SIZE);
+
+    savestate_save(gb, state);
+    *size = (uint32_t)savestate_serialize(state, blob, 1);
+
+    free(state);
+
+    return (uint8_t*) realloc(blob, *size);
+}
+
+static uint8_t restore_state(GameBoy* gb, const uint8_t* blob, uint32_t size)
+{
+    SaveState* state = (SaveState*) malloc(sizeof(SaveState));
+    uint8_t ok = savestate_deserialize(state, blob, size) && savestate_load(gb, state);
+    free(state);
+
+    return ok;
+}
+
+Movie* movie_init()
+{
+    Movie* movie = (Movie*) malloc(sizeof(Movie));
+    memset(movie, 0, sizeof(Movie));
+
+    movie->header.magic = MOVIE_MAGIC;
+    movie->header.version = MOVIE_VERSION;
+    movie->header.checkpoint_interval = MOVIE_DEFAULT_CHECKPOINT_INTERVAL;
+
+    return movie;
+}
+
+void movie_free(Movie* movie)
+{
+    free(movie->start_state);
+    free(movie->events);
+    free(movie->checksums);
+
+    for (uint32_t i = 0; i < movie->header.checkpoint_count; i++)
+        free(movie->checkpoints[i].data);
+
+    free(movie->checkpoints);
+    free(movie);
+}
+
+// set header.checkpoint_interval before starting, 0 disables checkpoints
+void movie_record_start(Movie* movie, GameBoy* gb)
+{
+    free(movie->start_state);
+    movie->start_state = capture_state(gb, &movie->header.start_state_size);
+    movie->header.rom_hash = rom_hash(gb->mem);
+    movie->header.frame_count = 0;
+    movie->header.event_count = 0;
+}
+
+void movie_record_input(Movie* movie, uint64_t cycle, uint8_t buttons)
+{
+    if (movie->header.event_count == movie->event_capacity)
+    {
+        movie->event_capacity = movie->event_capacity ? movie->event_capacity * 2 : 256;
+        movie->events = (InputEvent*) realloc(movie->events, movie->event_capacity * sizeof(InputEvent));
+    }
+
+    movie->events[movie->header.event_count++] = (InputEvent) { cycle, buttons };
+}
+
+void movie_record_frame(Movie* movie, GameBoy* gb)
+{
+    if (movie->header.frame_count == movie->checksum_capacity)
+    {
+        movie->checksum_capacity = movie->checksum_capacity ? movie->checksum_capacity * 2 : 1024;
+        movie->checksums = (uint32_t*) realloc(movie->checksums, movie->checksum_capacity * sizeof(uint32_t));
+    }
+
+    movie->checksums[movie->header.frame_count++] = gameboy_checksum(gb);
+
+    uint32_t interval = movie->header.checkpoint_interval;
+    if (interval == 0 || movie->header.frame_count % interval != 0)
+        return;
+
+    if (movie->header.checkpoint_count == movie->checkpoint_capacity)
+    {
+        movie->checkpoint_capacity = movie->checkpoint_capacity ? movie->checkpoint_capacity * 2 : 64;
+        movie->checkpoints = (MovieCheckpoint*) realloc(movie->checkpoints, movie->checkpoint_capacity * sizeof(MovieCheckpoint));
+    }
+
+    MovieCheckpoint* checkpoint = &movie->checkpoints[movie->header.checkpoint_count++];
+    checkpoint->frame = movie->header.frame_count;
+    checkpoint->data = capture_state(gb, &checkpoint->size);
+}
+
+uint8_t movie_write_file(Movie* movie, const char* filename)
+{
+    MovieHeader header = movie->header;
+
+    uint8_t* events = (uint8_t*) malloc((size_t)header.event_count * (VARINT_MAX_BYTES + 1) + 1);
+    size_t events_size = 0;
+    uint64_t last_cycle = 0;
+
+    for (uint32_t i = 0; i < header.event_count; i++)
+    {
+        events_size += varint_write(events + events_size, movie->events[i].cycle - last_cycle);
+        events[events_size++] = movie->events[i].buttons;
+        last_cycle = movie->events[i].cycle;
+    }
+
+    header.events_size = (uint32_t)events_size;
+
+    uint8_t ok = 0;
+    FILE* f = fopen(filename, "wb");
+    if (f != NULL)
+    {
+        ok = fwrite(&header, sizeof(MovieHeader), 1, f) == 1;
+        ok &= fwrite(movie->start_state, 1, header.start_state_size, f) == header.start_state_size;
+        ok &= fwrite(events, 1, events_size, f) == events_size;
+        ok &= fwrite(movie->checksums, sizeof(uint32_t), header.frame_count, f) == header.frame_count;
+
+        for (uint32_t i = 0; i < header.checkpoint_count; i++)
+        {
+            MovieCheckpoint* checkpoint = &movie->checkpoints[i];
+            ok &= fwrite(&checkpoint->frame, sizeof(uint32_t), 1, f) == 1;
+            ok &= fwrite(&checkpoint->size, sizeof(uint32_t), 1, f) == 1;
+            ok &= fwrite(checkpoint->data, 1, checkpoint->size, f) == checkpoint->size;
+        }
+
+        ok &= fclose(f) == 0;
+    }
+
+    free(events);
+
+    return ok;
+}
+
+// bytes left in f after the current position
+static uint64_t remaining_bytes(FILE* f)
+{
+    long pos = ftell(f);
+    if (pos < 0 || fseek(f, 0, SEEK_END) != 0)
+        return 0;
+
+    long end = ftell(f);
+    if (end < pos || fseek(f, pos, SEEK_SET) != 0)
+        return 0;
+
+    return (uint64_t)(end - pos);
+}
+
+Movie* movie_read_file(const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL)
+        return NULL;
+
+    Movie* movie = movie_init();
+    uint8_t* events = NULL;
+    uint8_t ok = fread(&movie->header, sizeof(MovieHeader), 1, f) == 1;
+
+    // checkpoints are loaded one by one so a truncated file frees cleanly
+    MovieHeader* header = &movie->header;
+    uint32_t checkpoint_count = ok ? header->checkpoint_count : 0;
+    header->checkpoint_count = 0;
+
+    ok = ok && header->magic == MOVIE_MAGIC && header->version == MOVIE_VERSION;
+    ok = ok && header->start_state_size <= SAVESTATE_MAX_SIZE;
+
+    // every size comes from the file, don't allocate for more than it can hold. an
+    // event takes at least a byte of cycle delta and one of buttons, a checkpoint at
+    // least its frame and size
+    uint64_t fixed_size = (uint64_t)header->start_state_size + header->events_size
+        + (uint64_t)header->frame_count * sizeof(uint32_t) + (uint64_t)checkpoint_count * 2 * sizeof(uint32_t);
+    ok = ok && fixed_size <= remaining_bytes(f);
+    ok = ok && (uint64_t)header->event_count * 2 <= header->events_size;
+
+    if (ok)
+    {
+        movie->start_state = (uint8_t*) malloc(header->start_state_size + 1);
+        events = (uint8_t*) malloc((size_t)header->events_size + 1);
+        movie->event_capacity = header->event_count;
+        movie->events = (InputEvent*) malloc(((size_t)header->event_count + 1) * sizeof(InputEvent));
+        movie->checksum_capacity = header->frame_count;
+        movie->checksums = (uint32_t*) malloc(((size_t)header->frame_count + 1) * sizeof(uint32_t));
+        movie->checkpoint_capacity = checkpoint_count;
+        movie->checkpoints = (MovieCheckpoint*) calloc((size_t)checkpoint_count + 1, sizeof(MovieCheckpoint));
+
+        ok = movie->start_state != NULL && events != NULL && movie->events != NULL
+            && movie->checksums != NULL && movie->checkpoints != NULL;
+    }
+
+    if (ok)
+    {
+        ok = fread(movie->start_state, 1, header->start_state_size, f) == header->start_state_size;
+        ok = ok && fread(events, 1, header->events_size, f) == header->events_size;
+        ok = ok && fread(movie->checksums, sizeof(uint32_t), header->frame_count, f) == header->frame_count;
+
+        for (uint32_t i = 0; ok && i < checkpoint_count; i++)
+        {
+            MovieCheckpoint* checkpoint = &movie->checkpoints[i];
+            ok = fread(&checkpoint->frame, sizeof(uint32_t), 1, f) == 1;
+            ok = ok && fread(&checkpoint->size, sizeof(uint32_t), 1, f) == 1;
+            ok = ok && checkpoint->size <= SAVESTATE_MAX_SIZE && checkpoint->frame <= header->frame_count;
+            if (!ok)
+                break;
+
+            checkpoint->data = (uint8_t*) malloc(checkpoint->size + 1);
+            ok = checkpoint->data != NULL;
+            if (!ok)
+                break;
+
+            header->checkpoint_count++;
+            ok = fread(checkpoint->data, 1, checkpoint->size, f) == checkpoint->size;
+        }
+    }
+
+    size_t read = 0;
+    uint64_t cycle = 0;
+    for (uint32_t i = 0; ok && i < header->event_count; i++)
+    {
+        uint64_t delta;
+        size_t length = varint_read(events + read, header->events_size - read, &delta);
+        ok = length != 0 && read + length < header->events_size;
+
+        read += length;
+        cycle += delta;
+        movie->events[i] = (InputEvent) { cycle, events[read++] };
+    }
+
+    free(events);
+    fclose(f);
+
+    if (!ok)
+    {
+        movie_free(movie);
+        return NULL;
+    }
+
+    return movie;
+}
+
+// restores the movie's start state into gb, which must have the movie's rom loaded
+uint8_t movie_player_start(MoviePlayer* player, Movie* movie, GameBoy* gb)
+{
+    memset(player, 0, sizeof(MoviePlayer));
+    player->movie = movie;
+
+    if (movie->header.rom_hash != rom_hash(gb->mem))
+        return 0;
+
+    return movie_player_seek(player, gb, 0, movie->start_state, movie->header.start_state_size);
+}
+
+// positions playback at `frame` given the state the machine had after that frame
+uint8_t movie_player_seek(MoviePlayer* player, GameBoy* gb, uint32_t frame, const uint8_t* state, uint32_t state_size)
+{
+    Movie* movie = player->movie;
+
+    if (!restore_state(gb, state, state_size))
+        return 0;
+
+    input_queue_clear(&gb->input);
+    player->frame = frame;
+
+    // events older than the state's cycle count were applied before it was captured
+    uint32_t low = 0;
+    uint32_t high = movie->header.event_count;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        if (movie->events[mid].cycle < gb->mem->cycles)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    player->next_event = low;
+
+    return 1;
+}
+
+// keeps the input queue topped up; events are timestamped, so queueing them early is harmless
+void movie_player_feed(MoviePlayer* player, GameBoy* gb)
+{
+    Movie* movie = player->movie;
+
+    while (player->next_event < movie->header.event_count)
+    {
+        InputEvent* event = &movie->events[player->next_event];
+        if (!input_queue_push(&gb->input, event->cycle, event->buttons))
+            return;
+
+        player->next_event++;
+    }
+}
+
+// checks the frame that just ran against the recording, returns 0 on a mismatch
+uint8_t movie_player_end_frame(MoviePlayer* player, GameBoy* gb)
+{
+    uint8_t match = gameboy_checksum(gb) == player->movie->checksums[player->frame];
+
+    if (!match && player->mismatches++ == 0)
+        player->first_mismatch = player->frame;
+
+    player->frame++;
+
+    return match;
+}
+
+uint8_t movie_player_run_frame(MoviePlayer* player, GameBoy* gb)
+{
+    movie_player_feed(player, gb);
+    gameboy_run_frame(gb);
+
+    return movie_player_end_frame(player, gb);
+}
\ No newline at end of file
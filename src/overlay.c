@@ -0,0 +1,76 @@
+#include "../inc/overlay.h"
+
+// one octal digit per row, top row first, most significant bit on the left
+static const uint16_t FONT[128] = {
+    ['0'] = 075557, ['1'] = 026227, ['2'] = 071747, ['3'] = 071317, ['4'] = 055711,
+    ['5'] = 074717, ['6'] = 074757, ['7'] = 071111, ['8'] = 075757, ['9'] = 075717,
+    ['A'] = 025755, ['B'] = 065656, ['C'] = 034443, ['D'] = 065556, ['E'] = 074647,
+    ['F'] = 074644, ['G'] = 034553, ['H'] = 055755, ['I'] = 072227, ['J'] = 011152,
+    ['K'] = 055655, ['L'] = 044447, ['M'] = 057755, ['N'] = 065555, ['O'] = 025552,
+    ['P'] = 065644, ['Q'] = 025563, ['R'] = 065655, ['S'] = 034216, ['T'] = 072222,
+    ['U'] = 055557, ['V'] = 055552, ['W'] = 055775, ['X'] = 055255, ['Y'] = 055222,
+    ['Z'] = 071247,
+    ['.'] = 000002, ['%'] = 051245, [':'] = 002020, ['/'] = 011244, ['-'] = 000700,
+    ['='] = 007070, ['+'] = 002720,
+};
+
+static uint16_t glyph(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        c -= 'a' - 'A';
+
+    return (unsigned char)c < 128 ? FONT[(unsigned char)c] : 0;
+}
+
+// halves every channel but keeps the pixel opaque
+static inline uint32_t darken(uint32_t pixel)
+{
+    return ((pixel >> 1) & 0x7F7F7F00) | 0xFF;
+}
+
+void overlay_draw_text(uint32_t* pixels, uint32_t width, uint32_t height, uint32_t x, uint32_t y, const char* text, uint32_t color)
+{
+    // size of the box behind the text, one pixel of margin around it
+    uint32_t columns = 0, lines = 1, column = 0;
+    for (const char* c = text; *c; c++)
+    {
+        column = *c == '\n' ? 0 : column + 1;
+        lines += *c == '\n';
+        columns = column > columns ? column : columns;
+    }
+
+    uint32_t box_x = x > 0 ? x - 1 : 0;
+    uint32_t box_y = y > 0 ? y - 1 : 0;
+    uint32_t box_right = x + columns * OVERLAY_CELL_WIDTH;
+    uint32_t box_bottom = y + lines * OVERLAY_CELL_HEIGHT;
+
+    for (uint32_t py = box_y; py < box_bottom && py < height; py++)
+        for (uint32_t px = box_x; px < box_right && px < width; px++)
+            pixels[py * width + px] = darken(pixels[py * width + px]);
+
+    uint32_t cx = x, cy = y;
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '\n')
+        {
+            cx = x;
+            cy += OVERLAY_CELL_HEIGHT;
+            continue;
+        }
+
+        uint16_t bits = glyph(*c);
+        for (uint32_t row = 0; row < OVERLAY_GLYPH_HEIGHT; row++)
+        {
+            for (uint32_t col = 0; col < OVERLAY_GLYPH_WIDTH; col++)
+            {
+                uint32_t shift = (OVERLAY_GLYPH_HEIGHT - 1 - row) * 3 + (OVERLAY_GLYPH_WIDTH - 1 - col);
+                uint32_t px = cx + col, py = cy + row;
+
+                if ((bits >> shift) & 1 && px < width && py < height)
+                    pixels[py * width + px] = color;
+            }
+        }
+
+        cx += OVERLAY_CELL_WIDTH;
+    }
+}
\ No newline at end of file
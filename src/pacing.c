@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../inc/pacing.h"
+#include "../inc/ring.h"
+#include "../inc/trace.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define cpu_relax() _mm_pause()
+#else
+    #define cpu_relax() do { } while (0)
+#endif
+
+uint64_t pacer_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    nanosleep(&ts, NULL);
+}
+
+void pacer_record_frame(Pacer* pacer, uint64_t frame_ns)
+{
+    FrameTimeStats* stats = &pacer->stats;
+
+    if (stats->count > 0)
+    {
+        uint64_t jitter = frame_ns > stats->last_ns ? frame_ns - stats->last_ns : stats->last_ns - frame_ns;
+        uint64_t bucket = jitter / PACER_JITTER_BUCKET_NS;
+        stats->jitter[bucket < PACER_JITTER_BUCKETS ? bucket : PACER_JITTER_BUCKETS - 1]++;
+        stats->jitter_count++;
+    }
+    stats->last_ns = frame_ns;
+
+    stats->count++;
+
+    double delta = frame_ns - stats->mean_ns;
+    stats->mean_ns += delta / stats->count;
+    stats->m2 += delta * (frame_ns - stats->mean_ns);
+
+    if (stats->count == 1 || frame_ns < stats->min_ns)
+        stats->min_ns = frame_ns;
+    if (frame_ns > stats->max_ns)
+        stats->max_ns = frame_ns;
+
+    uint64_t bucket = frame_ns / PACER_BUCKET_NS;
+    stats->histogram[bucket < PACER_BUCKETS ? bucket : PACER_BUCKETS - 1]++;
+}
+
+// a 144 Hz display would run a vsync paced emulation at 2.4x, only a refresh within
+// PACER_VSYNC_TOLERANCE of fps is left to pace it; anything else keeps the deadlines
+uint8_t pacer_vsync_paces(double fps, double refresh_rate)
+{
+    return fabs(refresh_rate - fps) <= fps * PACER_VSYNC_TOLERANCE;
+}
+
+void pacer_init(Pacer* pacer, double fps, uint8_t vsync)
+{
+    memset(pacer, 0, sizeof(Pacer));
+
+    pacer->base_period_ns = (uint64_t)(1000000000.0 / fps);
+    pacer->period_ns = pacer->base_period_ns;
+    pacer->speed = 1.0;
+    pacer->spin_ns = 1000000ULL;
+    pacer->vsync = vsync;
+    pacer->audio_ratio = 1.0;
+
+    pacer->last_frame = pacer_now_ns();
+    pacer->next_deadline = pacer->last_frame + pacer->period_ns;
+}
+
+void pacer_set_speed(Pacer* pacer, double speed)
+{
+    if (speed == pacer->speed)
+        return;
+
+    uint64_t period_ns = speed == PACER_UNLIMITED ? 0 : (uint64_t)(pacer->base_period_ns / speed);
+
+    // keep the phase of the frame in progress, just move its deadline
+    pacer->next_deadline = pacer->next_deadline - pacer->period_ns + period_ns;
+    pacer->period_ns = period_ns;
+    pacer->speed = speed;
+}
+
+void pacer_set_audio(Pacer* pacer, AudioRing* ring, uint32_t target_frames)
+{
+    pacer->audio = ring;
+    pacer->audio_target = target_frames;
+    pacer->audio_fill = target_frames;
+    pacer->audio_ratio = 1.0;
+}
+
+// proportional control on the smoothed fill level, measured at the same point of
+// every frame: right before the next one is emulated. off 1x the audio is muted
+// and the level means nothing
+static void steer_audio(Pacer* pacer)
+{
+    if (pacer->speed != 1.0)
+    {
+        pacer->audio_ratio = 1.0;
+        return;
+    }
+
+    double fill = ring_fill(pacer->audio);
+    pacer->audio_fill += (fill - pacer->audio_fill) * PACER_AUDIO_SMOOTHING;
+
+    double error = (pacer->audio_target - pacer->audio_fill) / pacer->audio_target;
+    if (error > 1.0)
+        error = 1.0;
+    if (error < -1.0)
+        error = -1.0;
+
+    pacer->audio_ratio = 1.0 + error * PACER_AUDIO_MAX_SKEW;
+}
+
+static void wait_until(Pacer* pacer, uint64_t deadline)
+{
+    uint64_t now = pacer_now_ns();
+    if (now >= deadline)
+        return;
+
+    uint64_t start = now;
+
+    if (deadline - now > pacer->spin_ns)
+    {
+        uint64_t wake = deadline - pacer->spin_ns;
+        sleep_ns(wake - now);
+        now = pacer_now_ns();
+
+        // track how late nanosleep returns and keep a margin over it
+        double oversleep = now > wake ? (double)(now - wake) : 0.0;
+        pacer->oversleep_ns += (oversleep - pacer->oversleep_ns) * 0.1;
+
+        uint64_t spin = (uint64_t)(pacer->oversleep_ns * 2.0);
+        if (spin < PACER_MIN_SPIN_NS)
+            spin = PACER_MIN_SPIN_NS;
+        if (spin > PACER_MAX_SPIN_NS)
+            spin = PACER_MAX_SPIN_NS;
+        pacer->spin_ns = spin;
+    }
+
+    while (now < deadline)
+    {
+        cpu_relax();
+        now = pacer_now_ns();
+    }
+
+    pacer->sleep_ns += now - start;
+}
+
+// blocks until the current frame's deadline, then accounts the frame time
+void pacer_wait(Pacer* pacer)
+{
+    if (pacer->speed == PACER_UNLIMITED)
+    {
+        pacer->next_deadline = pacer_now_ns();
+    }
+    else if (!pacer->vsync || pacer->speed != 1.0)
+    {
+        TRACE_BEGIN("sleep", "pacing");
+        wait_until(pacer, pacer->next_deadline);
+        TRACE_END("sleep", "pacing");
+
+        // deadlines are absolute, so a long frame is paid back by shorter sleeps afterwards.
+        // once we're more than PACER_MAX_LAG_PERIODS late there's no point bursting to catch up
+        uint64_t now = pacer_now_ns();
+        pacer->next_deadline += pacer->period_ns;
+        if (now > pacer->next_deadline + pacer->period_ns * (PACER_MAX_LAG_PERIODS - 1))
+        {
+            pacer->next_deadline = now + pacer->period_ns;
+            pacer->resyncs++;
+        }
+    }
+
+    if (pacer->audio != NULL)
+        steer_audio(pacer);
+
+    uint64_t now = pacer_now_ns();
+    pacer_record_frame(pacer, now - pacer->last_frame);
+    pacer->last_frame = now;
+}
+
+double pacer_mean_ms(Pacer* pacer)
+{
+    return pacer->stats.mean_ns / 1e6;
+}
+
+double pacer_stddev_ms(Pacer* pacer)
+{
+    if (pacer->stats.count < 2)
+        return 0.0;
+
+    return sqrt(pacer->stats.m2 / (pacer->stats.count - 1)) / 1e6;
+}
+
+static double histogram_percentile_ms(const uint32_t* histogram, uint32_t buckets, uint64_t bucket_ns,
+    uint64_t count, double percentile)
+{
+    uint64_t target = (uint64_t)ceil(count * percentile / 100.0);
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < buckets; i++)
+    {
+        seen += histogram[i];
+        if (seen >= target && seen > 0)
+            return (i + 1) * bucket_ns / 1e6; // upper edge of the bucket
+    }
+
+    return 0.0;
+}
+
+double pacer_percentile_ms(Pacer* pacer, double percentile)
+{
+    return histogram_percentile_ms(pacer->stats.histogram, PACER_BUCKETS, PACER_BUCKET_NS,
+        pacer->stats.count, percentile);
+}
+
+double pacer_jitter_ms(Pacer* pacer, double percentile)
+{
+    return histogram_percentile_ms(pacer->stats.jitter, PACER_JITTER_BUCKETS, PACER_JITTER_BUCKET_NS,
+        pacer->stats.jitter_count, percentile);
+}
+
+void pacer_print_stats(Pacer* pacer)
+{
+    double mean = pacer_mean_ms(pacer);
+
+    printf("pacing: %llu frames, mean %.3f ms, stddev %.3f ms, p50 %.1f ms, p99 %.1f ms, min %.3f ms, max %.3f ms\n",
+        (unsigned long long)pacer->stats.count, mean, pacer_stddev_ms(pacer),
+        pacer_percentile_ms(pacer, 50.0), pacer_percentile_ms(pacer, 99.0),
+        pacer->stats.min_ns / 1e6, pacer->stats.max_ns / 1e6);
+
+    printf("pacing: p99 frame to frame jitter %.2f ms, %llu resyncs, spin margin %.0f us\n",
+        pacer_jitter_ms(pacer, 99.0), (unsigned long long)pacer->resyncs, pacer->spin_ns / 1e3);
+
+    if (pacer->audio != NULL)
+        printf("pacing: audio queue %.0f frames (target %u), rate x%.4f, %llu frames dropped\n",
+            pacer->audio_fill, pacer->audio_target, pacer->audio_ratio, (unsigned long long)pacer->audio->dropped);
+}
\ No newline at end of file
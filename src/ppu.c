@@ -3,8 +3,9 @@
 
 #include "../inc/interrupts.h"
 #include "../inc/platform.h"
-#include "../inc/display.h"
 #include "../inc/ppu.h"
+#include "../inc/hostprof.h"
+#include "../inc/trace.h"
 
 static inline void request_stat_interrupt_if_enabled(Memory* mem, uint8_t mask)
 {
@@ -35,8 +36,9 @@ static uint8_t get_tile_pixel_from_vram(Memory* mem, uint16_t tile_base_address,
 {
     // addr points to the first line of the tile, so to get the correct 
     // line, we should do addr + line * 2 (each line is 2 bytes)
-    uint8_t b1 = memory_read(mem, tile_base_address + line * 2);
-    uint8_t b2 = memory_read(mem, tile_base_address + line * 2 + 1);
+    // the ppu has its own vram bus, cpu-side locks (oam dma) don't apply
+    uint8_t b1 = mem->vram[tile_base_address - 0x8000 + line * 2];
+    uint8_t b2 = mem->vram[tile_base_address - 0x8000 + line * 2 + 1];
 
     uint8_t mask = 1 << (7 - x);
     uint8_t pixel = (((b2 & mask) >> (7 - x)) << 1) | ((b1 & mask) >> (7 - x));
@@ -71,7 +73,7 @@ static void ppu_render_element_pixel(Ppu* ppu, Memory* mem, uint8_t screen_x, ui
     uint8_t line_y = element_y % 8;
 
     uint16_t tilemap_index = tile_row * 32 + tile_col;
-    uint8_t tile_index = memory_read(mem, tilemap_base + tilemap_index);
+    uint8_t tile_index = mem->vram[tilemap_base - 0x8000 + tilemap_index];
 
     uint8_t is_unsigned = mem->lcdc & (1 << 4) ? UNSIGNED_TILE_INDEX : SIGNED_TILE_INDEX;
     uint16_t tile_base_address = get_tile_base_address(is_unsigned, is_unsigned ? tile_index : (int8_t)tile_index);
@@ -195,7 +197,7 @@ static void ppu_draw_sprites(Ppu* ppu, Memory* mem)
     }
 }
 
-static void ppu_draw_scanline(Ppu* ppu, Memory* mem)
+void ppu_draw_scanline(Ppu* ppu, Memory* mem)
 {   
     ppu_draw_background(ppu, mem);
     ppu_draw_window(ppu, mem);
@@ -259,8 +261,14 @@ void ppu_handle_vram(Ppu* ppu, Memory* mem)
         ppu->ticks -= VRAM_TICKS;
         ppu_enter_mode(ppu, mem, HBLANK);
 
-        if (mem->ly < SCREEN_HEIGHT)
+        if (mem->ly < SCREEN_HEIGHT && !ppu->skip_render)
+        {
+            PROF_ENTER(PROF_PPU_RENDER);
+            TRACE_BEGIN_ARG("scanline", "ppu", "ly", mem->ly);
             ppu_draw_scanline(ppu, mem);
+            TRACE_END("scanline", "ppu");
+            PROF_LEAVE();
+        }
 
         request_stat_interrupt_if_enabled(mem, STAT_INT_HBLANK_ENABLE);
     }
@@ -279,7 +287,7 @@ void ppu_handle_hblank(Ppu* ppu, Memory* mem)
         {
             request_interrupt(mem, VBLANK_INTERRUPT);
             ppu_enter_mode(ppu, mem, VBLANK);
-            display_render(ppu);
+            ppu->frame_ready = 1;
             request_stat_interrupt_if_enabled(mem, STAT_INT_VBLANK_ENABLE);
         }
         else
@@ -334,4 +342,13 @@ Ppu* ppu_init()
     ppu->ticks = 0;
     ppu->sprite_height = 8;
     ppu->visible_sprite_count = 0;
+
+    return ppu;
+}
+
+void ppu_convert_framebuffer(Ppu* ppu, const uint32_t* palette, uint32_t* pixels)
+{
+    for (uint8_t y = 0; y < SCREEN_HEIGHT; y++)
+        for (uint8_t x = 0; x < SCREEN_WIDTH; x++)
+            pixels[y * SCREEN_WIDTH + x] = palette[ppu->framebuffer[y][x]];
 }
\ No newline at end of file
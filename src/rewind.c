@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../inc/rewind.h"
+
+static inline uint64_t get_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline RewindEntry* entry_at(Rewind* rw, uint32_t index)
+{
+    return &rw->entries[(rw->head + index) % rw->config.max_snapshots];
+}
+
+static void drop_oldest(Rewind* rw)
+{
+    RewindEntry* entry = entry_at(rw, 0);
+    rw->bytes_used -= entry->size;
+    free(entry->data);
+    entry->data = NULL;
+
+    rw->head = (rw->head + 1) % rw->config.max_snapshots;
+    rw->count--;
+
+    // deltas are useless without their keyframe
+    while (rw->count > 0 && !entry_at(rw, 0)->keyframe)
+        drop_oldest(rw);
+
+    if (rw->count == 0)
+        rw->keyframe_valid = 0;
+}
+
+// keyframes are rle coded on their own, deltas are taken against rw->keyframe
+static uint8_t decode_entry(Rewind* rw, RewindEntry* entry, SaveState* out)
+{
+    if (entry->keyframe)
+        return rle_decode(entry->data, entry->size, (uint8_t*)out, sizeof(SaveState)) == sizeof(SaveState);
+
+    return delta_decode(entry->data, entry->size, (const uint8_t*)rw->keyframe, (uint8_t*)out, sizeof(SaveState)) == sizeof(SaveState);
+}
+
+RewindConfig rewind_default_config()
+{
+    return (RewindConfig) {
+        .budget_bytes = REWIND_DEFAULT_BUDGET,
+        .max_snapshots = REWIND_DEFAULT_SNAPSHOTS,
+        .capture_interval = 1,
+        .keyframe_interval = REWIND_DEFAULT_KEYFRAMES
+    };
+}
+
+Rewind* rewind_init(RewindConfig config)
+{
+    Rewind* rw = (Rewind*) malloc(sizeof(Rewind));
+    memset(rw, 0, sizeof(Rewind));
+
+    if (config.max_snapshots == 0)
+        config.max_snapshots = 1;
+    if (config.capture_interval == 0)
+        config.capture_interval = 1;
+    if (config.keyframe_interval == 0)
+        config.keyframe_interval = 1;
+
+    rw->config = config;
+    rw->entries = (RewindEntry*) calloc(config.max_snapshots, sizeof(RewindEntry));
+    rw->keyframe = (SaveState*) malloc(sizeof(SaveState));
+    rw->scratch = (SaveState*) malloc(sizeof(SaveState));
+    rw->buffer = (uint8_t*) malloc(RLE_BOUND(sizeof(SaveState)) > DELTA_BOUND(sizeof(SaveState))
+        ? RLE_BOUND(sizeof(SaveState)) : DELTA_BOUND(sizeof(SaveState)));
+
+    return rw;
+}
+
+void rewind_free(Rewind* rw)
+{
+    while (rw->count > 0)
+        drop_oldest(rw);
+
+    free(rw->entries);
+    free(rw->keyframe);
+    free(rw->scratch);
+    free(rw->buffer);
+    free(rw);
+}
+
+// call once per emulated frame; snapshots are only taken every capture_interval frames
+void rewind_capture(Rewind* rw, GameBoy* gb)
+{
+    if (++rw->frames_since_capture < rw->config.capture_interval)
+        return;
+
+    rw->frames_since_capture = 0;
+
+    uint64_t start = get_time_ns();
+
+    uint8_t is_keyframe = !rw->keyframe_valid || rw->deltas_since_keyframe + 1 >= rw->config.keyframe_interval;
+
+    // consecutive frames change a handful of scattered bytes, so a delta against the
+    // keyframe is mostly skips
+    uint32_t size;
+    if (is_keyframe)
+    {
+        savestate_save(gb, rw->keyframe);
+        rw->keyframe_valid = 1;
+        rw->deltas_since_keyframe = 0;
+        size = (uint32_t)rle_encode((const uint8_t*)rw->keyframe, sizeof(SaveState), rw->buffer);
+    }
+    else
+    {
+        savestate_save(gb, rw->scratch);
+        rw->deltas_since_keyframe++;
+        size = (uint32_t)delta_encode((const uint8_t*)rw->scratch, (const uint8_t*)rw->keyframe, sizeof(SaveState), rw->buffer);
+    }
+
+    // make room, but never evict the keyframe of the group we're appending to
+    while (rw->count > 0 && (rw->count >= rw->config.max_snapshots || rw->bytes_used + size > rw->config.budget_bytes))
+    {
+        if (!is_keyframe && entry_at(rw, 0)->keyframe && rw->count <= rw->deltas_since_keyframe)
+            break;
+
+        drop_oldest(rw);
+    }
+
+    if (rw->count >= rw->config.max_snapshots || rw->bytes_used + size > rw->config.budget_bytes)
+    {
+        rw->keyframe_valid = 0;
+
+        // a keyframe alone over the budget: there's nothing we can keep
+        if (is_keyframe)
+            return;
+
+        // a single group fills the whole ring; restart it from this frame
+        while (rw->count > 0)
+            drop_oldest(rw);
+
+        rw->frames_since_capture = rw->config.capture_interval;
+        rewind_capture(rw, gb);
+        return;
+    }
+
+    if (is_keyframe)
+        rw->keyframe_valid = 1;
+
+    RewindEntry* entry = entry_at(rw, rw->count);
+    entry->data = (uint8_t*) malloc(size);
+    entry->size = size;
+    entry->keyframe = is_keyframe;
+    memcpy(entry->data, rw->buffer, size);
+
+    rw->count++;
+    rw->bytes_used += size;
+
+    rw->captures++;
+    rw->capture_ns += get_time_ns() - start;
+}
+
+// restores the newest snapshot and removes it from the ring, returns 0 when there is nothing left
+uint8_t rewind_step_back(Rewind* rw, GameBoy* gb)
+{
+    if (rw->count == 0)
+        return 0;
+
+    RewindEntry* entry = entry_at(rw, rw->count - 1);
+
+    if (!decode_entry(rw, entry, rw->scratch))
+        return 0;
+
+    uint8_t keyframe = entry->keyframe;
+
+    rw->bytes_used -= entry->size;
+    free(entry->data);
+    entry->data = NULL;
+    rw->count--;
+    rw->frames_since_capture = 0;
+
+    if (keyframe)
+    {
+        // the previous group becomes the newest one, bring its keyframe back
+        rw->keyframe_valid = 0;
+        rw->deltas_since_keyframe = 0;
+
+        for (uint32_t i = rw->count; i > 0; i--)
+        {
+            RewindEntry* previous = entry_at(rw, i - 1);
+            if (!previous->keyframe)
+            {
+                rw->deltas_since_keyframe++;
+                continue;
+            }
+
+            rw->keyframe_valid = decode_entry(rw, previous, rw->keyframe);
+            break;
+        }
+    }
+    else
+    {
+        rw->deltas_since_keyframe--;
+    }
+
+    return savestate_load(gb, rw->scratch);
+}
+
+RewindStats rewind_get_stats(Rewind* rw)
+{
+    RewindStats stats;
+    stats.snapshots = rw->count;
+    stats.bytes_used = rw->bytes_used;
+    stats.seconds = rw->count * rw->config.capture_interval / GB_FPS;
+    stats.avg_capture_us = rw->captures ? (double)rw->capture_ns / rw->captures / 1000.0 : 0.0;
+    stats.avg_snapshot_bytes = rw->count ? (double)rw->bytes_used / rw->count : 0.0;
+
+    return stats;
+}
+
+void rewind_print_stats(Rewind* rw)
+{
+    RewindStats stats = rewind_get_stats(rw);
+
+    printf("rewind: %zu snapshots covering %.1fs, %.2f MB of %.2f MB budget (%.0f bytes/snapshot), %.1f us/capture\n",
+        stats.snapshots, stats.seconds,
+        stats.bytes_used / (1024.0 * 1024.0), rw->config.budget_bytes / (1024.0 * 1024.0),
+        stats.avg_snapshot_bytes, stats.avg_capture_us);
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/ring.h"
+
+AudioRing* ring_init(uint32_t capacity)
+{
+    uint32_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    AudioRing* ring = (AudioRing*) aligned_alloc(RING_CACHE_LINE, sizeof(AudioRing));
+    memset(ring, 0, sizeof(AudioRing));
+
+    ring->samples = (int16_t*) calloc(size * 2, sizeof(int16_t));
+    ring->capacity = size;
+    ring->mask = size - 1;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return ring;
+}
+
+void ring_free(AudioRing* ring)
+{
+    free(ring->samples);
+    free(ring);
+}
+
+// copies frames in at most two runs, split where the buffer wraps
+static void copy_in(AudioRing* ring, uint32_t position, const int16_t* samples, uint32_t frames)
+{
+    uint32_t start = position & ring->mask;
+    uint32_t first = frames < ring->capacity - start ? frames : ring->capacity - start;
+
+    memcpy(&ring->samples[start * 2], samples, first * 2 * sizeof(int16_t));
+    memcpy(ring->samples, &samples[first * 2], (frames - first) * 2 * sizeof(int16_t));
+}
+
+static void copy_out(AudioRing* ring, uint32_t position, int16_t* out, uint32_t frames)
+{
+    uint32_t start = position & ring->mask;
+    uint32_t first = frames < ring->capacity - start ? frames : ring->capacity - start;
+
+    memcpy(out, &ring->samples[start * 2], first * 2 * sizeof(int16_t));
+    memcpy(&out[first * 2], ring->samples, (frames - first) * 2 * sizeof(int16_t));
+}
+
+uint32_t ring_write(AudioRing* ring, const int16_t* samples, uint32_t frames)
+{
+    // the acquire pairs with the consumer's release of tail: the frames it freed
+    // are done being read before we overwrite them
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    uint32_t space = ring->capacity - (head - tail);
+    uint32_t count = frames < space ? frames : space;
+
+    copy_in(ring, head, samples, count);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+
+    ring->dropped += frames - count;
+
+    return count;
+}
+
+uint32_t ring_read(AudioRing* ring, int16_t* out, uint32_t frames)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    uint32_t available = head - tail;
+    uint32_t count = frames < available ? frames : available;
+
+    copy_out(ring, tail, out, count);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+
+    return count;
+}
+
+uint32_t ring_fill(AudioRing* ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    return head - tail;
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include <string.h>
+
+#include "../inc/rle.h"
+
+// byte oriented run-length scheme, tuned for machine state where long runs
+// of identical bytes (mostly zeroes) dominate:
+//   0x00-0x7F: (token + 1) literal bytes follow
+//   0x80-0xFF: the next byte is repeated (token & 0x7F) + RLE_MIN_RUN times
+
+#define RLE_MIN_RUN     3
+#define RLE_MAX_RUN     (0x7F + RLE_MIN_RUN)
+#define RLE_MAX_LITERAL 0x80
+
+static inline size_t rle_run_length(const uint8_t* in, size_t pos, size_t size)
+{
+    size_t end = pos + RLE_MAX_RUN < size ? pos + RLE_MAX_RUN : size;
+    size_t i = pos + 1;
+
+    while (i < end && in[i] == in[pos])
+        i++;
+
+    return i - pos;
+}
+
+static inline size_t rle_emit_literal(const uint8_t* in, size_t start, size_t end, uint8_t* out)
+{
+    out[0] = (uint8_t)(end - start - 1);
+    memcpy(out + 1, in + start, end - start);
+
+    return end - start + 1;
+}
+
+size_t rle_encode(const uint8_t* in, size_t size, uint8_t* out)
+{
+    size_t written = 0;
+    size_t literal_start = 0;
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        size_t run = rle_run_length(in, pos, size);
+
+        // short runs join the pending literal. it is flushed the moment it holds a whole
+        // token's worth, so every literal token but the last one carries 128 bytes and
+        // the output stays within RLE_BOUND
+        if (run < RLE_MIN_RUN)
+        {
+            size_t room = RLE_MAX_LITERAL - (pos - literal_start);
+            pos += run < room ? run : room;
+
+            if (pos - literal_start == RLE_MAX_LITERAL)
+            {
+                written += rle_emit_literal(in, literal_start, pos, out + written);
+                literal_start = pos;
+            }
+            continue;
+        }
+
+        if (literal_start < pos)
+            written += rle_emit_literal(in, literal_start, pos, out + written);
+
+        out[written++] = (uint8_t)(0x80 | (run - RLE_MIN_RUN));
+        out[written++] = in[pos];
+        pos += run;
+        literal_start = pos;
+    }
+
+    if (literal_start < size)
+        written += rle_emit_literal(in, literal_start, size, out + written);
+
+    return written;
+}
+
+// returns the number of decoded bytes, or 0 if the input is malformed or doesn't fit
+size_t rle_decode(const uint8_t* in, size_t size, uint8_t* out, size_t capacity)
+{
+    size_t read = 0;
+    size_t written = 0;
+
+    while (read < size)
+    {
+        uint8_t token = in[read++];
+
+        if (token & 0x80)
+        {
+            size_t run = (token & 0x7F) + RLE_MIN_RUN;
+            if (read >= size || written + run > capacity)
+                return 0;
+
+            memset(out + written, in[read++], run);
+            written += run;
+            continue;
+        }
+
+        size_t count = (size_t)token + 1;
+        if (read + count > size || written + count > capacity)
+            return 0;
+
+        memcpy(out + written, in + read, count);
+        read += count;
+        written += count;
+    }
+
+    return written;
+}
+
+// little endian base 128, 7 bits per byte and the top bit set on all but the last
+size_t varint_write(uint8_t* out, uint64_t value)
+{
+    size_t written = 0;
+    while (value >= 0x80)
+    {
+        out[written++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+
+    out[written++] = (uint8_t)value;
+    return written;
+}
+
+// returns the number of bytes read, or 0 if the varint is truncated or too long
+size_t varint_read(const uint8_t* in, size_t size, uint64_t* value)
+{
+    *value = 0;
+    for (size_t i = 0; i < size && i < VARINT_MAX_BYTES; i++)
+    {
+        *value |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80))
+            return i + 1;
+    }
+
+    return 0;
+}
+
+// sparse difference of `in` against `base`, the same size: a list of
+//   varint skip, varint count, count bytes
+// where skip bytes are unchanged from base and the count bytes that follow are
+// copied from in. a frame of machine state changes a few scattered spots of a large
+// block, which the 130 byte runs of the rle coder can't skip cheaply
+
+#define DELTA_MIN_SKIP 16   // shorter unchanged stretches stay inside the literal, so a skip
+                            // always pays for the varints of the pair after it
+
+static inline uint64_t load_word(const uint8_t* p)
+{
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+size_t delta_encode(const uint8_t* in, const uint8_t* base, size_t size, uint8_t* out)
+{
+    size_t written = 0;
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        size_t skip_start = pos;
+
+        while (pos + sizeof(uint64_t) <= size && load_word(in + pos) == load_word(base + pos))
+            pos += sizeof(uint64_t);
+        while (pos < size && in[pos] == base[pos])
+            pos++;
+
+        if (pos == size)
+            break;
+
+        // changed bytes up to the next DELTA_MIN_SKIP unchanged ones
+        size_t literal_start = pos;
+        size_t unchanged = 0;
+        while (pos < size && unchanged < DELTA_MIN_SKIP)
+        {
+            unchanged = in[pos] == base[pos] ? unchanged + 1 : 0;
+            pos++;
+        }
+        pos -= unchanged;
+
+        written += varint_write(out + written, literal_start - skip_start);
+        written += varint_write(out + written, pos - literal_start);
+        memcpy(out + written, in + literal_start, pos - literal_start);
+        written += pos - literal_start;
+    }
+
+    return written;
+}
+
+// rebuilds capacity bytes from base and the delta, returns capacity or 0 if the
+// delta is malformed or reaches past the end
+size_t delta_decode(const uint8_t* in, size_t size, const uint8_t* base, uint8_t* out, size_t capacity)
+{
+    memcpy(out, base, capacity);
+
+    size_t read = 0;
+    size_t pos = 0;
+
+    while (read < size)
+    {
+        uint64_t skip, count;
+        size_t length = varint_read(in + read, size - read, &skip);
+        if (length == 0)
+            return 0;
+        read += length;
+
+        length = varint_read(in + read, size - read, &count);
+        if (length == 0)
+            return 0;
+        read += length;
+
+        if (skip > capacity - pos || count > capacity - pos - skip || count > size - read)
+            return 0;
+
+        pos += skip;
+        memcpy(out + pos, in + read, count);
+        pos += count;
+        read += count;
+    }
+
+    return capacity;
+}
\ No newline at end of file
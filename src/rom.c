@@ -20,4 +20,96 @@ void load_rom(Memory* mem, char* filename)
     assert(bytes_read == size);
 
     fclose(f);
+
+    set_mbc_type(mem, rom_mbc_type(mem));
+}
+
+// size declared in the cartridge header, 32 KB << code
+uint32_t rom_size(Memory* mem)
+{
+    uint8_t code = mem->rom[0x148];
+    uint32_t size = code <= 8 ? 0x8000u << code : sizeof(mem->rom);
+
+    return size <= sizeof(mem->rom) ? size : sizeof(mem->rom);
+}
+
+// 64-bit FNV-1a over the cartridge contents
+uint64_t rom_hash(Memory* mem)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    uint32_t size = rom_size(mem);
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        hash ^= mem->rom[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+// mapper named by the cartridge type, anything unsupported gets an mbc1
+MBCType rom_mbc_type(Memory* mem)
+{
+    switch (mem->rom[0x147])
+    {
+        case 0x00: // rom only
+        case 0x08: // rom + ram
+        case 0x09: // rom + ram + battery
+            return MBC_NONE;
+        case 0x0F: // mbc3 + timer + battery
+        case 0x10: // mbc3 + timer + ram + battery
+        case 0x11: // mbc3
+        case 0x12: // mbc3 + ram
+        case 0x13: // mbc3 + ram + battery
+            return MBC3;
+        case 0x19: // mbc5
+        case 0x1A: // mbc5 + ram
+        case 0x1B: // mbc5 + ram + battery
+        case 0x1C: // mbc5 + rumble
+        case 0x1D: // mbc5 + rumble + ram
+        case 0x1E: // mbc5 + rumble + ram + battery
+            return MBC5;
+        default:
+            return MBC1;
+    }
+}
+
+// cartridge ram declared in the header, capped to what Memory can hold
+uint32_t rom_ram_size(Memory* mem)
+{
+    static const uint32_t SIZES[] = { 0, 0x800, 0x2000, 0x8000, 0x20000, 0x10000 };
+
+    uint8_t code = mem->rom[0x149];
+    uint32_t size = code < sizeof(SIZES) / sizeof(SIZES[0]) ? SIZES[code] : 0;
+
+    return size <= SRAM_SIZE ? size : SRAM_SIZE;
+}
+
+// cartridge types whose ram keeps its contents with the power off
+uint8_t rom_has_battery(Memory* mem)
+{
+    switch (mem->rom[0x147])
+    {
+        case 0x03: // mbc1 + ram + battery
+        case 0x06: // mbc2 + battery
+        case 0x09: // rom + ram + battery
+        case 0x0D: // mmm01 + ram + battery
+        case 0x0F: // mbc3 + timer + battery
+        case 0x10: // mbc3 + timer + ram + battery
+        case 0x13: // mbc3 + ram + battery
+        case 0x1B: // mbc5 + ram + battery
+        case 0x1E: // mbc5 + rumble + ram + battery
+        case 0xFF: // huc1 + ram + battery
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// mbc5 carts with a motor, bit 3 of the ram bank register switches it
+uint8_t rom_has_rumble(Memory* mem)
+{
+    uint8_t type = mem->rom[0x147];
+    return type >= 0x1C && type <= 0x1E;
 }
\ No newline at end of file
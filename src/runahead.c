@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/runahead.h"
+#include "../inc/memstats.h"
+
+RunAhead* runahead_init(uint8_t frames)
+{
+    RunAhead* ra = (RunAhead*) malloc(sizeof(RunAhead));
+    memset(ra, 0, sizeof(RunAhead));
+
+    if (frames < RUNAHEAD_MIN_FRAMES)
+        frames = RUNAHEAD_MIN_FRAMES;
+    if (frames > RUNAHEAD_MAX_FRAMES)
+        frames = RUNAHEAD_MAX_FRAMES;
+
+    ra->frames = frames;
+    ra->state = (SaveState*) malloc(sizeof(SaveState));
+
+    return ra;
+}
+
+void runahead_free(RunAhead* ra)
+{
+    free(ra->state);
+    free(ra);
+}
+
+// games usually react to the joypad a frame or two after reading it. run the real frame,
+// then speculatively run `frames` more with the same input, show the last one and roll
+// back, so what's on screen is already the reaction to the current input. the real frame
+// is still drawn: rewind and save states bring its framebuffer back, not the speculative one
+void runahead_run_frame(RunAhead* ra, GameBoy* gb, void (*present)(Ppu* ppu))
+{
+    uint8_t skip_render = gb->ppu->skip_render;
+
+    gameboy_run_frame(gb);
+    savestate_save(gb, ra->state);
+    ra->input = gb->input;
+
+    // the speculative frames are rolled back, so they shouldn't show up in a profile,
+    // the memory counters or be heard
+    MEMSTATS_SUSPEND();
+    struct GuestProfiler* guest_profiler = gb->guest_profiler;
+    gb->guest_profiler = NULL;
+    Mixer* mixer = gb->apu->mixer;
+    gb->apu->mixer = NULL;
+
+    for (uint8_t i = 0; i < ra->frames; i++)
+    {
+        gb->ppu->skip_render = skip_render || i + 1 < ra->frames;
+        gameboy_run_frame(gb);
+    }
+
+    if (gb->ppu->frame_ready && !skip_render)
+        present(gb->ppu);
+
+    savestate_load(gb, ra->state);
+    gb->input = ra->input;
+    gb->guest_profiler = guest_profiler;
+    gb->apu->mixer = mixer;
+    MEMSTATS_RESUME();
+
+    gb->ppu->frame_ready = 0;
+    gb->ppu->skip_render = skip_render;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/savestate.h"
+
+static inline uint16_t rom_checksum(Memory* mem)
+{
+    return ((uint16_t)mem->rom[0x14E] << 8) | mem->rom[0x14F];
+}
+
+void savestate_save(GameBoy* gb, SaveState* state)
+{
+    state->header.magic = SAVESTATE_MAGIC;
+    state->header.version = SAVESTATE_VERSION;
+    state->header.flags = 0;
+    state->header.size = sizeof(SaveStatePayload);
+    state->header.rom_checksum = rom_checksum(gb->mem);
+    state->header.reserved = 0;
+
+    SaveStatePayload* payload = &state->payload;
+    payload->cpu = *gb->cpu;
+    payload->timer = gb->timer;
+    memcpy(payload->ppu, gb->ppu, PPU_STATE_SIZE);
+    memcpy(payload->memory, (uint8_t*)gb->mem + MEMORY_STATE_OFFSET, MEMORY_STATE_SIZE);
+    memcpy(payload->sram, gb->mem->sram, SRAM_SIZE);
+    memcpy(payload->mbc, &gb->mem->mbc, MBC_STATE_SIZE);
+    memcpy(payload->apu, gb->apu, APU_STATE_SIZE);
+}
+
+uint8_t savestate_load(GameBoy* gb, const SaveState* state)
+{
+    const SaveStateHeader* header = &state->header;
+
+    if (header->magic != SAVESTATE_MAGIC || header->version != SAVESTATE_VERSION)
+        return 0;
+
+    if (header->size != sizeof(SaveStatePayload) || (header->flags & SAVESTATE_COMPRESSED))
+        return 0;
+
+    if (header->rom_checksum != rom_checksum(gb->mem))
+        return 0;
+
+    const SaveStatePayload* payload = &state->payload;
+    *gb->cpu = payload->cpu;
+    gb->timer = payload->timer;
+    memcpy(gb->ppu, payload->ppu, PPU_STATE_SIZE);
+    memcpy((uint8_t*)gb->mem + MEMORY_STATE_OFFSET, payload->memory, MEMORY_STATE_SIZE);
+
+    // sram may be a mapped save file, only touch it when the contents actually differ
+    // so run-ahead and rewind don't copy its pages every frame. a load isn't a game
+    // write, sram_dirty stays as it was and the .sav keeps the player's last save
+    if (memcmp(gb->mem->sram, payload->sram, SRAM_SIZE) != 0)
+        memcpy(gb->mem->sram, payload->sram, SRAM_SIZE);
+    memcpy(&gb->mem->mbc, payload->mbc, MBC_STATE_SIZE);
+
+    // the mapping isn't part of the state, rebuild it from the restored registers
+    set_mbc_type(gb->mem, gb->mem->mbc.mbc_type);
+
+    memcpy(gb->apu, payload->apu, APU_STATE_SIZE);
+    apu_sync_output(gb->apu, gb->mem);
+
+    return 1;
+}
+
+// writes header + payload into out (at least SAVESTATE_MAX_SIZE bytes) and returns the blob size
+size_t savestate_serialize(const SaveState* state, uint8_t* out, uint8_t compress)
+{
+    SaveStateHeader header = state->header;
+    uint8_t* payload_out = out + sizeof(SaveStateHeader);
+
+    if (compress)
+    {
+        header.flags |= SAVESTATE_COMPRESSED;
+        header.size = rle_encode((const uint8_t*)&state->payload, sizeof(SaveStatePayload), payload_out);
+    }
+    else
+    {
+        memcpy(payload_out, &state->payload, sizeof(SaveStatePayload));
+    }
+
+    memcpy(out, &header, sizeof(SaveStateHeader));
+
+    return sizeof(SaveStateHeader) + header.size;
+}
+
+uint8_t savestate_deserialize(SaveState* state, const uint8_t* in, size_t size)
+{
+    if (size < sizeof(SaveStateHeader))
+        return 0;
+
+    SaveStateHeader header;
+    memcpy(&header, in, sizeof(SaveStateHeader));
+
+    if (header.magic != SAVESTATE_MAGIC || header.version != SAVESTATE_VERSION)
+        return 0;
+
+    if (header.size != size - sizeof(SaveStateHeader))
+        return 0;
+
+    const uint8_t* payload_in = in + sizeof(SaveStateHeader);
+
+    if (header.flags & SAVESTATE_COMPRESSED)
+    {
+        size_t decoded = rle_decode(payload_in, header.size, (uint8_t*)&state->payload, sizeof(SaveStatePayload));
+        if (decoded != sizeof(SaveStatePayload))
+            return 0;
+    }
+    else
+    {
+        if (header.size != sizeof(SaveStatePayload))
+            return 0;
+
+        memcpy(&state->payload, payload_in, sizeof(SaveStatePayload));
+    }
+
+    header.flags &= ~SAVESTATE_COMPRESSED;
+    header.size = sizeof(SaveStatePayload);
+    state->header = header;
+
+    return 1;
+}
+
+uint8_t savestate_write_file(GameBoy* gb, const char* filename, uint8_t compress)
+{
+    SaveState* state = (SaveState*) malloc(sizeof(SaveState));
+    uint8_t* blob = (uint8_t*) malloc(SAVESTATE_MAX_SIZE);
+
+    savestate_save(gb, state);
+    size_t size = savestate_serialize(state, blob, compress);
+
+    uint8_t ok = 0;
+    FILE* f = fopen(filename, "wb");
+    if (f != NULL)
+    {
+        ok = fwrite(blob, 1, size, f) == size;
+        ok &= fclose(f) == 0;
+    }
+
+    free(blob);
+    free(state);
+
+    return ok;
+}
+
+uint8_t savestate_read_file(GameBoy* gb, const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL)
+        return 0;
+
+    uint8_t* blob = (uint8_t*) malloc(SAVESTATE_MAX_SIZE);
+    size_t size = fread(blob, 1, SAVESTATE_MAX_SIZE, f);
+    fclose(f);
+
+    SaveState* state = (SaveState*) malloc(sizeof(SaveState));
+    uint8_t ok = savestate_deserialize(state, blob, size) && savestate_load(gb, state);
+
+    free(state);
+    free(blob);
+
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <string.h>
+#include <math.h>
+
+#include "../inc/telemetry.h"
+
+void telemetry_init(Telemetry* t, double fps)
+{
+    memset(t, 0, sizeof(Telemetry));
+    t->base_period_ns = 1e9 / fps;
+}
+
+static uint32_t bucket_of(uint64_t ns)
+{
+    uint64_t bucket = ns / PACER_BUCKET_NS;
+    return bucket < PACER_BUCKETS ? bucket : PACER_BUCKETS - 1;
+}
+
+static void add_sample(TelemetrySample* sum, const TelemetrySample* sample)
+{
+    sum->wall_ns += sample->wall_ns;
+    sum->sleep_ns += sample->sleep_ns;
+    sum->emulated_frames += sample->emulated_frames;
+}
+
+void telemetry_record(Telemetry* t, uint64_t wall_ns, uint64_t sleep_ns, uint32_t emulated_frames)
+{
+    TelemetrySample sample = { wall_ns, sleep_ns, emulated_frames };
+
+    // the oldest sample leaves the window, sums and histogram follow
+    if (t->filled == TELEMETRY_WINDOW)
+    {
+        TelemetrySample* old = &t->window[t->head];
+        t->window_sum.wall_ns -= old->wall_ns;
+        t->window_sum.sleep_ns -= old->sleep_ns;
+        t->window_sum.emulated_frames -= old->emulated_frames;
+        t->window_histogram[bucket_of(old->wall_ns)]--;
+    }
+    else
+        t->filled++;
+
+    t->window[t->head] = sample;
+    t->head = (t->head + 1) % TELEMETRY_WINDOW;
+
+    add_sample(&t->window_sum, &sample);
+    t->window_histogram[bucket_of(wall_ns)]++;
+
+    add_sample(&t->total, &sample);
+    t->histogram[bucket_of(wall_ns)]++;
+    t->frames++;
+}
+
+// upper edge of the bucket holding the percentile, like pacer_percentile_ms
+static double percentile_ms(const uint32_t* histogram, uint64_t count, double percentile)
+{
+    uint64_t target = (uint64_t)ceil(count * percentile / 100.0);
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < PACER_BUCKETS; i++)
+    {
+        seen += histogram[i];
+        if (seen >= target && seen > 0)
+            return (i + 1) * PACER_BUCKET_NS / 1e6;
+    }
+
+    return 0.0;
+}
+
+void telemetry_snapshot(Telemetry* t, uint8_t lifetime, TelemetrySnapshot* s)
+{
+    const TelemetrySample* sum = lifetime ? &t->total : &t->window_sum;
+    const uint32_t* histogram = lifetime ? t->histogram : t->window_histogram;
+    uint64_t frames = lifetime ? t->frames : t->filled;
+
+    memset(s, 0, sizeof(TelemetrySnapshot));
+    s->frames = frames;
+    if (frames == 0)
+        return;
+
+    uint64_t work_ns = sum->wall_ns - sum->sleep_ns;
+
+    s->speed_percent = sum->wall_ns ? 100.0 * sum->emulated_frames * t->base_period_ns / sum->wall_ns : 0.0;
+    s->emulated_ms = sum->emulated_frames ? work_ns / 1e6 / sum->emulated_frames : 0.0;
+    s->sleep_ms = sum->sleep_ns / 1e6 / frames;
+    s->p50_ms = percentile_ms(histogram, frames, 50.0);
+    s->p95_ms = percentile_ms(histogram, frames, 95.0);
+    s->p99_ms = percentile_ms(histogram, frames, 99.0);
+}
+
+// short enough for two lines of the 3x5 overlay font across the 160 pixel screen
+void telemetry_format_overlay(const TelemetrySnapshot* s, char* out, size_t size)
+{
+    snprintf(out, size, "%3.0f%% EMU %.1fMS SLEEP %.1fMS\nP50 %.1f P95 %.1f P99 %.1f",
+        s->speed_percent, s->emulated_ms, s->sleep_ms, s->p50_ms, s->p95_ms, s->p99_ms);
+}
+
+void telemetry_print(Telemetry* t, FILE* f)
+{
+    TelemetrySnapshot s;
+    telemetry_snapshot(t, 0, &s);
+
+    fprintf(f, "telemetry: speed %.1f%%, %.2f ms per emulated frame, %.2f ms asleep, frame p50 %.1f ms, p95 %.1f ms, p99 %.1f ms\n",
+        s.speed_percent, s.emulated_ms, s.sleep_ms, s.p50_ms, s.p95_ms, s.p99_ms);
+}
+
+// one gauge family, with the session and the rolling window as labels
+static void write_gauge(FILE* f, const char* name, const char* quantile, double session, double window)
+{
+    if (quantile == NULL)
+    {
+        fprintf(f, "%s{scope=\"session\"} %.4f\n", name, session);
+        fprintf(f, "%s{scope=\"window\"} %.4f\n", name, window);
+    }
+    else
+    {
+        fprintf(f, "%s{scope=\"session\",quantile=\"%s\"} %.4f\n", name, quantile, session);
+        fprintf(f, "%s{scope=\"window\",quantile=\"%s\"} %.4f\n", name, quantile, window);
+    }
+}
+
+// prometheus text format, so node_exporter's textfile collector can pick it up as is
+uint8_t telemetry_write_metrics(Telemetry* t, const char* filename)
+{
+    FILE* f = fopen(filename, "w");
+    if (f == NULL)
+        return 0;
+
+    TelemetrySnapshot session, window;
+    telemetry_snapshot(t, 1, &session);
+    telemetry_snapshot(t, 0, &window);
+
+    fprintf(f, "# TYPE oamx_host_frames_total counter\n");
+    fprintf(f, "oamx_host_frames_total %llu\n", (unsigned long long)t->frames);
+    fprintf(f, "# TYPE oamx_emulated_frames_total counter\n");
+    fprintf(f, "oamx_emulated_frames_total %llu\n", (unsigned long long)t->total.emulated_frames);
+    fprintf(f, "# TYPE oamx_host_seconds_total counter\n");
+    fprintf(f, "oamx_host_seconds_total %.3f\n", t->total.wall_ns / 1e9);
+    fprintf(f, "# TYPE oamx_sleep_seconds_total counter\n");
+    fprintf(f, "oamx_sleep_seconds_total %.3f\n", t->total.sleep_ns / 1e9);
+
+    fprintf(f, "# TYPE oamx_speed_percent gauge\n");
+    write_gauge(f, "oamx_speed_percent", NULL, session.speed_percent, window.speed_percent);
+    fprintf(f, "# TYPE oamx_emulated_frame_ms gauge\n");
+    write_gauge(f, "oamx_emulated_frame_ms", NULL, session.emulated_ms, window.emulated_ms);
+    fprintf(f, "# TYPE oamx_sleep_ms gauge\n");
+    write_gauge(f, "oamx_sleep_ms", NULL, session.sleep_ms, window.sleep_ms);
+    fprintf(f, "# TYPE oamx_frame_time_ms gauge\n");
+    write_gauge(f, "oamx_frame_time_ms", "0.5", session.p50_ms, window.p50_ms);
+    write_gauge(f, "oamx_frame_time_ms", "0.95", session.p95_ms, window.p95_ms);
+    write_gauge(f, "oamx_frame_time_ms", "0.99", session.p99_ms, window.p99_ms);
+
+    fclose(f);
+
+    return 1;
+}
\ No newline at end of file
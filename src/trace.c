@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../inc/trace.h"
+
+#define TRACE_BUFFER_SIZE (256 * 1024)
+#define TRACE_EVENT_MAX   256  // longest single event we ever format
+
+uint8_t trace_enabled = 0;
+
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t used;
+    uint64_t start_ns;
+    uint8_t first;  // no comma before the first event
+} Tracer;
+
+static Tracer tracer;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void flush()
+{
+    fwrite(tracer.buffer, 1, tracer.used, tracer.file);
+    tracer.used = 0;
+}
+
+static void emit(char phase, const char* name, const char* category, const char* arg_name, int64_t arg)
+{
+    if (tracer.used + TRACE_EVENT_MAX > TRACE_BUFFER_SIZE)
+        flush();
+
+    // timestamps are microseconds since the trace was opened
+    uint64_t ns = now_ns() - tracer.start_ns;
+    char* out = tracer.buffer + tracer.used;
+    int length = snprintf(out, TRACE_EVENT_MAX, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":1,\"tid\":1",
+        tracer.first ? "" : ",\n", name, category, phase, (unsigned long long)(ns / 1000), (unsigned)(ns % 1000));
+
+    if (phase == 'i')
+        length += snprintf(out + length, TRACE_EVENT_MAX - length, ",\"s\":\"t\"");
+
+    if (arg_name != NULL)
+        length += snprintf(out + length, TRACE_EVENT_MAX - length, ",\"args\":{\"%s\":%lld}", arg_name, (long long)arg);
+
+    length += snprintf(out + length, TRACE_EVENT_MAX - length, "}");
+
+    tracer.used += length < TRACE_EVENT_MAX ? length : TRACE_EVENT_MAX - 1;
+    tracer.first = 0;
+}
+
+uint8_t trace_open(const char* filename)
+{
+    FILE* f = fopen(filename, "w");
+    if (f == NULL)
+        return 0;
+
+    memset(&tracer, 0, sizeof(Tracer));
+    tracer.file = f;
+    tracer.buffer = (char*) malloc(TRACE_BUFFER_SIZE);
+    tracer.start_ns = now_ns();
+    tracer.first = 1;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"emulator\"}},\n");
+
+    trace_enabled = 1;
+
+    return 1;
+}
+
+void trace_close()
+{
+    if (!trace_enabled)
+        return;
+
+    trace_enabled = 0;
+
+    flush();
+    fprintf(tracer.file, "\n]}\n");
+    fclose(tracer.file);
+    free(tracer.buffer);
+
+    memset(&tracer, 0, sizeof(Tracer));
+}
+
+void trace_begin(const char* name, const char* category, const char* arg_name, int64_t arg)
+{
+    emit('B', name, category, arg_name, arg);
+}
+
+void trace_end(const char* name, const char* category)
+{
+    emit('E', name, category, NULL, 0);
+}
+
+void trace_instant(const char* name, const char* category, const char* arg_name, int64_t arg)
+{
+    emit('i', name, category, arg_name, arg);
+}
\ No newline at end of file
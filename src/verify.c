@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "../inc/pacing.h"
+#include "../inc/rom.h"
+#include "../inc/verify.h"
+
+// the movie is cut at its checkpoints; every segment starts from the checkpoint
+// before it and must reproduce both the recorded per-frame checksums and the
+// state stored in the checkpoint after it
+
+typedef struct {
+    uint32_t start_frame;
+    uint32_t end_frame;
+    const uint8_t* start_state;
+    uint32_t start_state_size;
+    const MovieCheckpoint* end_checkpoint;  // NULL for the tail of the movie
+
+    uint8_t ok;
+    uint8_t unreadable;     // the start state didn't load, nothing was replayed
+    uint32_t mismatches;
+    uint32_t first_mismatch;
+    uint8_t checkpoint_mismatch;
+} Segment;
+
+typedef struct {
+    Movie* movie;
+    GameBoy* template;
+    Segment* segments;
+    uint32_t segment_count;
+    atomic_uint next_segment;
+} VerifyJob;
+
+static GameBoy* clone_cartridge(GameBoy* template)
+{
+    GameBoy* gb = gameboy_init();
+    memcpy(gb->mem->rom, template->mem->rom, sizeof(gb->mem->rom));
+    set_mbc_type(gb->mem, template->mem->mbc.mbc_type);
+
+    return gb;
+}
+
+static void verify_segment(VerifyJob* job, Segment* segment, GameBoy* gb, GameBoy* expected)
+{
+    MoviePlayer player;
+    memset(&player, 0, sizeof(MoviePlayer));
+    player.movie = job->movie;
+
+    if (!movie_player_seek(&player, gb, segment->start_frame, segment->start_state, segment->start_state_size))
+    {
+        segment->ok = 0;
+        segment->unreadable = 1;
+        return;
+    }
+
+    while (player.frame < segment->end_frame)
+        movie_player_run_frame(&player, gb);
+
+    segment->mismatches = player.mismatches;
+    segment->first_mismatch = player.first_mismatch;
+
+    if (segment->end_checkpoint != NULL)
+    {
+        MoviePlayer checkpoint_player;
+        memset(&checkpoint_player, 0, sizeof(MoviePlayer));
+        checkpoint_player.movie = job->movie;
+
+        const MovieCheckpoint* checkpoint = segment->end_checkpoint;
+        uint8_t loaded = movie_player_seek(&checkpoint_player, expected, checkpoint->frame, checkpoint->data, checkpoint->size);
+        segment->checkpoint_mismatch = !loaded || gameboy_checksum(expected) != gameboy_checksum(gb);
+    }
+
+    segment->ok = segment->mismatches == 0 && !segment->checkpoint_mismatch;
+}
+
+static void* verify_worker(void* arg)
+{
+    VerifyJob* job = (VerifyJob*)arg;
+
+    GameBoy* gb = clone_cartridge(job->template);
+    GameBoy* expected = clone_cartridge(job->template);
+    gb->ppu->skip_render = 1;
+
+    for (;;)
+    {
+        uint32_t index = atomic_fetch_add(&job->next_segment, 1);
+        if (index >= job->segment_count)
+            break;
+
+        verify_segment(job, &job->segments[index], gb, expected);
+    }
+
+    gameboy_free(expected);
+    gameboy_free(gb);
+
+    return NULL;
+}
+
+// jobs == 0 uses every online core. template must have the movie's rom loaded
+uint8_t movie_verify(Movie* movie, GameBoy* template, uint32_t jobs, VerifyResult* result)
+{
+    memset(result, 0, sizeof(VerifyResult));
+
+    if (movie->header.rom_hash != rom_hash(template->mem))
+    {
+        result->status = VERIFY_OTHER_ROM;
+        return 0;
+    }
+
+    if (movie->header.frame_count == 0)
+    {
+        result->status = VERIFY_EMPTY;
+        return 0;
+    }
+
+    if (jobs == 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cores > 0 ? (uint32_t)cores : 1;
+    }
+
+    uint32_t checkpoint_count = movie->header.checkpoint_count;
+    Segment* segments = (Segment*) calloc(checkpoint_count + 1, sizeof(Segment));
+    uint32_t segment_count = 0;
+
+    const uint8_t* state = movie->start_state;
+    uint32_t state_size = movie->header.start_state_size;
+    uint32_t frame = 0;
+
+    for (uint32_t i = 0; i <= checkpoint_count; i++)
+    {
+        const MovieCheckpoint* checkpoint = i < checkpoint_count ? &movie->checkpoints[i] : NULL;
+        uint32_t end_frame = checkpoint != NULL ? checkpoint->frame : movie->header.frame_count;
+
+        if (end_frame > frame)
+        {
+            segments[segment_count++] = (Segment) {
+                .start_frame = frame,
+                .end_frame = end_frame,
+                .start_state = state,
+                .start_state_size = state_size,
+                .end_checkpoint = checkpoint
+            };
+        }
+
+        if (checkpoint != NULL)
+        {
+            state = checkpoint->data;
+            state_size = checkpoint->size;
+            frame = checkpoint->frame;
+        }
+    }
+
+    if (jobs > segment_count)
+        jobs = segment_count > 0 ? segment_count : 1;
+
+    VerifyJob job = { movie, template, segments, segment_count };
+    atomic_init(&job.next_segment, 0);
+
+    uint64_t start = pacer_now_ns();
+
+    pthread_t* threads = (pthread_t*) malloc(jobs * sizeof(pthread_t));
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < jobs; i++)
+        if (pthread_create(&threads[started], NULL, verify_worker, &job) == 0)
+            started++;
+
+    // out of threads: this one takes whatever the others leave, or everything
+    if (started < jobs)
+        verify_worker(&job);
+
+    for (uint32_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    result->seconds = (pacer_now_ns() - start) / 1e9;
+    result->segments = segment_count;
+    result->jobs = started < jobs ? started + 1 : jobs;
+
+    for (uint32_t i = 0; i < segment_count; i++)
+    {
+        Segment* segment = &segments[i];
+        if (segment->ok)
+            continue;
+
+        result->failed_segments++;
+        result->unreadable_segments += segment->unreadable;
+        result->checkpoint_mismatches += segment->checkpoint_mismatch;
+
+        if (segment->mismatches > 0 && result->mismatches == 0)
+            result->first_mismatch = segment->first_mismatch;
+
+        result->mismatches += segment->mismatches;
+    }
+
+    free(threads);
+    free(segments);
+
+    result->status = result->failed_segments == 0 ? VERIFY_PASSED : VERIFY_FAILED;
+
+    return result->status == VERIFY_PASSED;
+}
+
+void verify_print_result(VerifyResult* result)
+{
+    printf("verify: %u segments on %u threads in %.2fs\n", result->segments, result->jobs, result->seconds);
+
+    if (result->failed_segments == 0)
+    {
+        printf("verify: all segments match their checksums and checkpoints\n");
+        return;
+    }
+
+    printf("verify: %u failed segments, %u frame mismatches (first at frame %u), %u checkpoint mismatches\n",
+        result->failed_segments, result->mismatches, result->first_mismatch, result->checkpoint_mismatches);
+
+    if (result->unreadable_segments > 0)
+        printf("verify: %u segments weren't replayed, their start state couldn't be loaded\n", result->unreadable_segments);
+}
\ No newline at end of file
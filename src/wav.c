@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../inc/wav.h"
+
+#define WAV_HEADER_SIZE 44
+
+static void put_le16(uint8_t* out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void put_le32(uint8_t* out, uint32_t value)
+{
+    put_le16(out, value & 0xFFFF);
+    put_le16(out + 2, value >> 16);
+}
+
+// a stream whose length isn't known yet says 0xFFFFFFFF, which most readers take
+// as "until the end of the file"
+static void build_header(uint8_t* out, uint32_t sample_rate, uint32_t data_size)
+{
+    memcpy(out, "RIFF", 4);
+    put_le32(out + 4, data_size == UINT32_MAX ? UINT32_MAX : data_size + WAV_HEADER_SIZE - 8);
+    memcpy(out + 8, "WAVEfmt ", 8);
+    put_le32(out + 16, 16);
+    put_le16(out + 20, 1);                  // pcm
+    put_le16(out + 22, 2);                  // channels
+    put_le32(out + 24, sample_rate);
+    put_le32(out + 28, sample_rate * 4);    // bytes per second
+    put_le16(out + 32, 4);                  // bytes per frame
+    put_le16(out + 34, 16);                 // bits per sample
+    memcpy(out + 36, "data", 4);
+    put_le32(out + 40, data_size);
+}
+
+static void* writer_thread(void* arg)
+{
+    WavWriter* wav = (WavWriter*)arg;
+
+    int16_t chunk[WAV_CHUNK_FRAMES * 2];
+    uint8_t bytes[WAV_CHUNK_FRAMES * 4];
+
+    pthread_mutex_lock(&wav->lock);
+    while (wav->running || ring_fill(wav->ring) > 0)
+    {
+        if (ring_fill(wav->ring) == 0)
+        {
+            pthread_cond_wait(&wav->wake, &wav->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&wav->lock);
+        uint32_t count = ring_read(wav->ring, chunk, WAV_CHUNK_FRAMES);
+
+        pthread_mutex_lock(&wav->lock);
+        pthread_cond_signal(&wav->space);
+        pthread_mutex_unlock(&wav->lock);
+
+        // the file is little endian whatever the host is
+        for (uint32_t i = 0; i < count * 2; i++)
+            put_le16(&bytes[i * 2], (uint16_t)chunk[i]);
+
+        uint8_t failed = fwrite(bytes, 4, count, wav->file) != count;
+
+        pthread_mutex_lock(&wav->lock);
+        wav->frames += count;
+        wav->failed |= failed;
+    }
+    pthread_mutex_unlock(&wav->lock);
+
+    return NULL;
+}
+
+WavWriter* wav_open(const char* filename, uint32_t sample_rate)
+{
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+        return NULL;
+
+    WavWriter* wav = (WavWriter*) malloc(sizeof(WavWriter));
+    memset(wav, 0, sizeof(WavWriter));
+
+    size_t length = strlen(filename);
+    wav->file = file;
+    wav->header = length >= 4 && strcmp(filename + length - 4, ".wav") == 0;
+    wav->sample_rate = sample_rate;
+    wav->ring = ring_init(WAV_RING_FRAMES);
+    wav->running = 1;
+
+    if (wav->header)
+    {
+        uint8_t header[WAV_HEADER_SIZE];
+        build_header(header, sample_rate, UINT32_MAX);
+        wav->failed = fwrite(header, 1, WAV_HEADER_SIZE, file) != WAV_HEADER_SIZE;
+    }
+
+    pthread_mutex_init(&wav->lock, NULL);
+    pthread_cond_init(&wav->wake, NULL);
+    pthread_cond_init(&wav->space, NULL);
+    pthread_create(&wav->thread, NULL, writer_thread, wav);
+
+    return wav;
+}
+
+void wav_write(WavWriter* wav, const int16_t* samples, uint32_t frames)
+{
+    AudioRing* ring = wav->ring;
+    wav->queued += frames;
+
+    // only what fits is handed to ring_write, so nothing counts as dropped
+    while (frames > 0)
+    {
+        uint32_t space = ring->capacity - ring_fill(ring);
+        if (space == 0)
+        {
+            pthread_mutex_lock(&wav->lock);
+            pthread_cond_signal(&wav->wake);
+            while (ring_fill(ring) == ring->capacity)
+                pthread_cond_wait(&wav->space, &wav->lock);
+            pthread_mutex_unlock(&wav->lock);
+
+            continue;
+        }
+
+        uint32_t count = frames < space ? frames : space;
+        ring_write(ring, samples, count);
+
+        samples += count * 2;
+        frames -= count;
+    }
+
+    pthread_mutex_lock(&wav->lock);
+    pthread_cond_signal(&wav->wake);
+    pthread_mutex_unlock(&wav->lock);
+}
+
+uint8_t wav_close(WavWriter* wav)
+{
+    pthread_mutex_lock(&wav->lock);
+    wav->running = 0;
+    pthread_cond_signal(&wav->wake);
+    pthread_mutex_unlock(&wav->lock);
+
+    pthread_join(wav->thread, NULL);
+
+    // a pipe can't seek back, it keeps the open ended sizes
+    uint64_t data_size = wav->frames * 4;
+    if (wav->header && data_size <= UINT32_MAX - WAV_HEADER_SIZE && fseek(wav->file, 0, SEEK_SET) == 0)
+    {
+        uint8_t header[WAV_HEADER_SIZE];
+        build_header(header, wav->sample_rate, (uint32_t)data_size);
+        wav->failed |= fwrite(header, 1, WAV_HEADER_SIZE, wav->file) != WAV_HEADER_SIZE;
+    }
+
+    wav->failed |= fclose(wav->file) != 0;
+
+    uint8_t ok = !wav->failed;
+
+    pthread_mutex_destroy(&wav->lock);
+    pthread_cond_destroy(&wav->wake);
+    pthread_cond_destroy(&wav->space);
+    ring_free(wav->ring);
+    free(wav);
+
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../inc/apu.h"
+
+static Memory* apu_memory(Apu* apu)
+{
+    Memory* mem = memory_init();
+    mem->apu = apu;
+
+    return mem;
+}
+
+// channel 2 at 50% duty and full volume, about 1 kHz
+static void play_pulse2(Memory* mem, uint8_t length)
+{
+    memory_write(mem, 0xFF16, 0x80 | ((64 - length) & 0x3F));
+    memory_write(mem, 0xFF17, 0xF0);
+    memory_write(mem, 0xFF18, (2048 - 131) & 0xFF);
+    memory_write(mem, 0xFF19, 0x80 | (length ? 0x40 : 0) | ((2048 - 131) >> 8));
+}
+
+void test_apu_length_clears_status()
+{
+    Apu* apu = apu_init();
+    Memory* mem = apu_memory(apu);
+
+    assert(memory_read(mem, NR52_ADDR) == 0xF1);
+
+    play_pulse2(mem, 2);
+    assert(memory_read(mem, NR52_ADDR) & 0x02);
+
+    // length is clocked on every other sequencer step
+    mem->cycles += APU_SEQUENCER_TICKS * 2;
+    assert(memory_read(mem, NR52_ADDR) & 0x02);
+
+    mem->cycles += APU_SEQUENCER_TICKS * 2;
+    assert((memory_read(mem, NR52_ADDR) & 0x02) == 0);
+
+    free(mem);
+    apu_free(apu);
+}
+
+void test_apu_dac_off_disables_channel()
+{
+    Apu* apu = apu_init();
+    Memory* mem = apu_memory(apu);
+
+    play_pulse2(mem, 0);
+    assert(memory_read(mem, NR52_ADDR) & 0x02);
+
+    memory_write(mem, 0xFF17, 0x00);
+    assert((memory_read(mem, NR52_ADDR) & 0x02) == 0);
+
+    // triggering doesn't bring it back while the dac is off
+    memory_write(mem, 0xFF19, 0x80);
+    assert((memory_read(mem, NR52_ADDR) & 0x02) == 0);
+
+    free(mem);
+    apu_free(apu);
+}
+
+void test_apu_power_off()
+{
+    Apu* apu = apu_init();
+    Memory* mem = apu_memory(apu);
+
+    memory_write(mem, NR52_ADDR, 0x00);
+    assert(memory_read(mem, NR52_ADDR) == 0x70);
+    assert(memory_read(mem, 0xFF24) == 0x00);
+    assert(memory_read(mem, 0xFF11) == 0x3F);
+
+    // registers ignore writes while off, wave ram doesn't
+    memory_write(mem, 0xFF24, 0x77);
+    memory_write(mem, 0xFF30, 0x5A);
+    assert(memory_read(mem, 0xFF24) == 0x00);
+    assert(memory_read(mem, 0xFF30) == 0x5A);
+
+    memory_write(mem, NR52_ADDR, 0x80);
+    memory_write(mem, 0xFF24, 0x77);
+    assert(memory_read(mem, 0xFF24) == 0x77);
+
+    free(mem);
+    apu_free(apu);
+}
+
+void test_apu_synthesizes_pulse()
+{
+    Apu* apu = apu_init();
+    Memory* mem = apu_memory(apu);
+    Mixer* mixer = mixer_init(48000, 4194304);
+
+    apu_set_mixer(apu, mem, mixer);
+    memory_write(mem, 0xFF25, 0x22);
+    play_pulse2(mem, 0);
+
+    // a few frames for the dc blocker to settle
+    for (int frame = 0; frame < 4; frame++)
+    {
+        mem->cycles += 70224;
+        apu_end_frame(apu, mem);
+    }
+
+    // 70224 cycles at 48 kHz
+    assert(mixer->sample_count >= 803 && mixer->sample_count <= 804);
+
+    // a square wave of volume 15 at master volume 8 centered on 0, on both sides
+    uint32_t crossings = 0;
+    int16_t peak = 0;
+    for (uint32_t i = 0; i < mixer->sample_count; i++)
+    {
+        int16_t left = mixer->samples[i * 2];
+        assert(mixer->samples[i * 2 + 1] == left);
+
+        peak = abs(left) > peak ? abs(left) : peak;
+
+        if (i > 0 && (left < 0) != (mixer->samples[(i - 1) * 2] < 0))
+            crossings++;
+    }
+
+    // 4192 cycles per period
+    assert(crossings >= 32 && crossings <= 35);
+
+    // band-limited edges overshoot a little
+    assert(peak > 15 * 8 * MIXER_SCALE / 2 && peak < 15 * 8 * MIXER_SCALE * 3 / 4);
+
+    mixer_free(mixer);
+    free(mem);
+    apu_free(apu);
+}
+
+void test_apu_synthesis_is_invisible()
+{
+    Apu* quiet = apu_init();
+    Apu* loud = apu_init();
+    Memory* quiet_mem = apu_memory(quiet);
+    Memory* loud_mem = apu_memory(loud);
+    Mixer* mixer = mixer_init(48000, 4194304);
+
+    apu_set_mixer(loud, loud_mem, mixer);
+
+    Memory* mems[2] = { quiet_mem, loud_mem };
+    for (int i = 0; i < 2; i++)
+    {
+        // sweep channel 1 up until it overflows
+        memory_write(mems[i], 0xFF10, 0x11);
+        memory_write(mems[i], 0xFF12, 0xF1);
+        memory_write(mems[i], 0xFF13, 0x00);
+        memory_write(mems[i], 0xFF14, 0x87);
+        play_pulse2(mems[i], 40);
+
+        for (int frame = 0; frame < 30; frame++)
+        {
+            mems[i]->cycles += 70224;
+            apu_end_frame(mems[i]->apu, mems[i]);
+        }
+    }
+
+    // whatever the registers can observe doesn't depend on synthesis
+    assert(memcmp(quiet, loud, APU_CHECKSUM_SIZE) == 0);
+    assert(memory_read(quiet_mem, NR52_ADDR) == memory_read(loud_mem, NR52_ADDR));
+    assert(memory_read(quiet_mem, 0xFF13) == memory_read(loud_mem, 0xFF13));
+
+    mixer_free(mixer);
+    free(quiet_mem);
+    free(loud_mem);
+    apu_free(quiet);
+    apu_free(loud);
+}
+
+int main()
+{
+    test_apu_length_clears_status();
+    test_apu_dac_off_disables_channel();
+    test_apu_power_off();
+    test_apu_synthesizes_pulse();
+    test_apu_synthesis_is_invisible();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
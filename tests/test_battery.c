@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../inc/battery.h"
+
+#define SAVE_FILE "test_battery.tmp"
+
+static Memory* battery_cartridge()
+{
+    Memory* mem = memory_init();
+    mem->rom[0x147] = 0x03; // mbc1 + ram + battery
+    mem->rom[0x149] = 0x02; // 8 KB
+
+    return mem;
+}
+
+void test_battery_persists_sram()
+{
+    remove(SAVE_FILE);
+
+    Memory* mem = battery_cartridge();
+    Battery* battery = battery_open(mem, SAVE_FILE);
+    assert(battery != NULL);
+    assert(mem->sram == battery->map);
+
+    memory_write(mem, 0x0000, 0x0A);
+    memory_write(mem, 0xA000, 0x1C);
+    memory_write(mem, 0xBFFF, 0x2D);
+    assert(mem->sram_dirty);
+
+    // disabling ram hands the flush to the background thread
+    memory_write(mem, 0x0000, 0x00);
+    assert(!mem->sram_dirty);
+
+    battery_close(battery, mem);
+    assert(mem->sram == mem->sram_buffer);
+    assert(mem->sram[0x0000] == 0x1C);
+    free(mem);
+
+    FILE* f = fopen(SAVE_FILE, "rb");
+    uint8_t data[0x2000];
+    assert(fread(data, 1, sizeof(data), f) == sizeof(data));
+    assert(fgetc(f) == EOF);
+    fclose(f);
+    assert(data[0x0000] == 0x1C);
+    assert(data[0x1FFF] == 0x2D);
+
+    // a fresh power on finds the save
+    mem = battery_cartridge();
+    battery = battery_open(mem, SAVE_FILE);
+    assert(battery != NULL);
+
+    memory_write(mem, 0x0000, 0x0A);
+    assert(memory_read(mem, 0xA000) == 0x1C);
+
+    // banks past the size in the header mirror the saved one
+    memory_write(mem, 0x6000, 0x01);
+    memory_write(mem, 0x4000, 0x03);
+    assert(memory_read(mem, 0xA000) == 0x1C);
+    memory_write(mem, 0xA000, 0x3E);
+    memory_write(mem, 0x4000, 0x00);
+    assert(memory_read(mem, 0xA000) == 0x3E);
+
+    battery_close(battery, mem);
+    free(mem);
+
+    remove(SAVE_FILE);
+}
+
+void test_battery_ignores_state_loads()
+{
+    remove(SAVE_FILE);
+
+    Memory* mem = battery_cartridge();
+    Battery* battery = battery_open(mem, SAVE_FILE);
+    assert(battery != NULL);
+
+    memory_write(mem, 0x0000, 0x0A);
+    memory_write(mem, 0xA000, 0x1C);
+    memory_write(mem, 0x0000, 0x00);
+
+    // what savestate_load does with a state taken before the save
+    uint8_t older[SRAM_SIZE];
+    memset(older, 0x77, sizeof(older));
+    memcpy(mem->sram, older, SRAM_SIZE);
+    assert(!mem->sram_dirty);
+
+    battery_close(battery, mem);
+    assert(mem->sram[0x0000] == 0x77);
+    free(mem);
+
+    FILE* f = fopen(SAVE_FILE, "rb");
+    uint8_t data[0x2000];
+    assert(fread(data, 1, sizeof(data), f) == sizeof(data));
+    fclose(f);
+    assert(data[0x0000] == 0x1C);
+    assert(data[0x0001] == 0x00);
+
+    remove(SAVE_FILE);
+}
+
+void test_battery_needs_battery()
+{
+    Memory* mem = memory_init();
+    mem->rom[0x147] = 0x02; // mbc1 + ram, no battery
+    mem->rom[0x149] = 0x02;
+
+    assert(battery_open(mem, SAVE_FILE) == NULL);
+    assert(mem->sram == mem->sram_buffer);
+
+    free(mem);
+}
+
+int main()
+{
+    test_battery_persists_sram();
+    test_battery_ignores_state_loads();
+    test_battery_needs_battery();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../inc/guestprof.h"
+
+#define SYMBOL_FILE "test_guestprof.sym"
+#define FOLDED_FILE "test_guestprof.tmp"
+
+static void write_file(const char* filename, const char* text)
+{
+    FILE* f = fopen(filename, "w");
+    fputs(text, f);
+    fclose(f);
+}
+
+// true if the folded profile has a line for exactly this call path
+static uint8_t has_path(const char* path)
+{
+    FILE* f = fopen(FOLDED_FILE, "r");
+    char line[512];
+    uint8_t found = 0;
+
+    while (!found && fgets(line, sizeof(line), f) != NULL)
+    {
+        char* cycles = strrchr(line, ' ');
+        found = cycles != NULL && (size_t)(cycles - line) == strlen(path) && strncmp(line, path, strlen(path)) == 0;
+    }
+
+    fclose(f);
+
+    return found;
+}
+
+static void run_steps(GameBoy* gb, uint32_t steps)
+{
+    for (uint32_t i = 0; i < steps; i++)
+        gameboy_step(gb);
+}
+
+void test_guestprof_nested_calls()
+{
+    GameBoy* gb = gameboy_init();
+    GuestProfiler* gp = guestprof_init();
+    gb->guest_profiler = gp;
+
+    uint8_t main_loop[] = { 0xCD, 0x00, 0x02, 0x18, 0xFB }; // call 0x200, jr -5
+    uint8_t outer[] = { 0xCD, 0x00, 0x03, 0xC9 };           // call 0x300, ret
+    uint8_t inner[] = { 0x00, 0x00, 0xC9 };                 // nop, nop, ret
+    memcpy(&gb->mem->rom[0x100], main_loop, sizeof(main_loop));
+    memcpy(&gb->mem->rom[0x200], outer, sizeof(outer));
+    memcpy(&gb->mem->rom[0x300], inner, sizeof(inner));
+
+    write_file(SYMBOL_FILE, "; comment\n00:0200 Outer\n00:0300 Inner\n");
+    assert(guestprof_load_symbols(gp, SYMBOL_FILE));
+    assert(gp->symbol_count == 2);
+
+    run_steps(gb, 70); // ten rounds of the loop
+
+    // every call returned, so the stack is back at the root
+    assert(gp->depth == 1);
+    assert(gp->total_cycles > 0);
+    assert(gp->halt_cycles == 0);
+    assert(gp->flat[0x300] == gp->flat[0x301]);
+
+    assert(guestprof_write_folded(gp, FOLDED_FILE));
+    assert(has_path("(root)"));
+    assert(has_path("(root);Outer"));
+    assert(has_path("(root);Outer;Inner"));
+
+    remove(SYMBOL_FILE);
+    remove(FOLDED_FILE);
+
+    gb->guest_profiler = NULL;
+    guestprof_free(gp);
+    gameboy_free(gb);
+}
+
+void test_guestprof_interrupts_and_halt()
+{
+    GameBoy* gb = gameboy_init();
+    GuestProfiler* gp = guestprof_init();
+    gb->guest_profiler = gp;
+
+    // enable the vblank interrupt and halt until it fires
+    uint8_t main_loop[] = { 0x3E, 0x01, 0xE0, 0xFF, 0xFB, 0x76, 0x18, 0xFD }; // ld a,1; ldh (ie),a; ei; halt; jr -3
+    memcpy(&gb->mem->rom[0x100], main_loop, sizeof(main_loop));
+    gb->mem->rom[0x40] = 0xD9; // reti
+
+    gameboy_run_frame(gb);
+    gameboy_run_frame(gb);
+
+    // frames end on vblank entry, the step that also dispatches the interrupt, so
+    // the handler is still on the stack until its reti
+    assert(gp->depth == 2);
+    run_steps(gb, 1);
+
+    assert(gp->halt_cycles > 0);
+    assert(gp->depth == 1);
+
+    assert(guestprof_write_folded(gp, FOLDED_FILE));
+    assert(has_path("(root);HALT"));
+    assert(has_path("(root);irq_vblank"));
+
+    remove(FOLDED_FILE);
+
+    gb->guest_profiler = NULL;
+    guestprof_free(gp);
+    gameboy_free(gb);
+}
+
+void test_guestprof_symbol_offsets()
+{
+    GameBoy* gb = gameboy_init();
+    GuestProfiler* gp = guestprof_init();
+    gb->guest_profiler = gp;
+
+    // call into the middle of a labelled routine in bank 1
+    uint8_t main_loop[] = { 0xCD, 0x04, 0x40, 0x18, 0xFB }; // call 0x4004, jr -5
+    memcpy(&gb->mem->rom[0x100], main_loop, sizeof(main_loop));
+    gb->mem->rom[0x4004] = 0xC9; // ret
+
+    write_file(SYMBOL_FILE, "01:4000 Banked\n");
+    assert(guestprof_load_symbols(gp, SYMBOL_FILE));
+
+    run_steps(gb, 30);
+
+    assert(guestprof_write_folded(gp, FOLDED_FILE));
+    assert(has_path("(root);Banked+4"));
+
+    remove(SYMBOL_FILE);
+    remove(FOLDED_FILE);
+
+    gb->guest_profiler = NULL;
+    guestprof_free(gp);
+    gameboy_free(gb);
+}
+
+int main()
+{
+    test_guestprof_nested_calls();
+    test_guestprof_interrupts_and_halt();
+    test_guestprof_symbol_offsets();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <assert.h>
+#include "../inc/interrupts.h"
+#include "../inc/gameboy.h"
+
+void test_input_event_applied_at_cycle()
+{
+    GameBoy* gb = gameboy_init();
+    gb->mem->IF = 0;
+
+    uint8_t pressed_a = INPUT_RELEASED & ~(KEY_A << 4);
+    assert(input_queue_push(&gb->input, 100, pressed_a));
+
+    while (gb->mem->cycles < 100)
+    {
+        assert(gb->mem->joypad_state == INPUT_RELEASED);
+        gameboy_step(gb);
+    }
+
+    gameboy_step(gb);
+    assert(gb->mem->joypad_state == pressed_a);
+    assert(!input_queue_pending(&gb->input));
+
+    gameboy_free(gb);
+}
+
+void test_input_joypad_interrupt_on_press()
+{
+    Memory* mem = memory_init();
+    mem->IF = 0;
+
+    // only the d-pad is selected, so pressing A doesn't pull any line low
+    mem->joyp = 0x20;
+    input_apply(mem, INPUT_RELEASED & ~(KEY_A << 4));
+    assert((mem->IF & JOYPAD_INTERRUPT) == 0);
+
+    input_apply(mem, INPUT_RELEASED & ~(KEY_A << 4) & ~KEY_UP);
+    assert(mem->IF & JOYPAD_INTERRUPT);
+
+    // releasing is a low to high transition and doesn't fire
+    mem->IF = 0;
+    input_apply(mem, INPUT_RELEASED);
+    assert((mem->IF & JOYPAD_INTERRUPT) == 0);
+
+    free(mem);
+}
+
+void test_input_queue_full()
+{
+    InputQueue queue = { 0 };
+
+    for (int i = 0; i < INPUT_QUEUE_SIZE; i++)
+        assert(input_queue_push(&queue, i, INPUT_RELEASED));
+
+    assert(input_queue_push(&queue, INPUT_QUEUE_SIZE, INPUT_RELEASED) == 0);
+
+    input_queue_clear(&queue);
+    assert(!input_queue_pending(&queue));
+}
+
+int main()
+{
+    test_input_event_applied_at_cycle();
+    test_input_joypad_interrupt_on_press();
+    test_input_queue_full();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
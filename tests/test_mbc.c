@@ -91,6 +91,7 @@ void test_mbc1_ram_read()
 {
     Memory *mem = memory_init();
     set_mbc_type(mem, MBC1);
+    mem->rom[0x149] = 0x03; // 32 KB
 
     // disable ram
     memory_write(mem, 0x0000, 0x00);
@@ -187,6 +188,161 @@ void test_mbc1_ram_bank_switch()
     free(mem);
 }
 
+void test_mbc3_rom_and_ram_read()
+{
+    Memory *mem = memory_init();
+    set_mbc_type(mem, MBC3);
+
+    // 2 MB, 128 banks
+    mem->rom[0x148] = 6;
+
+    for (size_t bank = 0; bank < 128; bank++)
+    {
+        memory_write(mem, 0x2000, bank);
+
+        uint8_t mapped = bank == 0 ? 1 : bank;
+        mem->rom[0x4000 * mapped + 0x123] = 0x1C;
+        assert(memory_read(mem, 0x4123) == 0x1C);
+        mem->rom[0x4000 * mapped + 0x123] = 0x00;
+    }
+
+    assert(memory_read(mem, 0xA000) == 0xFF);
+    mem->rom[0x149] = 0x03; // 32 KB
+    memory_write(mem, 0x0000, 0x0A);
+
+    for (size_t ram_bank = 0; ram_bank < 4; ram_bank++)
+    {
+        memory_write(mem, 0x4000, ram_bank);
+        memory_write(mem, 0xA001, 0x10 + ram_bank);
+    }
+
+    for (size_t ram_bank = 0; ram_bank < 4; ram_bank++)
+        assert(mem->sram[0x2000 * ram_bank + 1] == 0x10 + ram_bank);
+
+    free(mem);
+}
+
+void test_mbc3_rtc()
+{
+    Memory *mem = memory_init();
+    set_mbc_type(mem, MBC3);
+
+    memory_write(mem, 0x0000, 0x0A);
+
+    // set the clock to 23:59:58 on day 511
+    memory_write(mem, 0x4000, 0x08);
+    memory_write(mem, 0xA000, 58);
+    memory_write(mem, 0x4000, 0x09);
+    memory_write(mem, 0xA000, 59);
+    memory_write(mem, 0x4000, 0x0A);
+    memory_write(mem, 0xA000, 23);
+    memory_write(mem, 0x4000, 0x0B);
+    memory_write(mem, 0xA000, 0xFF);
+    memory_write(mem, 0x4000, 0x0C);
+    memory_write(mem, 0xA000, 0x01);
+
+    // runs off the emulated cycle counter: three seconds later it wrapped around
+    mem->cycles += 3 * RTC_TICKS_PER_SECOND;
+
+    // nothing changes until the clock is latched
+    memory_write(mem, 0x4000, 0x08);
+    assert(memory_read(mem, 0xA000) == 0);
+
+    memory_write(mem, 0x6000, 0x00);
+    memory_write(mem, 0x6000, 0x01);
+
+    assert(memory_read(mem, 0xA000) == 1);
+    memory_write(mem, 0x4000, 0x09);
+    assert(memory_read(mem, 0xA000) == 0);
+    memory_write(mem, 0x4000, 0x0A);
+    assert(memory_read(mem, 0xA000) == 0);
+    memory_write(mem, 0x4000, 0x0B);
+    assert(memory_read(mem, 0xA000) == 0);
+    memory_write(mem, 0x4000, 0x0C);
+    assert(memory_read(mem, 0xA000) == 0x80);
+
+    // halted clocks don't count
+    memory_write(mem, 0xA000, 0x40);
+    mem->cycles += 10 * RTC_TICKS_PER_SECOND;
+    memory_write(mem, 0x6000, 0x00);
+    memory_write(mem, 0x6000, 0x01);
+    memory_write(mem, 0x4000, 0x08);
+    assert(memory_read(mem, 0xA000) == 1);
+
+    // selecting a ram bank maps the ram back
+    memory_write(mem, 0x4000, 0x00);
+    memory_write(mem, 0xA000, 0x1C);
+    assert(mem->sram[0] == 0x1C);
+
+    free(mem);
+}
+
+void test_mbc5_rom_read()
+{
+    Memory *mem = memory_init();
+    set_mbc_type(mem, MBC5);
+
+    // 8 MB, 512 banks
+    mem->rom[0x148] = 8;
+
+    for (size_t bank = 0; bank < 512; bank++)
+    {
+        memory_write(mem, 0x2000, bank & 0xFF);
+        memory_write(mem, 0x3000, bank >> 8);
+        assert(mem->mbc.rom_bank == bank);
+
+        // bank 0 can be mapped at 4000-7FFF too
+        mem->rom[0x4000 * bank + 0x1000] = 0x1C;
+        assert(memory_read(mem, 0x5000) == 0x1C);
+        mem->rom[0x4000 * bank + 0x1000] = 0x00;
+    }
+
+    // smaller roms only decode as many bank bits as they need
+    mem->rom[0x148] = 2;
+    memory_write(mem, 0x3000, 0x00);
+    memory_write(mem, 0x2000, 0x13);
+    mem->rom[0x4000 * 3] = 0x2D;
+    assert(memory_read(mem, 0x4000) == 0x2D);
+
+    free(mem);
+}
+
+void test_mbc5_ram_read()
+{
+    Memory *mem = memory_init();
+    set_mbc_type(mem, MBC5);
+    mem->rom[0x149] = 0x04; // 128 KB
+
+    memory_write(mem, 0xA000, 0x1C);
+    assert(memory_read(mem, 0xA000) == 0xFF);
+    assert(mem->sram[0] == 0x00);
+
+    memory_write(mem, 0x0000, 0x0A);
+
+    for (size_t ram_bank = 0; ram_bank < 16; ram_bank++)
+    {
+        memory_write(mem, 0x4000, ram_bank);
+        memory_write(mem, 0xBFFF, ram_bank);
+        assert(mem->sram[0x2000 * ram_bank + 0x1FFF] == ram_bank);
+        assert(memory_read(mem, 0xBFFF) == ram_bank);
+    }
+
+    // banks past the header's ram size mirror the ones it has
+    mem->rom[0x149] = 0x03; // 32 KB
+    memory_write(mem, 0x4000, 0x05);
+    assert(memory_read(mem, 0xBFFF) == 0x01);
+    memory_write(mem, 0xBFFF, 0x2D);
+    assert(mem->sram[0x2000 * 1 + 0x1FFF] == 0x2D);
+
+    // turning the motor on doesn't switch banks
+    mem->rom[0x147] = 0x1E; // mbc5 + rumble + ram + battery
+    memory_write(mem, 0x4000, 0x08 | 0x02);
+    assert(mem->mbc.ram_bank == 0x02);
+    assert(memory_read(mem, 0xBFFF) == 0x02);
+
+    free(mem);
+}
+
 int main()
 {
     test_mbc_none_rom_read();
@@ -197,6 +353,10 @@ int main()
     test_mbc1_banking_mode_enable();
     test_mbc1_ram_enable();
     test_mbc1_ram_bank_switch();
+    test_mbc3_rom_and_ram_read();
+    test_mbc3_rtc();
+    test_mbc5_rom_read();
+    test_mbc5_ram_read();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -92,9 +92,41 @@ void test_memory_io_write_and_read()
 {
     Memory *mem = memory_init();
 
-    memory_write(mem, 0xFF00, 0x1C);
-    assert(memory_read(mem, 0xFF00) == 0x1C);
-    assert(mem->io[0x0000] == 0x1C);
+    memory_write(mem, 0xFF01, 0x1C);
+    assert(memory_read(mem, 0xFF01) == 0x1C);
+    assert(mem->io[0x0001] == 0x1C);
+    assert(mem->sb == 0x1C);
+
+    free(mem);
+}
+
+void test_memory_io_register_handlers()
+{
+    Memory *mem = memory_init();
+
+    // named fields and io[] are the same storage
+    memory_write(mem, 0xFF42, 0x1C);
+    assert(mem->scy == 0x1C);
+    mem->lcdc = 0x2D;
+    assert(memory_read(mem, 0xFF40) == 0x2D);
+    assert(mem->io[0x40] == 0x2D);
+
+    // only the row select bits of JOYP are writable, the buttons come from the joypad
+    mem->joypad_state = 0xE7;
+    memory_write(mem, 0xFF00, 0x10);
+    assert(mem->joyp == 0xD0);
+    assert(memory_read(mem, 0xFF00) == 0x1E);
+
+    memory_write(mem, 0xFF04, 0x1C);
+    assert(mem->div == 0x00);
+
+    mem->stat = 0x83;
+    memory_write(mem, 0xFF41, 0x7C);
+    assert(mem->stat == 0xFB);
+
+    mem->ly = 0x10;
+    memory_write(mem, 0xFF44, 0x1C);
+    assert(mem->ly == 0x10);
 
     free(mem);
 }
@@ -133,6 +165,65 @@ void test_memory_write16_and_read16()
     free(mem);
 }
 
+void test_memory_oam_dma_copies_and_blocks()
+{
+    Memory *mem = memory_init();
+
+    for (uint16_t i = 0; i < DMA_LENGTH; i++)
+        mem->wram0[0x100 + i] = i;
+
+    memory_write(mem, DMA_ADDR, 0xC1);
+    for (uint16_t i = 0; i < DMA_LENGTH; i++)
+        assert(mem->oam[i] == i);
+
+    // only i/o and hram are reachable until the transfer is over
+    assert(mem->dma_ticks == DMA_TICKS);
+    assert(memory_read(mem, 0xC101) == 0xFF);
+    memory_write(mem, 0xC101, 0x1C);
+    assert(mem->wram0[0x101] == 0x01);
+
+    memory_write(mem, 0xFF80, 0x1C);
+    assert(memory_read(mem, 0xFF80) == 0x1C);
+    assert(memory_read(mem, DMA_ADDR) == 0xC1);
+
+    memory_dma_update(mem, DMA_TICKS - 4);
+    assert(memory_read(mem, 0xC101) == 0xFF);
+
+    memory_dma_update(mem, 4);
+    assert(mem->dma_ticks == 0);
+    assert(memory_read(mem, 0xC101) == 0x01);
+
+    free(mem);
+}
+
+void test_memory_oam_dma_from_banked_rom_and_sram()
+{
+    Memory *mem = memory_init();
+    set_mbc_type(mem, MBC1);
+    mem->rom[0x148] = 2;
+
+    memory_write(mem, 0x2000, 3);
+    mem->rom[0x4000 * 3 + 0x200] = 0x1C;
+    mem->rom[0x4000 * 3 + 0x29F] = 0x2D;
+
+    memory_write(mem, DMA_ADDR, 0x42);
+    assert(mem->oam[0x00] == 0x1C);
+    assert(mem->oam[0x9F] == 0x2D);
+    memory_dma_update(mem, DMA_TICKS);
+
+    // cartridge ram goes through the mbc, disabled ram reads as 0xFF
+    mem->sram[0x10] = 0x3E;
+    memory_write(mem, DMA_ADDR, 0xA0);
+    assert(mem->oam[0x10] == 0xFF);
+    memory_dma_update(mem, DMA_TICKS);
+
+    memory_write(mem, 0x0000, 0x0A);
+    memory_write(mem, DMA_ADDR, 0xA0);
+    assert(mem->oam[0x10] == 0x3E);
+
+    free(mem);
+}
+
 int main()
 {
     test_memory_vram_write_and_read();
@@ -142,9 +233,12 @@ int main()
     test_memory_oam_write_and_read();
     test_memory_not_usable_area_read();
     test_memory_io_write_and_read();
+    test_memory_io_register_handlers();
     test_memory_hram_write_and_read();
     test_memory_ie_write_and_read();
     test_memory_write16_and_read16();
+    test_memory_oam_dma_copies_and_blocks();
+    test_memory_oam_dma_from_banked_rom_and_sram();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
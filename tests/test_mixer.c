@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <assert.h>
+#include "../inc/mixer.h"
+
+#define CLOCK 4194304
+#define FRAME 70224
+
+void test_mixer_step_settles_on_its_level()
+{
+    Mixer* mixer = mixer_init(48000, CLOCK);
+
+    mixer_add_delta(mixer, 1000, 100, -50);
+    mixer_end_frame(mixer, FRAME);
+
+    // nothing before the impulse, the full step shortly after it
+    assert(mixer->samples[0] == 0 && mixer->samples[1] == 0);
+
+    // the dc blocker only starts pulling it back
+    int16_t left = mixer->samples[40 * 2];
+    int16_t right = mixer->samples[40 * 2 + 1];
+    assert(left > 100 * MIXER_SCALE * 0.85 && left <= 100 * MIXER_SCALE);
+    assert(right < -50 * MIXER_SCALE * 0.85 && right >= -50 * MIXER_SCALE);
+
+    // and eventually removes the offset
+    mixer_end_frame(mixer, FRAME);
+    mixer_end_frame(mixer, FRAME);
+    assert(abs(mixer->samples[(mixer->sample_count - 1) * 2]) < 100 * MIXER_SCALE / 20);
+
+    mixer_free(mixer);
+}
+
+void test_mixer_keeps_sub_sample_timing()
+{
+    Mixer* early = mixer_init(48000, CLOCK);
+    Mixer* late = mixer_init(48000, CLOCK);
+
+    // half a sample apart
+    mixer_add_delta(early, 8738, 100, 100);
+    mixer_add_delta(late, 8738 + 44, 100, 100);
+    mixer_end_frame(early, FRAME);
+    mixer_end_frame(late, FRAME);
+
+    // 8738 cycles is sample 100, the step crosses half way BLEP_DELAY samples later
+    uint32_t center = 100 + BLEP_DELAY;
+    assert(early->samples[center * 2] > late->samples[center * 2]);
+    assert(early->samples[center * 2] > 100 * MIXER_SCALE / 4);
+    assert(late->samples[center * 2] < 100 * MIXER_SCALE * 3 / 4);
+
+    mixer_free(early);
+    mixer_free(late);
+}
+
+void test_mixer_carries_steps_into_the_next_frame()
+{
+    Mixer* mixer = mixer_init(48000, CLOCK);
+
+    mixer_add_delta(mixer, FRAME - 1, 100, 100);
+    mixer_end_frame(mixer, FRAME);
+    uint32_t first = mixer->sample_count;
+
+    mixer_end_frame(mixer, FRAME);
+
+    // the frames together hold every sample of two frames
+    assert(first + mixer->sample_count == (uint64_t)FRAME * 2 * 48000 / CLOCK);
+    assert(mixer->samples[BLEP_TAPS * 2] > 100 * MIXER_SCALE * 0.9);
+
+    mixer_free(mixer);
+}
+
+int main()
+{
+    test_mixer_step_settles_on_its_level();
+    test_mixer_keeps_sub_sample_timing();
+    test_mixer_carries_steps_into_the_next_frame();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <assert.h>
+#include "../inc/verify.h"
+
+#define MOVIE_FILE "test_movie.tmp"
+
+static Movie* record_movie(uint32_t frames, uint32_t checkpoint_interval)
+{
+    GameBoy* gb = gameboy_init();
+    Movie* movie = movie_init();
+    movie->header.checkpoint_interval = checkpoint_interval;
+    movie_record_start(movie, gb);
+
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        if (frame % 3 == 0)
+        {
+            uint8_t buttons = INPUT_RELEASED & ~(frame & 0x0F);
+            uint64_t cycle = gb->mem->cycles + frame * 100;
+
+            input_queue_push(&gb->input, cycle, buttons);
+            movie_record_input(movie, cycle, buttons);
+        }
+
+        // lands right around the frame boundary
+        if (frame % 4 == 1)
+        {
+            uint64_t cycle = gb->mem->cycles + (uint64_t)TICKS_PER_FRAME - 2;
+
+            input_queue_push(&gb->input, cycle, INPUT_RELEASED & ~(KEY_START << 4));
+            movie_record_input(movie, cycle, INPUT_RELEASED & ~(KEY_START << 4));
+        }
+
+        gameboy_run_frame(gb);
+        movie_record_frame(movie, gb);
+    }
+
+    gameboy_free(gb);
+
+    return movie;
+}
+
+void test_movie_round_trip_verifies()
+{
+    Movie* recorded = record_movie(20, 0);
+    assert(movie_write_file(recorded, MOVIE_FILE));
+
+    Movie* movie = movie_read_file(MOVIE_FILE);
+    assert(movie != NULL);
+    assert(movie->header.frame_count == 20);
+    assert(movie->header.event_count == recorded->header.event_count);
+
+    for (uint32_t i = 0; i < movie->header.event_count; i++)
+    {
+        assert(movie->events[i].cycle == recorded->events[i].cycle);
+        assert(movie->events[i].buttons == recorded->events[i].buttons);
+    }
+
+    GameBoy* gb = gameboy_init();
+    MoviePlayer player;
+    assert(movie_player_start(&player, movie, gb));
+
+    while (!movie_player_done(&player))
+        assert(movie_player_run_frame(&player, gb));
+
+    assert(player.mismatches == 0);
+
+    gameboy_free(gb);
+    movie_free(movie);
+    movie_free(recorded);
+    remove(MOVIE_FILE);
+}
+
+static void corrupt_header(size_t offset, uint32_t value)
+{
+    FILE* f = fopen(MOVIE_FILE, "r+b");
+    assert(f != NULL);
+    assert(fseek(f, (long)offset, SEEK_SET) == 0);
+    assert(fwrite(&value, sizeof(value), 1, f) == 1);
+    fclose(f);
+}
+
+void test_movie_rejects_corrupt_sizes()
+{
+    Movie* recorded = record_movie(20, 5);
+    const size_t fields[] = {
+        offsetof(MovieHeader, frame_count),
+        offsetof(MovieHeader, event_count),
+        offsetof(MovieHeader, start_state_size),
+        offsetof(MovieHeader, events_size),
+        offsetof(MovieHeader, checkpoint_count)
+    };
+
+    // sizes past what the file holds are refused before anything gets allocated
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        assert(movie_write_file(recorded, MOVIE_FILE));
+        corrupt_header(fields[i], 0xFFFFFFFF);
+        assert(movie_read_file(MOVIE_FILE) == NULL);
+
+        assert(movie_write_file(recorded, MOVIE_FILE));
+        corrupt_header(fields[i], 0x00FFFFFF);
+        assert(movie_read_file(MOVIE_FILE) == NULL);
+    }
+
+    movie_free(recorded);
+    remove(MOVIE_FILE);
+}
+
+void test_movie_detects_desync()
+{
+    Movie* movie = record_movie(20, 0);
+    // events[2] is the one pushed on frame 3
+    movie->events[2].buttons ^= KEY_A << 4;
+
+    GameBoy* gb = gameboy_init();
+    MoviePlayer player;
+    assert(movie_player_start(&player, movie, gb));
+
+    while (!movie_player_done(&player))
+        movie_player_run_frame(&player, gb);
+
+    assert(player.mismatches > 0);
+    assert(player.first_mismatch == 3);
+
+    gameboy_free(gb);
+    movie_free(movie);
+}
+
+void test_movie_rejects_other_rom()
+{
+    Movie* movie = record_movie(1, 0);
+
+    GameBoy* gb = gameboy_init();
+    gb->mem->rom[0x200] = 0x1C;
+
+    MoviePlayer player;
+    assert(movie_player_start(&player, movie, gb) == 0);
+
+    gameboy_free(gb);
+    movie_free(movie);
+}
+
+void test_movie_parallel_verify()
+{
+    Movie* recorded = record_movie(23, 5);
+    assert(recorded->header.checkpoint_count == 4);
+    assert(movie_write_file(recorded, MOVIE_FILE));
+
+    Movie* movie = movie_read_file(MOVIE_FILE);
+    assert(movie != NULL);
+    assert(movie->header.checkpoint_count == 4);
+    assert(movie->checkpoints[3].frame == 20);
+
+    GameBoy* template = gameboy_init();
+    VerifyResult result;
+
+    assert(movie_verify(movie, template, 3, &result));
+    assert(result.segments == 5);
+    assert(result.failed_segments == 0);
+
+    // a changed input only breaks the segment it falls into
+    movie->events[movie->header.event_count - 1].buttons ^= KEY_A;
+    assert(movie_verify(movie, template, 3, &result) == 0);
+    assert(result.failed_segments == 1);
+    assert(result.first_mismatch >= 20);
+
+    gameboy_free(template);
+    movie_free(movie);
+    movie_free(recorded);
+    remove(MOVIE_FILE);
+}
+
+void test_movie_verify_reports_unreadable_checkpoints()
+{
+    Movie* movie = record_movie(20, 5);
+    assert(movie->header.checkpoint_count >= 2);
+    movie->checkpoints[1].data[0] ^= 0xFF;
+
+    GameBoy* template = gameboy_init();
+    VerifyResult result;
+    assert(movie_verify(movie, template, 2, &result) == 0);
+
+    // the segment starting there never ran, the one ending there can't compare
+    assert(result.status == VERIFY_FAILED);
+    assert(result.unreadable_segments == 1);
+    assert(result.checkpoint_mismatches == 1);
+    assert(result.failed_segments == 2);
+    assert(result.mismatches == 0);
+
+    gameboy_free(template);
+    movie_free(movie);
+}
+
+void test_movie_verify_reports_why_nothing_ran()
+{
+    GameBoy* template = gameboy_init();
+    VerifyResult result;
+
+    Movie* empty = record_movie(0, 5);
+    assert(movie_verify(empty, template, 2, &result) == 0);
+    assert(result.status == VERIFY_EMPTY);
+
+    // without checkpoints the whole movie is one segment
+    Movie* unsplit = record_movie(7, 0);
+    assert(unsplit->header.checkpoint_count == 0);
+    assert(movie_verify(unsplit, template, 2, &result));
+    assert(result.status == VERIFY_PASSED);
+    assert(result.segments == 1);
+
+    template->mem->rom[0x200] = 0x1C;
+    assert(movie_verify(unsplit, template, 2, &result) == 0);
+    assert(result.status == VERIFY_OTHER_ROM);
+
+    movie_free(unsplit);
+    movie_free(empty);
+    gameboy_free(template);
+}
+
+int main()
+{
+    test_movie_round_trip_verifies();
+    test_movie_rejects_corrupt_sizes();
+    test_movie_detects_desync();
+    test_movie_rejects_other_rom();
+    test_movie_parallel_verify();
+    test_movie_verify_reports_unreadable_checkpoints();
+    test_movie_verify_reports_why_nothing_ran();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "../inc/pacing.h"
+
+void test_pacing_steady_frames()
+{
+    Pacer* pacer = (Pacer*) malloc(sizeof(Pacer));
+    pacer_init(pacer, 59.7275, 0);
+
+    for (int i = 0; i < 100; i++)
+        pacer_record_frame(pacer, 16742706);
+
+    assert(pacer->stats.count == 100);
+    assert(fabs(pacer_mean_ms(pacer) - 16.742706) < 0.000001);
+    assert(pacer_stddev_ms(pacer) < 0.000001);
+    assert(fabs(pacer_percentile_ms(pacer, 50.0) - 16.8) < 0.000001);
+    assert(fabs(pacer_percentile_ms(pacer, 99.0) - 16.8) < 0.000001);
+
+    // a constant rate has no jitter, however far it is from a bucket edge
+    assert(pacer->stats.jitter_count == 99);
+    assert(fabs(pacer_jitter_ms(pacer, 99.0) - 0.01) < 0.000001);
+
+    free(pacer);
+}
+
+void test_pacing_percentiles()
+{
+    Pacer* pacer = (Pacer*) malloc(sizeof(Pacer));
+    pacer_init(pacer, 60.0, 0);
+
+    // 98 good frames, then a hitch and the short frame paying it back
+    for (int i = 0; i < 98; i++)
+        pacer_record_frame(pacer, 16650000);
+    pacer_record_frame(pacer, 20000000);
+    pacer_record_frame(pacer, 13300000);
+
+    assert(pacer->stats.min_ns == 13300000);
+    assert(pacer->stats.max_ns == 20000000);
+    assert(fabs(pacer_percentile_ms(pacer, 50.0) - 16.7) < 0.000001);
+    assert(fabs(pacer_percentile_ms(pacer, 99.0) - 16.7) < 0.000001);
+    assert(fabs(pacer_percentile_ms(pacer, 100.0) - 20.1) < 0.000001);
+
+    // 3.35 ms into the hitch and 6.7 ms out of it
+    assert(fabs(pacer_jitter_ms(pacer, 50.0) - 0.01) < 0.000001);
+    assert(fabs(pacer_jitter_ms(pacer, 98.0) - 3.36) < 0.000001);
+    assert(fabs(pacer_jitter_ms(pacer, 99.0) - 6.71) < 0.000001);
+
+    // whole seconds don't overflow the histograms
+    pacer_record_frame(pacer, 1000000000);
+    assert(fabs(pacer_percentile_ms(pacer, 100.0) - PACER_BUCKETS * PACER_BUCKET_NS / 1e6) < 0.000001);
+    assert(fabs(pacer_jitter_ms(pacer, 100.0) - PACER_JITTER_BUCKETS * PACER_JITTER_BUCKET_NS / 1e6) < 0.000001);
+
+    free(pacer);
+}
+
+void test_pacing_trusts_matching_vsync()
+{
+    // displays report whole hertz
+    assert(pacer_vsync_paces(59.7275, 60.0));
+    assert(pacer_vsync_paces(59.7275, 59.0) == 0);
+    assert(pacer_vsync_paces(59.7275, 75.0) == 0);
+    assert(pacer_vsync_paces(59.7275, 144.0) == 0);
+    assert(pacer_vsync_paces(59.7275, 50.0) == 0);
+}
+
+int main()
+{
+    test_pacing_steady_frames();
+    test_pacing_percentiles();
+    test_pacing_trusts_matching_vsync();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
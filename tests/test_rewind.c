@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <assert.h>
+#include "../inc/rewind.h"
+
+void test_rewind_step_back_restores_frames()
+{
+    GameBoy* gb = gameboy_init();
+
+    RewindConfig config = rewind_default_config();
+    config.keyframe_interval = 4;
+    Rewind* rw = rewind_init(config);
+
+    for (uint8_t frame = 0; frame < 10; frame++)
+    {
+        gb->mem->wram0[0x100] = frame;
+        gb->cpu->pc = 0x150 + frame;
+        rewind_capture(rw, gb);
+    }
+
+    assert(rewind_get_stats(rw).snapshots == 10);
+
+    for (int frame = 9; frame >= 0; frame--)
+    {
+        gb->mem->wram0[0x100] = 0xFF;
+        assert(rewind_step_back(rw, gb));
+        assert(gb->mem->wram0[0x100] == frame);
+        assert(gb->cpu->pc == 0x150 + frame);
+    }
+
+    assert(rewind_step_back(rw, gb) == 0);
+
+    // capturing again after rewinding everything starts a fresh keyframe
+    gb->mem->wram0[0x100] = 0x42;
+    rewind_capture(rw, gb);
+    gb->mem->wram0[0x100] = 0x00;
+    assert(rewind_step_back(rw, gb));
+    assert(gb->mem->wram0[0x100] == 0x42);
+
+    rewind_free(rw);
+    gameboy_free(gb);
+}
+
+void test_rewind_respects_limits()
+{
+    GameBoy* gb = gameboy_init();
+
+    RewindConfig config = rewind_default_config();
+    config.max_snapshots = 8;
+    config.keyframe_interval = 4;
+    config.capture_interval = 2;
+    Rewind* rw = rewind_init(config);
+
+    for (uint8_t frame = 0; frame < 40; frame++)
+    {
+        gb->mem->wram1[frame] = frame;
+        rewind_capture(rw, gb);
+        assert(rw->count <= config.max_snapshots);
+    }
+
+    // only every other frame is captured, and the oldest groups were evicted
+    RewindStats stats = rewind_get_stats(rw);
+    assert(stats.snapshots > 0 && stats.snapshots <= 8);
+    assert(stats.bytes_used <= config.budget_bytes);
+
+    assert(rewind_step_back(rw, gb));
+    assert(gb->mem->wram1[39] == 39);
+
+    rewind_free(rw);
+    gameboy_free(gb);
+}
+
+void test_rewind_stays_within_budget()
+{
+    GameBoy* gb = gameboy_init();
+
+    // a keyframe and a few deltas fit, a whole group doesn't
+    RewindConfig config = rewind_default_config();
+    config.keyframe_interval = 1000;
+    Rewind* rw = rewind_init(config);
+    rewind_capture(rw, gb);
+    config.budget_bytes = rw->bytes_used + 1024;
+    rewind_free(rw);
+
+    rw = rewind_init(config);
+    for (uint16_t frame = 0; frame < 200; frame++)
+    {
+        gb->mem->wram1[frame] = (uint8_t)frame + 1;
+        rewind_capture(rw, gb);
+        assert(rw->bytes_used <= config.budget_bytes);
+        assert(rw->count > 0);
+    }
+
+    // the group was restarted, the newest frame is still there
+    assert(rewind_step_back(rw, gb));
+    assert(gb->mem->wram1[199] == 200);
+    rewind_free(rw);
+
+    // not even a keyframe fits
+    config.budget_bytes = 16;
+    rw = rewind_init(config);
+    rewind_capture(rw, gb);
+    rewind_capture(rw, gb);
+    assert(rw->count == 0 && rw->bytes_used == 0);
+    assert(rewind_step_back(rw, gb) == 0);
+
+    rewind_free(rw);
+    gameboy_free(gb);
+}
+
+int main()
+{
+    test_rewind_step_back_restores_frames();
+    test_rewind_respects_limits();
+    test_rewind_stays_within_budget();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
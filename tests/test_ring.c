@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../inc/ring.h"
+
+#define STREAM_FRAMES 200000
+
+void test_ring_wraps_around()
+{
+    AudioRing* ring = ring_init(6);
+    assert(ring->capacity == 8);
+
+    int16_t in[5 * 2], out[5 * 2];
+    for (int16_t round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < 5 * 2; i++)
+            in[i] = round * 100 + i;
+
+        assert(ring_write(ring, in, 5) == 5);
+        assert(ring_fill(ring) == 5);
+        assert(ring_read(ring, out, 5) == 5);
+
+        for (int i = 0; i < 5 * 2; i++)
+            assert(out[i] == in[i]);
+    }
+
+    assert(ring_fill(ring) == 0);
+    assert(ring->dropped == 0);
+
+    ring_free(ring);
+}
+
+void test_ring_drops_what_does_not_fit()
+{
+    AudioRing* ring = ring_init(8);
+
+    int16_t in[12 * 2] = { 0 }, out[12 * 2];
+    assert(ring_write(ring, in, 6) == 6);
+    assert(ring_write(ring, in, 6) == 2);
+    assert(ring->dropped == 4);
+
+    // reading less than is queued leaves the rest, reading more returns what's there
+    assert(ring_read(ring, out, 3) == 3);
+    assert(ring_fill(ring) == 5);
+    assert(ring_read(ring, out, 12) == 5);
+    assert(ring_read(ring, out, 1) == 0);
+
+    ring_free(ring);
+}
+
+static void* consume(void* arg)
+{
+    AudioRing* ring = (AudioRing*) arg;
+    int16_t out[64 * 2];
+    uint32_t expected = 0;
+
+    while (expected < STREAM_FRAMES)
+    {
+        uint32_t read = ring_read(ring, out, 1 + expected % 64);
+        if (read == 0)
+            sched_yield();
+
+        for (uint32_t i = 0; i < read; i++, expected++)
+        {
+            if (out[i * 2] != (int16_t)expected || out[i * 2 + 1] != (int16_t)~expected)
+                return (void*) 1;
+        }
+    }
+
+    return NULL;
+}
+
+void test_ring_streams_between_threads()
+{
+    AudioRing* ring = ring_init(256);
+
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, consume, ring);
+
+    // the producer retries what didn't fit, so every frame has to arrive in order
+    int16_t in[100 * 2];
+    uint32_t sent = 0;
+    while (sent < STREAM_FRAMES)
+    {
+        uint32_t count = STREAM_FRAMES - sent < 100 ? STREAM_FRAMES - sent : 100;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            in[i * 2] = (int16_t)(sent + i);
+            in[i * 2 + 1] = (int16_t)~(sent + i);
+        }
+
+        uint32_t written = ring_write(ring, in, count);
+        if (written == 0)
+            sched_yield();
+
+        sent += written;
+    }
+
+    void* result;
+    pthread_join(consumer, &result);
+    assert(result == NULL);
+
+    ring_free(ring);
+}
+
+int main()
+{
+    test_ring_wraps_around();
+    test_ring_drops_what_does_not_fit();
+    test_ring_streams_between_threads();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
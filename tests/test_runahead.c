@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../inc/runahead.h"
+
+static int presented = 0;
+
+static void count_present(Ppu* ppu)
+{
+    presented++;
+}
+
+void test_runahead_only_advances_one_frame()
+{
+    GameBoy* gb = gameboy_init();
+    GameBoy* reference = gameboy_init();
+    RunAhead* ra = runahead_init(2);
+
+    // stale pixels that every drawn frame overwrites
+    memset(gb->ppu->framebuffer, 3, sizeof(gb->ppu->framebuffer));
+    memset(reference->ppu->framebuffer, 3, sizeof(reference->ppu->framebuffer));
+
+    for (int frame = 0; frame < 3; frame++)
+    {
+        runahead_run_frame(ra, gb, count_present);
+        gameboy_run_frame(reference);
+    }
+
+    // the speculative frames are rolled back, so the machine matches one that ran normally
+    assert(gb->cpu->pc == reference->cpu->pc);
+    assert(gb->mem->ly == reference->mem->ly);
+    assert(gb->ppu->ticks == reference->ppu->ticks);
+
+    // frames end on vblank entry, and the real frame is drawn, not just the speculative
+    // one, so rewinding to it shows its own picture
+    assert(reference->mem->ly == SCREEN_HEIGHT);
+    assert(memcmp(gb->ppu->framebuffer, reference->ppu->framebuffer, sizeof(gb->ppu->framebuffer)) == 0);
+
+    assert(presented == 3);
+    assert(gb->ppu->frame_ready == 0);
+    assert(gb->ppu->skip_render == 0);
+
+    runahead_free(ra);
+    gameboy_free(reference);
+    gameboy_free(gb);
+}
+
+void test_runahead_keeps_queued_input()
+{
+    GameBoy* gb = gameboy_init();
+    GameBoy* reference = gameboy_init();
+    RunAhead* ra = runahead_init(2);
+
+    // queued ahead of time the way movie playback does, due in the second real frame
+    uint64_t cycle = LCD_FRAME_TICKS * 3 / 2;
+    input_queue_push(&gb->input, cycle, INPUT_RELEASED & ~(KEY_START << 4));
+    input_queue_push(&reference->input, cycle, INPUT_RELEASED & ~(KEY_START << 4));
+
+    runahead_run_frame(ra, gb, count_present);
+    gameboy_run_frame(reference);
+    assert(input_queue_pending(&gb->input));
+
+    for (int frame = 0; frame < 2; frame++)
+    {
+        runahead_run_frame(ra, gb, count_present);
+        gameboy_run_frame(reference);
+    }
+
+    assert(!input_queue_pending(&gb->input));
+    assert(gameboy_checksum(gb) == gameboy_checksum(reference));
+
+    runahead_free(ra);
+    gameboy_free(reference);
+    gameboy_free(gb);
+}
+
+void test_runahead_clamps_frames()
+{
+    RunAhead* ra = runahead_init(0);
+    assert(ra->frames == RUNAHEAD_MIN_FRAMES);
+    runahead_free(ra);
+
+    ra = runahead_init(10);
+    assert(ra->frames == RUNAHEAD_MAX_FRAMES);
+    runahead_free(ra);
+}
+
+int main()
+{
+    test_runahead_only_advances_one_frame();
+    test_runahead_keeps_queued_input();
+    test_runahead_clamps_frames();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
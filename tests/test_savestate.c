@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../inc/savestate.h"
+
+void test_rle_round_trip()
+{
+    uint8_t in[1000];
+    for (size_t i = 0; i < sizeof(in); i++)
+        in[i] = (i < 300 || i > 900) ? 0x00 : (uint8_t)(i * 7);
+
+    uint8_t encoded[RLE_BOUND(sizeof(in))];
+    size_t encoded_size = rle_encode(in, sizeof(in), encoded);
+    assert(encoded_size < sizeof(in));
+
+    uint8_t decoded[sizeof(in)];
+    assert(rle_decode(encoded, encoded_size, decoded, sizeof(decoded)) == sizeof(in));
+    assert(memcmp(in, decoded, sizeof(in)) == 0);
+
+    // truncated input must be rejected instead of overrunning
+    assert(rle_decode(encoded, encoded_size - 1, decoded, sizeof(decoded)) != sizeof(in));
+}
+
+void test_rle_stays_within_bound()
+{
+    // a single byte and 64 pairs, repeated: nothing long enough for a run, and the
+    // pairs used to straddle the 128 byte literal limit
+    const size_t size = 129000;
+    uint8_t* in = (uint8_t*) malloc(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        size_t offset = i % 129;
+        in[i] = offset == 0 ? 0x01 : (uint8_t)(0x02 + ((offset - 1) / 2) % 2);
+    }
+
+    uint8_t* encoded = (uint8_t*) malloc(2 * size);
+    size_t encoded_size = rle_encode(in, size, encoded);
+    assert(encoded_size <= RLE_BOUND(size));
+
+    uint8_t* decoded = (uint8_t*) malloc(size);
+    assert(rle_decode(encoded, encoded_size, decoded, size) == size);
+    assert(memcmp(in, decoded, size) == 0);
+
+    free(in);
+    free(encoded);
+    free(decoded);
+}
+
+void test_delta_round_trip()
+{
+    uint8_t base[4096];
+    uint8_t in[sizeof(base)];
+    for (size_t i = 0; i < sizeof(base); i++)
+        base[i] = in[i] = (uint8_t)(i * 13);
+
+    // scattered single bytes, a close pair and a long changed stretch
+    in[0] ^= 0xFF;
+    in[700] ^= 0x01;
+    in[705] ^= 0x01;
+    for (size_t i = 2000; i < 2600; i++)
+        in[i] = 0x5A;
+    in[sizeof(in) - 1] ^= 0x80;
+
+    uint8_t encoded[DELTA_BOUND(sizeof(in))];
+    size_t encoded_size = delta_encode(in, base, sizeof(in), encoded);
+    assert(encoded_size < 640);
+
+    uint8_t decoded[sizeof(in)];
+    assert(delta_decode(encoded, encoded_size, base, decoded, sizeof(decoded)) == sizeof(in));
+    assert(memcmp(in, decoded, sizeof(in)) == 0);
+
+    // nothing changed, nothing to store
+    assert(delta_encode(base, base, sizeof(base), encoded) == 0);
+
+    // every byte changed still fits the bound
+    for (size_t i = 0; i < sizeof(in); i++)
+        in[i] = ~base[i];
+    encoded_size = delta_encode(in, base, sizeof(in), encoded);
+    assert(encoded_size <= DELTA_BOUND(sizeof(in)));
+    assert(delta_decode(encoded, encoded_size, base, decoded, sizeof(decoded)) == sizeof(in));
+    assert(memcmp(in, decoded, sizeof(in)) == 0);
+
+    // a delta for a larger block must not write past a smaller one
+    assert(delta_decode(encoded, encoded_size, base, decoded, sizeof(decoded) - 1) == 0);
+    assert(delta_decode(encoded, encoded_size - 1, base, decoded, sizeof(decoded)) == 0);
+}
+
+void test_savestate_save_and_load()
+{
+    GameBoy* gb = gameboy_init();
+    SaveState* state = (SaveState*) malloc(sizeof(SaveState));
+
+    gb->cpu->a = 0x12;
+    gb->cpu->pc = 0x4321;
+    gb->mem->wram0[0x10] = 0x1C;
+    gb->mem->vram[0x20] = 0x2D;
+    gb->mem->lcdc = 0x80;
+    gb->mem->mbc.rom_bank = 3;
+    gb->ppu->framebuffer[5][5] = 2;
+    gb->timer.ticks = 100;
+
+    savestate_save(gb, state);
+
+    gb->cpu->a = 0x00;
+    gb->cpu->pc = 0x0000;
+    gb->mem->wram0[0x10] = 0x00;
+    gb->mem->vram[0x20] = 0x00;
+    gb->mem->lcdc = 0x00;
+    gb->mem->mbc.rom_bank = 1;
+    gb->mem->mbc.romx = NULL;
+    gb->ppu->framebuffer[5][5] = 0;
+    gb->timer.ticks = 0;
+
+    assert(savestate_load(gb, state));
+
+    assert(gb->cpu->a == 0x12);
+    assert(gb->cpu->pc == 0x4321);
+    assert(gb->mem->wram0[0x10] == 0x1C);
+    assert(gb->mem->vram[0x20] == 0x2D);
+    assert(gb->mem->lcdc == 0x80);
+    assert(gb->mem->mbc.rom_bank == 3);
+    assert(gb->mem->mbc.romx == &gb->mem->rom[3 * 0x4000]);
+    assert(gb->ppu->framebuffer[5][5] == 2);
+    assert(gb->timer.ticks == 100);
+
+    // states from another cartridge are refused
+    gb->mem->rom[0x14F] ^= 0xFF;
+    assert(savestate_load(gb, state) == 0);
+
+    free(state);
+    gameboy_free(gb);
+}
+
+void test_savestate_serialize_compressed()
+{
+    GameBoy* gb = gameboy_init();
+    SaveState* state = (SaveState*) malloc(sizeof(SaveState));
+    SaveState* restored = (SaveState*) malloc(sizeof(SaveState));
+    uint8_t* blob = (uint8_t*) malloc(SAVESTATE_MAX_SIZE);
+
+    gb->mem->wram1[0x100] = 0x55;
+    savestate_save(gb, state);
+
+    size_t size = savestate_serialize(state, blob, 1);
+    assert(size < sizeof(SaveState));
+
+    assert(savestate_deserialize(restored, blob, size));
+    assert(memcmp(&state->payload, &restored->payload, sizeof(SaveStatePayload)) == 0);
+
+    // a blob from a different layout version is refused
+    ((SaveStateHeader*)blob)->version = SAVESTATE_VERSION + 1;
+    assert(savestate_deserialize(restored, blob, size) == 0);
+
+    free(blob);
+    free(restored);
+    free(state);
+    gameboy_free(gb);
+}
+
+int main()
+{
+    test_rle_round_trip();
+    test_rle_stays_within_bound();
+    test_delta_round_trip();
+    test_savestate_save_and_load();
+    test_savestate_serialize_compressed();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "../inc/telemetry.h"
+#include "../inc/overlay.h"
+
+#define METRICS_FILE "test_telemetry.tmp"
+
+void test_telemetry_full_speed()
+{
+    Telemetry* t = (Telemetry*) malloc(sizeof(Telemetry));
+    telemetry_init(t, 60.0);
+
+    // 16.6 ms frames, 12 of them asleep
+    for (int i = 0; i < 100; i++)
+        telemetry_record(t, 16666667, 12000000, 1);
+
+    TelemetrySnapshot s;
+    telemetry_snapshot(t, 0, &s);
+
+    assert(s.frames == 100);
+    assert(fabs(s.speed_percent - 100.0) < 0.01);
+    assert(fabs(s.emulated_ms - 4.666667) < 0.001);
+    assert(fabs(s.sleep_ms - 12.0) < 0.001);
+    assert(fabs(s.p50_ms - 16.7) < 0.001);
+    assert(fabs(s.p99_ms - 16.7) < 0.001);
+
+    free(t);
+}
+
+void test_telemetry_window_rolls()
+{
+    Telemetry* t = (Telemetry*) malloc(sizeof(Telemetry));
+    telemetry_init(t, 60.0);
+
+    // a slow stretch followed by a whole window of fast frames
+    for (int i = 0; i < 50; i++)
+        telemetry_record(t, 40000000, 0, 1);
+    for (int i = 0; i < TELEMETRY_WINDOW; i++)
+        telemetry_record(t, 8333333, 0, 1);
+
+    TelemetrySnapshot window, session;
+    telemetry_snapshot(t, 0, &window);
+    telemetry_snapshot(t, 1, &session);
+
+    assert(window.frames == TELEMETRY_WINDOW);
+    assert(fabs(window.speed_percent - 200.0) < 0.1);
+    assert(fabs(window.p99_ms - 8.4) < 0.001);
+
+    assert(session.frames == TELEMETRY_WINDOW + 50);
+    assert(fabs(session.p99_ms - 40.1) < 0.001);
+    assert(session.speed_percent < window.speed_percent);
+
+    free(t);
+}
+
+void test_telemetry_write_metrics()
+{
+    Telemetry* t = (Telemetry*) malloc(sizeof(Telemetry));
+    telemetry_init(t, 60.0);
+    telemetry_record(t, 16666667, 10000000, 1);
+
+    assert(telemetry_write_metrics(t, METRICS_FILE));
+
+    FILE* f = fopen(METRICS_FILE, "r");
+    char line[256];
+    uint8_t found = 0;
+    while (fgets(line, sizeof(line), f) != NULL)
+        found |= strcmp(line, "oamx_emulated_frames_total 1\n") == 0;
+    fclose(f);
+
+    assert(found);
+
+    remove(METRICS_FILE);
+    free(t);
+}
+
+void test_overlay_draws_text()
+{
+    uint32_t pixels[16 * 8];
+    for (int i = 0; i < 16 * 8; i++)
+        pixels[i] = 0xFFFFFFFF;
+
+    overlay_draw_text(pixels, 16, 8, 1, 1, "1", 0x000000FF);
+
+    // the top row of a '1' is its middle column, the bottom row is full
+    assert(pixels[1 * 16 + 1] == 0x7F7F7FFF);
+    assert(pixels[1 * 16 + 2] == 0x000000FF);
+    assert(pixels[5 * 16 + 1] == 0x000000FF);
+    assert(pixels[5 * 16 + 3] == 0x000000FF);
+
+    // outside the box the buffer is untouched
+    assert(pixels[7 * 16 + 15] == 0xFFFFFFFF);
+}
+
+int main()
+{
+    test_telemetry_full_speed();
+    test_telemetry_window_rolls();
+    test_telemetry_write_metrics();
+    test_overlay_draws_text();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../inc/wav.h"
+
+#define WAV_FILE "test_wav.tmp.wav"
+#define PCM_FILE "test_wav.tmp"
+
+// longer than the ring, so the producer has to wait for the writer at least once
+#define TEST_FRAMES (WAV_RING_FRAMES * 3 + 123)
+
+static uint32_t read_le32(const uint8_t* in)
+{
+    return in[0] | in[1] << 8 | in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static void write_ramp(WavWriter* wav)
+{
+    int16_t frame[800 * 2];
+    uint32_t sent = 0;
+
+    while (sent < TEST_FRAMES)
+    {
+        uint32_t count = TEST_FRAMES - sent < 800 ? TEST_FRAMES - sent : 800;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            frame[i * 2] = (int16_t)(sent + i);
+            frame[i * 2 + 1] = (int16_t)-(sent + i);
+        }
+
+        wav_write(wav, frame, count);
+        sent += count;
+    }
+}
+
+static uint8_t* read_file(const char* filename, long* size)
+{
+    FILE* f = fopen(filename, "rb");
+    assert(f != NULL);
+
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = (uint8_t*) malloc(*size);
+    assert(fread(data, 1, *size, f) == (size_t)*size);
+    fclose(f);
+
+    return data;
+}
+
+static void assert_ramp(const uint8_t* data)
+{
+    for (uint32_t i = 0; i < TEST_FRAMES; i++)
+    {
+        int16_t left = (int16_t)(data[i * 4] | data[i * 4 + 1] << 8);
+        int16_t right = (int16_t)(data[i * 4 + 2] | data[i * 4 + 3] << 8);
+        assert(left == (int16_t)i && right == (int16_t)-i);
+    }
+}
+
+void test_wav_writes_every_frame_with_a_header()
+{
+    WavWriter* wav = wav_open(WAV_FILE, 48000);
+    assert(wav != NULL);
+
+    write_ramp(wav);
+    assert(wav->queued == TEST_FRAMES);
+    assert(wav_close(wav));
+
+    long size;
+    uint8_t* data = read_file(WAV_FILE, &size);
+
+    assert(size == 44 + TEST_FRAMES * 4);
+    assert(memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVEfmt ", 8) == 0);
+    assert(read_le32(data + 4) == size - 8);
+    assert(read_le32(data + 24) == 48000);
+    assert(memcmp(data + 36, "data", 4) == 0);
+    assert(read_le32(data + 40) == TEST_FRAMES * 4);
+
+    assert_ramp(data + 44);
+
+    free(data);
+    remove(WAV_FILE);
+}
+
+void test_wav_writes_raw_pcm_without_wav_extension()
+{
+    WavWriter* wav = wav_open(PCM_FILE, 48000);
+    assert(wav != NULL);
+
+    write_ramp(wav);
+    assert(wav_close(wav));
+
+    long size;
+    uint8_t* data = read_file(PCM_FILE, &size);
+
+    assert(size == TEST_FRAMES * 4);
+    assert_ramp(data);
+
+    free(data);
+    remove(PCM_FILE);
+}
+
+int main()
+{
+    test_wav_writes_every_frame_with_a_header();
+    test_wav_writes_raw_pcm_without_wav_extension();
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file